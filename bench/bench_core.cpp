@@ -0,0 +1,522 @@
+// Benchmarks of the parse, lookup, read and scan paths, on synthetic cores. Results are printed as JSON.
+
+#include <core_virtualbox.h>
+#include <page_iterator.h>
+#include <streaming_reader.h>
+#include <synthetic_core.h>
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace reven::vmghost;
+
+namespace {
+
+//! Reads per call of a read benchmark, and bytes read at most per call.
+constexpr std::size_t address_count = 1 << 16;
+constexpr std::size_t bytes_per_call = 16 << 20;
+constexpr std::size_t samples = 5;
+
+struct bench_options {
+	std::uint64_t memory_size{256 << 20};
+	std::size_t segment_count{64};
+	std::size_t max_threads{std::max(1u, std::thread::hardware_concurrency())};
+	double min_time{0.5};
+	std::string filter;
+	std::string output;
+};
+
+struct result {
+	std::string name;
+	//! Parameters, as JSON values.
+	std::vector<std::pair<std::string, std::string>> params;
+	std::uint64_t operations;
+	double ns_per_op;
+	double min_ns_per_op;
+	//! Bytes moved per operation, 0 when it makes no sense.
+	std::uint64_t bytes_per_op;
+};
+
+std::uint64_t xorshift(std::uint64_t& state)
+{
+	state ^= state << 13;
+	state ^= state >> 7;
+	state ^= state << 17;
+	return state;
+}
+
+double seconds_since(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+//!
+//! Times @c function, which performs @c operations operations per call: calls are repeated until a sample lasts
+//!   @c min_time / @c samples, and the median and best samples are kept.
+//!
+template <typename Function>
+result measure(bench_options const& options, std::string name, std::uint64_t operations, std::uint64_t bytes_per_op,
+               Function&& function)
+{
+	// Warm up, and find how many calls fill a sample.
+	const double sample_time = options.min_time / samples;
+	std::uint64_t calls = 1;
+
+	for (;;) {
+		const auto start = std::chrono::steady_clock::now();
+
+		for (std::uint64_t i = 0; i < calls; ++i) {
+			function();
+		}
+
+		const double elapsed = seconds_since(start);
+
+		if (elapsed >= sample_time / 8) {
+			calls = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(calls * sample_time / elapsed));
+			break;
+		}
+
+		calls *= 2;
+	}
+
+	std::vector<double> ns_per_op;
+
+	for (std::size_t sample = 0; sample < samples; ++sample) {
+		const auto start = std::chrono::steady_clock::now();
+
+		for (std::uint64_t i = 0; i < calls; ++i) {
+			function();
+		}
+
+		ns_per_op.push_back(seconds_since(start) * 1e9 / (calls * operations));
+	}
+
+	std::sort(ns_per_op.begin(), ns_per_op.end());
+
+	return result{ std::move(name), {}, calls * operations * samples, ns_per_op[samples / 2], ns_per_op[0],
+		           bytes_per_op };
+}
+
+std::string quote(std::string const& text)
+{
+	std::string quoted = "\"";
+
+	for (char c : text) {
+		if (c == '"' or c == '\\') {
+			quoted += '\\';
+		}
+
+		quoted += c;
+	}
+
+	return quoted + "\"";
+}
+
+void write_json(std::ostream& out, bench_options const& options, std::vector<result> const& results)
+{
+	char timestamp[32];
+	const std::time_t now = std::time(nullptr);
+	std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+	out << "{\n"
+	    << "  \"schema\": 1,\n"
+	    << "  \"library\": \"rvncorevirtualbox\",\n"
+	    << "  \"timestamp\": " << quote(timestamp) << ",\n"
+	    << "  \"host\": { \"hardware_threads\": " << std::thread::hardware_concurrency() << " },\n"
+	    << "  \"config\": { \"memory_size\": " << options.memory_size << ", \"segments\": " << options.segment_count
+	    << ", \"max_threads\": " << options.max_threads << " },\n"
+	    << "  \"results\": [";
+
+	for (std::size_t i = 0; i < results.size(); ++i) {
+		auto const& entry = results[i];
+
+		out << (i ? ",\n" : "\n") << "    { \"name\": " << quote(entry.name) << ", \"params\": {";
+
+		for (std::size_t j = 0; j < entry.params.size(); ++j) {
+			out << (j ? ", " : " ") << quote(entry.params[j].first) << ": " << entry.params[j].second;
+		}
+
+		out << (entry.params.empty() ? "}" : " }") << ", \"operations\": " << entry.operations
+		    << ", \"ns_per_op\": " << entry.ns_per_op << ", \"min_ns_per_op\": " << entry.min_ns_per_op;
+
+		if (entry.bytes_per_op) {
+			out << ", \"bytes_per_second\": " << entry.bytes_per_op * 1e9 / entry.ns_per_op;
+		}
+
+		out << " }";
+	}
+
+	out << "\n  ]\n}" << std::endl;
+}
+
+//! Physical addresses of reads of @c size bytes over the backed memory of @c memory, following @c pattern.
+std::vector<std::uint64_t> make_addresses(synthetic_memory const& memory, std::string const& pattern, std::size_t size)
+{
+	const std::uint64_t page_size = synthetic_memory::page_size;
+
+	std::uint64_t backed = 0;
+
+	for (auto const& segment : memory.segments()) {
+		backed += segment.end - segment.begin;
+	}
+
+	std::vector<std::uint64_t> addresses(std::min(address_count, bytes_per_call / size));
+	std::uint64_t state = 42;
+
+	for (std::size_t i = 0; i < addresses.size(); ++i) {
+		std::uint64_t offset;
+
+		if (pattern == "sequential") {
+			offset = (i * size) % backed;
+		} else if (pattern == "page_strided") {
+			offset = (i * page_size) % backed;
+		} else {
+			offset = xorshift(state) % backed / page_size * page_size + xorshift(state) % (page_size / size) * size;
+		}
+
+		addresses[i] = memory.backed_page_address(offset / page_size) + offset % page_size;
+	}
+
+	return addresses;
+}
+
+std::string make_temporary_directory()
+{
+	char directory[] = "/tmp/rvncorevirtualbox_benchXXXXXX";
+
+	if (::mkdtemp(directory) == nullptr) {
+		throw std::runtime_error("Can't create a temporary directory");
+	}
+
+	return directory;
+}
+
+bool selected(bench_options const& options, std::string const& name)
+{
+	return name.find(options.filter) != std::string::npos;
+}
+
+void bench_parse(bench_options const& options, std::string const& directory, std::vector<result>& results)
+{
+	if (not selected(options, "parse")) {
+		return;
+	}
+
+	for (std::size_t segments : { 1, 64, 1024 }) {
+		for (std::size_t cpus : { 1, 16, 64 }) {
+			synthetic_core_options core_options;
+			core_options.memory_size = 16 << 20;
+			core_options.segment_count = segments;
+			core_options.cpu_count = cpus;
+
+			const std::string path = directory + "/parse.core";
+			write_synthetic_core(path, core_options);
+
+			auto entry = measure(options, "parse", 1, 0, [&]() {
+				core_virtualbox core;
+				core.parse(path);
+			});
+
+			entry.params = { { "segments", std::to_string(segments) }, { "cpus", std::to_string(cpus) } };
+			results.push_back(entry);
+
+			::unlink(path.c_str());
+		}
+	}
+}
+
+void bench_lookup(bench_options const& options, core_virtualbox const& core, synthetic_memory const& memory,
+                  std::vector<result>& results)
+{
+	if (not selected(options, "find_chunk")) {
+		return;
+	}
+
+	const auto addresses = make_addresses(memory, "random", 1);
+	const MemoryVirtualBox& chunks = *core.physical_memory();
+	std::uintptr_t checksum = 0;
+
+	auto entry = measure(options, "find_chunk", addresses.size(), 0, [&]() {
+		for (auto address : addresses) {
+			checksum += reinterpret_cast<std::uintptr_t>(chunks.chunk_at(address));
+		}
+	});
+
+	entry.params = { { "segments", std::to_string(memory.segments().size()) } };
+	results.push_back(entry);
+
+	if (checksum == 0) {
+		std::cerr << "No chunk found" << std::endl;
+	}
+}
+
+void bench_reads(bench_options const& options, core_virtualbox const& core, synthetic_memory const& memory,
+                 std::vector<result>& results)
+{
+	const physical_memory& physical = *core.physical_memory();
+	std::uint64_t checksum = 0;
+
+	for (std::string pattern : { "sequential", "random", "page_strided" }) {
+		if (selected(options, "read_u64")) {
+			const auto addresses = make_addresses(memory, pattern, 8);
+
+			auto entry = measure(options, "read_u64", addresses.size(), 8, [&]() {
+				for (auto address : addresses) {
+					std::uint64_t value = 0;
+					physical.read<std::uint64_t>(address, value);
+					checksum += value;
+				}
+			});
+
+			entry.params = { { "pattern", quote(pattern) } };
+			results.push_back(entry);
+		}
+
+		if (not selected(options, "read_buffer")) {
+			continue;
+		}
+
+		for (std::size_t size : { 8, 256, 4096 }) {
+			const auto addresses = make_addresses(memory, pattern, size);
+			std::vector<std::uint8_t> buffer(size);
+
+			auto entry = measure(options, "read_buffer", addresses.size(), size, [&]() {
+				for (auto address : addresses) {
+					physical.read_buffer(address, buffer.data(), size);
+					checksum += buffer[0];
+				}
+			});
+
+			entry.params = { { "pattern", quote(pattern) }, { "size", std::to_string(size) } };
+			results.push_back(entry);
+		}
+	}
+
+	if (checksum == 1) {
+		std::cerr << std::endl;
+	}
+}
+
+void bench_threads(bench_options const& options, core_virtualbox const& core, synthetic_memory const& memory,
+                   std::vector<result>& results)
+{
+	if (not selected(options, "read_threads")) {
+		return;
+	}
+
+	const physical_memory& physical = *core.physical_memory();
+	const std::size_t size = 4096;
+	const auto addresses = make_addresses(memory, "random", size);
+
+	for (std::size_t threads = 1;; threads = std::min(threads * 2, options.max_threads)) {
+		std::atomic<std::uint64_t> checksum{ 0 };
+
+		// Each thread reads all the addresses, from a different start.
+		auto entry = measure(options, "read_threads", addresses.size() * threads, size, [&]() {
+			auto work = [&](std::size_t first) {
+				std::vector<std::uint8_t> buffer(size);
+				std::uint64_t sum = 0;
+
+				for (std::size_t i = 0; i < addresses.size(); ++i) {
+					physical.read_buffer(addresses[(first + i) % addresses.size()], buffer.data(), size);
+					sum += buffer[0];
+				}
+
+				checksum += sum;
+			};
+
+			std::vector<std::thread> workers;
+
+			for (std::size_t i = 1; i < threads; ++i) {
+				workers.emplace_back(work, addresses.size() * i / threads);
+			}
+
+			work(0);
+
+			for (auto& worker : workers) {
+				worker.join();
+			}
+		});
+
+		entry.params = { { "threads", std::to_string(threads) }, { "size", std::to_string(size) } };
+		results.push_back(entry);
+
+		if (threads == options.max_threads) {
+			break;
+		}
+	}
+}
+
+void bench_scan(bench_options const& options, core_virtualbox const& core, std::vector<result>& results)
+{
+	const MemoryVirtualBox& memory = *core.physical_memory();
+
+	std::uint64_t backed = 0;
+	memory.visit_chunks([&](const MemoryChunk& chunk) { backed += chunk.size_in_file(); });
+
+	std::uint64_t checksum = 0;
+
+	auto sum = [](const std::uint8_t* data, std::size_t size) {
+		std::uint64_t value = 0;
+
+		for (std::size_t offset = 0; offset + 8 <= size; offset += 8) {
+			std::uint64_t word;
+			std::memcpy(&word, data + offset, sizeof(word));
+			value += word;
+		}
+
+		return value;
+	};
+
+	if (selected(options, "scan_read_buffer")) {
+		std::vector<std::uint8_t> block(4 << 20);
+
+		auto entry = measure(options, "scan_read_buffer", 1, backed, [&]() {
+			memory.visit_chunks([&](const MemoryChunk& chunk) {
+				for (std::uint64_t offset = 0; offset < chunk.size_in_file(); offset += block.size()) {
+					const std::size_t size =
+					    static_cast<std::size_t>(std::min<std::uint64_t>(block.size(), chunk.size_in_file() - offset));
+					memory.read_buffer(chunk.physical_address() + offset, block.data(), size);
+					checksum += sum(block.data(), size);
+				}
+			});
+		});
+
+		entry.params = { { "block_size", std::to_string(block.size()) } };
+		results.push_back(entry);
+	}
+
+	if (selected(options, "scan_streaming")) {
+		for (bool direct_io : { false, true }) {
+			streaming_options streaming;
+			streaming.direct_io = direct_io;
+			const streaming_reader reader(memory, streaming);
+
+			auto entry = measure(options, "scan_streaming", 1, reader.size(), [&]() {
+				reader.run([&](std::uint64_t, const std::uint8_t* data, std::size_t size) { checksum += sum(data, size); });
+			});
+
+			entry.params = { { "direct_io", direct_io ? "true" : "false" } };
+			results.push_back(entry);
+		}
+	}
+
+	if (selected(options, "scan_pages")) {
+		for (std::size_t threads = 1;; threads = std::min(threads * 2, options.max_threads)) {
+			std::atomic<std::uint64_t> total{ 0 };
+
+			auto entry = measure(options, "scan_pages", 1, backed, [&]() {
+				parallel_for_each_page(memory, [&](page_span const& page) { total += sum(page.data, page.size); },
+				                       threads);
+			});
+
+			entry.params = { { "threads", std::to_string(threads) } };
+			results.push_back(entry);
+
+			if (threads == options.max_threads) {
+				break;
+			}
+		}
+	}
+
+	if (checksum == 1) {
+		std::cerr << std::endl;
+	}
+}
+
+void usage(const char* program)
+{
+	std::cerr << "Usage: " << program << " [options]" << std::endl
+	          << "  --memory-size <MiB>   memory of the read and scan core (default 256)" << std::endl
+	          << "  --segments <count>    segments of the read and scan core (default 64)" << std::endl
+	          << "  --threads <count>     most threads of the scaling benchmarks (default: hardware threads)"
+	          << std::endl
+	          << "  --min-time <seconds>  time spent measuring each benchmark (default 0.5)" << std::endl
+	          << "  --filter <text>       only run the benchmarks whose name contains the text" << std::endl
+	          << "  --output <path>       write the JSON results to a file instead of the standard output"
+	          << std::endl;
+	exit(1);
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv)
+{
+	bench_options options;
+
+	for (int i = 1; i + 1 < argc; i += 2) {
+		const std::string argument = argv[i];
+		const std::string value = argv[i + 1];
+
+		if (argument == "--memory-size") {
+			options.memory_size = std::stoull(value) << 20;
+		} else if (argument == "--segments") {
+			options.segment_count = std::stoull(value);
+		} else if (argument == "--threads") {
+			options.max_threads = std::max<std::size_t>(1, std::stoull(value));
+		} else if (argument == "--min-time") {
+			options.min_time = std::stod(value);
+		} else if (argument == "--filter") {
+			options.filter = value;
+		} else if (argument == "--output") {
+			options.output = value;
+		} else {
+			usage(argv[0]);
+		}
+	}
+
+	if (argc % 2 == 0) {
+		usage(argv[0]);
+	}
+
+	std::vector<result> results;
+	const std::string directory = make_temporary_directory();
+	const std::string path = directory + "/bench.core";
+
+	try {
+		bench_parse(options, directory, results);
+
+		synthetic_core_options core_options;
+		core_options.memory_size = options.memory_size;
+		core_options.segment_count = options.segment_count;
+		core_options.cpu_count = 4;
+
+		const synthetic_memory memory(core_options);
+		write_synthetic_core(path, core_options);
+
+		core_virtualbox core;
+		core.parse(path);
+
+		bench_lookup(options, core, memory, results);
+		bench_reads(options, core, memory, results);
+		bench_threads(options, core, memory, results);
+		bench_scan(options, core, results);
+	} catch (const std::exception& e) {
+		std::cerr << "Exception: " << e.what() << std::endl;
+		::unlink(path.c_str());
+		::rmdir(directory.c_str());
+		return 1;
+	}
+
+	::unlink(path.c_str());
+	::rmdir(directory.c_str());
+
+	if (options.output.empty()) {
+		write_json(std::cout, options, results);
+	} else {
+		std::ofstream out(options.output);
+		write_json(out, options, results);
+	}
+
+	return 0;
+}
@@ -0,0 +1,130 @@
+// Compares typed reads through the virtual physical_memory interface with the inline MemoryVirtualBoxReader.
+
+#include <memory_virtualbox.h>
+#include <memory_virtualbox_reader.h>
+
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+using namespace reven::vmghost;
+
+namespace {
+
+constexpr std::uint64_t chunk_size = 4 * 1024 * 1024;
+constexpr std::uint64_t chunk_count = 4;
+constexpr std::size_t read_count = 4 * 1024 * 1024;
+
+std::uint64_t xorshift(std::uint64_t& state)
+{
+	state ^= state << 13;
+	state ^= state >> 7;
+	state ^= state << 17;
+	return state;
+}
+
+template <typename Function> double ns_per_read(Function&& function)
+{
+	const auto start = std::chrono::steady_clock::now();
+	function();
+	const auto elapsed = std::chrono::steady_clock::now() - start;
+
+	return std::chrono::duration<double, std::nano>(elapsed).count() / read_count;
+}
+
+} // anonymous namespace
+
+int main()
+{
+	char path[] = "/tmp/rvncorevirtualbox_benchXXXXXX";
+	int fd = ::mkstemp(path);
+
+	if (fd < 0) {
+		std::cerr << "Can't create a temporary file" << std::endl;
+		return 1;
+	}
+
+	::close(fd);
+
+	{
+		std::vector<char> data(chunk_size * chunk_count);
+		std::uint64_t state = 1;
+
+		for (auto& byte : data) {
+			byte = static_cast<char>(xorshift(state));
+		}
+
+		std::ofstream(path, std::ios::binary).write(data.data(), data.size());
+	}
+
+	// Chunks separated by holes, as in real cores.
+	MemoryVirtualBox memory;
+	auto file = std::make_shared<core_file>(path);
+
+	for (std::uint64_t i = 0; i < chunk_count; ++i) {
+		memory.insert(MemoryChunk(file, i * chunk_size, chunk_size, i * 2 * chunk_size, chunk_size));
+	}
+
+	MemoryVirtualBoxReader reader(memory);
+
+	std::vector<std::uint64_t> addresses(read_count);
+	std::uint64_t state = 42;
+
+	for (auto& address : addresses) {
+		address = xorshift(state) % (chunk_count * 2 * chunk_size - 8);
+	}
+
+	const physical_memory& virtual_memory = memory;
+	std::uint64_t checksum_virtual = 0;
+	std::uint64_t checksum_reader = 0;
+
+	const double virtual_read = ns_per_read([&]() {
+		for (auto address : addresses) {
+			std::uint64_t value = 0;
+			virtual_memory.read<std::uint64_t>(address, value);
+			checksum_virtual += value;
+		}
+	});
+
+	const double reader_read = ns_per_read([&]() {
+		for (auto address : addresses) {
+			std::uint64_t value = 0;
+			reader.read<std::uint64_t>(address, value);
+			checksum_reader += value;
+		}
+	});
+
+	const double virtual_buffer = ns_per_read([&]() {
+		for (auto address : addresses) {
+			std::uint64_t value = 0;
+			virtual_memory.read_buffer(address, &value, sizeof(value));
+			checksum_virtual -= value;
+		}
+	});
+
+	const double reader_buffer = ns_per_read([&]() {
+		for (auto address : addresses) {
+			std::uint64_t value = 0;
+			reader.read_buffer(address, &value, sizeof(value));
+			checksum_reader -= value;
+		}
+	});
+
+	::unlink(path);
+
+	std::cout << "physical_memory::read<uint64_t>        " << virtual_read << " ns/read" << std::endl;
+	std::cout << "MemoryVirtualBoxReader::read<uint64_t> " << reader_read << " ns/read" << std::endl;
+	std::cout << "physical_memory::read_buffer(8)        " << virtual_buffer << " ns/read" << std::endl;
+	std::cout << "MemoryVirtualBoxReader::read_buffer(8) " << reader_buffer << " ns/read" << std::endl;
+
+	if (checksum_virtual != checksum_reader) {
+		std::cerr << "Both readers disagree" << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
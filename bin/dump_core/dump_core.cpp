@@ -1,19 +1,265 @@
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
 #include <iostream>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
 #include <core_virtualbox.h>
+#include <page_iterator.h>
+#include <raw_image_memory.h>
 
 using namespace reven;
 
+namespace {
+
+struct batch_options {
+	std::size_t threads{std::max(1u, std::thread::hardware_concurrency())};
+	//! Whether to read the memory pages, to count the all-zero ones.
+	bool scan_pages{false};
+};
+
+std::string quote(std::string const& text)
+{
+	std::string quoted = "\"";
+
+	for (char c : text) {
+		if (c == '"' or c == '\\') {
+			quoted += '\\';
+			quoted += c;
+		} else if (static_cast<unsigned char>(c) < 0x20) {
+			char escaped[8];
+			std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+			quoted += escaped;
+		} else {
+			quoted += c;
+		}
+	}
+
+	return quoted + "\"";
+}
+
+//! 64-bit values are written as hex strings, which JSON numbers can't hold exactly.
+std::string hex(std::uint64_t value)
+{
+	char text[24];
+	std::snprintf(text, sizeof(text), "\"0x%llx\"", static_cast<unsigned long long>(value));
+	return text;
+}
+
+//! The regular files of @c path if it is a directory, sorted by name, or @c path itself.
+std::vector<std::string> list_cores(std::string const& path)
+{
+	struct stat info;
+
+	if (::stat(path.c_str(), &info) != 0 or not S_ISDIR(info.st_mode)) {
+		return { path };
+	}
+
+	std::vector<std::string> cores;
+	DIR* directory = ::opendir(path.c_str());
+
+	if (directory == nullptr) {
+		return { path };
+	}
+
+	while (const dirent* entry = ::readdir(directory)) {
+		const std::string file = path + "/" + entry->d_name;
+
+		if (entry->d_name[0] != '.' and ::stat(file.c_str(), &info) == 0 and S_ISREG(info.st_mode)) {
+			cores.push_back(file);
+		}
+	}
+
+	::closedir(directory);
+
+	std::sort(cores.begin(), cores.end());
+	return cores;
+}
+
+//!
+//! Writes to @c output one JSON line describing the core at @c path, from its headers only unless
+//!   @c options.scan_pages. Returns false if the core could not be parsed: the line then holds the error.
+//!
+bool describe_core(std::string const& path, batch_options const& options, std::string& output)
+{
+	std::ostringstream line;
+
+	try {
+		vmghost::core_virtualbox core;
+		core.parse(path);
+
+		auto const& descriptor = core.descriptor();
+
+		if (descriptor.u32Magic != vmghost::vbox::DBGFCORE_MAGIC) {
+			throw std::runtime_error("Not a VirtualBox core");
+		}
+
+		line << "{\"path\":" << quote(path) << ",\"magic\":" << hex(descriptor.u32Magic)
+		     << ",\"format_version\":" << hex(descriptor.u32FmtVersion)
+		     << ",\"vbox_version\":" << hex(descriptor.u32VBoxVersion)
+		     << ",\"vbox_revision\":" << descriptor.u32VBoxRevision << ",\"cpu_count\":" << descriptor.cCpus
+		     << ",\"cpus\":[";
+
+		for (auto it = core.cpu_begin(); it != core.cpu_end(); ++it) {
+			line << (it == core.cpu_begin() ? "" : ",") << "{\"rip\":" << hex(it->rip())
+			     << ",\"rsp\":" << hex(it->rsp()) << ",\"rflags\":" << hex(it->rflags())
+			     << ",\"cr0\":" << hex(it->cr0()) << ",\"cr3\":" << hex(it->cr3()) << ",\"cr4\":" << hex(it->cr4())
+			     << ",\"cs\":" << it->cs() << ",\"ss\":" << it->ss() << "}";
+		}
+
+		std::uint64_t chunks = 0;
+		std::uint64_t mapped = 0;
+		std::uint64_t backed = 0;
+		std::uint64_t lowest = 0;
+		std::uint64_t highest = 0;
+
+		core.physical_memory()->visit_chunks([&](const vmghost::MemoryChunk& chunk) {
+			lowest = chunks++ == 0 ? chunk.physical_address() : std::min(lowest, chunk.physical_address());
+			mapped += chunk.size_in_memory();
+			backed += std::min(chunk.size_in_file(), chunk.size_in_memory());
+			highest = std::max(highest, chunk.physical_address() + chunk.size_in_memory());
+		});
+
+		line << "],\"memory\":{\"chunks\":" << chunks << ",\"mapped_bytes\":" << mapped
+		     << ",\"backed_bytes\":" << backed << ",\"lowest\":" << hex(lowest) << ",\"end\":" << hex(highest);
+
+		if (options.scan_pages) {
+			std::uint64_t pages = 0;
+			std::uint64_t zero_pages = 0;
+
+			for (auto const& page : vmghost::page_range(*core.physical_memory())) {
+				++pages;
+				zero_pages += std::all_of(page.data, page.data + page.size, [](std::uint8_t byte) { return byte == 0; });
+			}
+
+			line << ",\"pages\":" << pages << ",\"zero_pages\":" << zero_pages;
+		}
+
+		line << "}}";
+	} catch (const std::exception& e) {
+		output = "{\"path\":" + quote(path) + ",\"error\":" + quote(e.what()) + "}";
+		return false;
+	}
+
+	output = line.str();
+	return true;
+}
+
+//!
+//! Describes the cores of @c paths (files, or directories of cores) on @c options.threads threads, and prints one
+//!   JSON line per core as soon as it is done. Returns the number of cores that could not be parsed.
+//!
+std::size_t run_batch(std::vector<std::string> const& paths, batch_options const& options)
+{
+	std::vector<std::string> cores;
+
+	for (auto const& path : paths) {
+		const auto listed = list_cores(path);
+		cores.insert(cores.end(), listed.begin(), listed.end());
+	}
+
+	std::atomic<std::size_t> next{0};
+	std::atomic<std::size_t> failed{0};
+	std::mutex output;
+
+	std::vector<std::thread> workers;
+
+	for (std::size_t i = 0; i < std::min(options.threads, cores.size()); ++i) {
+		workers.emplace_back([&]() {
+			for (std::size_t index = next++; index < cores.size(); index = next++) {
+				std::string line;
+
+				if (not describe_core(cores[index], options, line)) {
+					++failed;
+				}
+
+				std::lock_guard<std::mutex> lock(output);
+				std::cout << line << '\n';
+			}
+		});
+	}
+
+	for (auto& worker : workers) {
+		worker.join();
+	}
+
+	std::cout.flush();
+	return failed;
+}
+
+void usage(const char* program)
+{
+	std::cerr << "Usage: " << program << " [options] <core>" << std::endl
+	          << "       " << program << " --batch [--threads <count>] [--scan-pages] <core or directory>..."
+	          << std::endl
+	          << "  --raw-image <image>  export the physical memory as a sparse flat image instead of dumping"
+	          << std::endl
+	          << "  --keep-zero-pages    write the all-zero pages of the core to the image" << std::endl
+	          << "  --batch              print one JSON line per core, parsing the cores in parallel" << std::endl
+	          << "  --threads <count>    parsing threads of the batch (default: one per hardware thread)" << std::endl
+	          << "  --scan-pages         read the memory of the cores to count their all-zero pages" << std::endl;
+	exit(1);
+}
+
+} // anonymous namespace
+
 int main(int argc, char** argv) {
 
-	if (argc != 2) {
-		std::cerr << "Usage: " << argv[0] << " <core>" << std::endl;
-		exit(1);
+	std::string raw_image;
+	vmghost::raw_image_options raw_options;
+	bool batch = false;
+	batch_options batch_settings;
+
+	int arg = 1;
+	for (; arg < argc and std::string(argv[arg]).compare(0, 2, "--") == 0; ++arg) {
+		const std::string option = argv[arg];
+
+		if (option == "--raw-image" and arg + 1 < argc) {
+			raw_image = argv[++arg];
+		} else if (option == "--keep-zero-pages") {
+			raw_options.skip_zero_pages = false;
+		} else if (option == "--batch") {
+			batch = true;
+		} else if (option == "--threads" and arg + 1 < argc) {
+			batch_settings.threads = std::max(1, std::atoi(argv[++arg]));
+		} else if (option == "--scan-pages") {
+			batch_settings.scan_pages = true;
+		} else {
+			usage(argv[0]);
+		}
+	}
+
+	if (batch) {
+		if (arg == argc or not raw_image.empty()) {
+			usage(argv[0]);
+		}
+
+		return run_batch(std::vector<std::string>(argv + arg, argv + argc), batch_settings) == 0 ? 0 : 1;
+	}
+
+	if (arg + 1 != argc) {
+		usage(argv[0]);
 	}
 
 	vmghost::core_virtualbox core;
 
 	try {
-		core.parse(argv[1]);
+		core.parse(argv[arg]);
+
+		if (not raw_image.empty()) {
+			const auto stats = vmghost::write_raw_image(*core.physical_memory(), raw_image, raw_options);
+
+			std::cout << "Wrote " << raw_image << ": " << stats.image_size << " bytes, " << stats.copied_bytes
+			          << " bytes of data, " << stats.zero_pages << " zero pages left as holes" << std::endl;
+			return 0;
+		}
 	} catch(const std::exception& e) {
 		std::cerr << "Exception: " << e.what() << std::endl;
 		exit(1);
@@ -0,0 +1,104 @@
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include <synthetic_core.h>
+
+using namespace reven;
+
+namespace {
+
+void usage(const char* program)
+{
+	std::cerr << "Usage: " << program << " [options] <core>" << std::endl
+	          << "  --memory-size <size>      backed memory (default 64M)" << std::endl
+	          << "  --segments <count>        number of segments (default 1)" << std::endl
+	          << "  --gap <size>              hole between segments (default 1M)" << std::endl
+	          << "  --cpus <count>            number of CPUs (default 1)" << std::endl
+	          << "  --version <4|5|6>         core format version (default 6)" << std::endl
+	          << "  --mapped-size <size>      virtual memory mapped by the page tables (default 16M)" << std::endl
+	          << "  --zero-ratio <ratio>      fraction of all-zero pages (default 0.1)" << std::endl
+	          << "  --duplicate-ratio <ratio> fraction of duplicate pages (default 0.1)" << std::endl
+	          << "  --seed <seed>             seed of the page contents (default 1)" << std::endl
+	          << "Sizes accept the K, M and G suffixes." << std::endl;
+	exit(1);
+}
+
+std::uint64_t parse_size(std::string const& text)
+{
+	std::size_t end = 0;
+	std::uint64_t value = std::stoull(text, &end, 0);
+	const std::string suffix = text.substr(end);
+
+	if (suffix == "K") {
+		value <<= 10;
+	} else if (suffix == "M") {
+		value <<= 20;
+	} else if (suffix == "G") {
+		value <<= 30;
+	} else if (not suffix.empty()) {
+		throw std::invalid_argument("Invalid size " + text);
+	}
+
+	return value;
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv)
+{
+	vmghost::synthetic_core_options options;
+	std::string path;
+
+	try {
+		for (int i = 1; i < argc; ++i) {
+			const std::string argument = argv[i];
+
+			if (argument.compare(0, 2, "--") != 0) {
+				if (not path.empty()) {
+					usage(argv[0]);
+				}
+
+				path = argument;
+				continue;
+			}
+
+			if (i + 1 == argc) {
+				usage(argv[0]);
+			}
+
+			const std::string value = argv[++i];
+
+			if (argument == "--memory-size") {
+				options.memory_size = parse_size(value);
+			} else if (argument == "--segments") {
+				options.segment_count = std::stoull(value);
+			} else if (argument == "--gap") {
+				options.gap_size = parse_size(value);
+			} else if (argument == "--cpus") {
+				options.cpu_count = std::stoull(value);
+			} else if (argument == "--version") {
+				options.version = 0x10000 + std::stoul(value);
+			} else if (argument == "--mapped-size") {
+				options.mapped_size = parse_size(value);
+			} else if (argument == "--zero-ratio") {
+				options.zero_page_ratio = std::stod(value);
+			} else if (argument == "--duplicate-ratio") {
+				options.duplicate_page_ratio = std::stod(value);
+			} else if (argument == "--seed") {
+				options.seed = std::stoull(value, nullptr, 0);
+			} else {
+				usage(argv[0]);
+			}
+		}
+
+		if (path.empty()) {
+			usage(argv[0]);
+		}
+
+		vmghost::write_synthetic_core(path, options);
+	} catch (const std::exception& e) {
+		std::cerr << "Exception: " << e.what() << std::endl;
+		exit(1);
+	}
+}
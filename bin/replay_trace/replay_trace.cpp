@@ -0,0 +1,187 @@
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <access_trace.h>
+#include <core_virtualbox.h>
+#include <delta_core.h>
+#include <memory_virtualbox_reader.h>
+#include <page_store.h>
+#include <raw_image_memory.h>
+
+using namespace reven;
+
+namespace {
+
+void usage(const char* program)
+{
+	std::cerr << "Usage: " << program << " [options] <trace> <memory>" << std::endl
+	          << "Replays the reads of an access trace against a memory, and prints their throughput and latency as"
+	          << " JSON." << std::endl
+	          << "  --backend <backend>  how <memory> is read (default core):" << std::endl
+	          << "                         core   a VirtualBox core, read with pread" << std::endl
+          << "                         mmap   a VirtualBox core, read from a mapping of the file" << std::endl
+	          << "                         raw    a flat physical memory image" << std::endl
+	          << "                         store  a page store directory, with --name" << std::endl
+	          << "                         delta  a delta core, with --base" << std::endl
+	          << "  --name <name>        name of the core in the page store" << std::endl
+	          << "  --base <core>        VirtualBox core the delta core is encoded against" << std::endl
+	          << "  --threads <count>    replay threads (default: one per recorded thread)" << std::endl
+	          << "  --rounds <count>     times the trace is replayed (default 1)" << std::endl;
+	exit(1);
+}
+
+//!
+//! Reads of a core through a @c MemoryVirtualBoxReader, which copies from a mapping of the core file.
+//!
+class mapped_memory : public vmghost::physical_memory {
+public:
+	explicit mapped_memory(const vmghost::MemoryVirtualBox& memory) : reader_(memory) {}
+
+protected:
+	bool do_read(std::uint64_t physical_address, std::uint8_t& data) const override
+	{
+		return reader_.read(physical_address, data);
+	}
+
+	void do_read_buffer(std::uint64_t physical_address, void* buffer, std::size_t size) const override
+	{
+		reader_.read_buffer(physical_address, buffer, size);
+	}
+
+private:
+	vmghost::MemoryVirtualBoxReader reader_;
+};
+
+struct source {
+	// Owners of the memory.
+	std::shared_ptr<void> owner;
+	std::shared_ptr<const vmghost::physical_memory> memory;
+};
+
+source open_memory(std::string const& backend, std::string const& path, std::string const& name,
+                   std::string const& base)
+{
+	if (backend == "core") {
+		auto core = std::make_shared<vmghost::core_virtualbox>();
+		core->parse(path);
+		return source{ core, core->physical_memory() };
+	}
+
+	if (backend == "mmap") {
+		auto core = std::make_shared<vmghost::core_virtualbox>();
+		core->parse(path);
+		return source{ core, std::make_shared<mapped_memory>(*core->physical_memory()) };
+	}
+
+	if (backend == "raw") {
+		return source{ nullptr, std::make_shared<vmghost::raw_image_memory>(path) };
+	}
+
+	if (backend == "store") {
+		if (name.empty()) {
+			throw std::invalid_argument("The store backend needs --name.");
+		}
+
+		// Read-only, so that a replay never writes to the store.
+		auto core = std::make_shared<vmghost::stored_core>(vmghost::page_store(path, true).open(name));
+		return source{ core, core->physical_memory() };
+	}
+
+	if (backend == "delta") {
+		if (base.empty()) {
+			throw std::invalid_argument("The delta backend needs --base.");
+		}
+
+		auto base_core = std::make_shared<vmghost::core_virtualbox>();
+		base_core->parse(base);
+
+		auto core = std::make_shared<vmghost::delta_core>(path, base_core->physical_memory());
+		return source{ core, core->physical_memory() };
+	}
+
+	throw std::invalid_argument("Unknown backend " + backend);
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv)
+{
+	std::string backend = "core";
+	std::string name;
+	std::string base;
+	vmghost::replay_options options;
+	std::vector<std::string> paths;
+
+	try {
+		for (int i = 1; i < argc; ++i) {
+			const std::string argument = argv[i];
+
+			if (argument.compare(0, 2, "--") != 0) {
+				paths.push_back(argument);
+				continue;
+			}
+
+			if (i + 1 == argc) {
+				usage(argv[0]);
+			}
+
+			const std::string value = argv[++i];
+
+			if (argument == "--backend") {
+				backend = value;
+			} else if (argument == "--name") {
+				name = value;
+			} else if (argument == "--base") {
+				base = value;
+			} else if (argument == "--threads") {
+				options.threads = std::stoull(value);
+			} else if (argument == "--rounds") {
+				options.rounds = std::stoull(value);
+			} else {
+				usage(argv[0]);
+			}
+		}
+
+		if (paths.size() != 2) {
+			usage(argv[0]);
+		}
+
+		const auto records = vmghost::read_access_trace(paths[0]);
+		const source memory = open_memory(backend, paths[1], name, base);
+
+		const auto result = vmghost::replay_access_trace(*memory.memory, records, options);
+
+		std::cout << "{\n"
+		          << "  \"backend\": \"" << backend << "\",\n"
+		          << "  \"reads\": " << result.reads << ",\n"
+		          << "  \"bytes\": " << result.bytes << ",\n"
+		          << "  \"errors\": " << result.errors << ",\n"
+		          << "  \"rounds\": " << std::max<std::size_t>(1, options.rounds) << ",\n"
+		          << "  \"seconds\": " << result.seconds << ",\n"
+		          << "  \"reads_per_second\": " << (result.seconds > 0 ? result.reads / result.seconds : 0) << ",\n"
+		          << "  \"bytes_per_second\": " << (result.seconds > 0 ? result.bytes / result.seconds : 0) << ",\n"
+		          << "  \"latency_ns\": { \"p50\": " << result.latency_p50_ns << ", \"p90\": " << result.latency_p90_ns
+		          << ", \"p99\": " << result.latency_p99_ns << ", \"max\": " << result.latency_max_ns << " },\n"
+		          << "  \"latency_histogram\": [";
+
+		// Bucket i counts the reads that took [2^i, 2^(i+1)) ns: trailing empty buckets are left out.
+		std::size_t buckets = vmghost::memory_stats::latency_buckets;
+
+		while (buckets > 0 and result.latency_ns[buckets - 1] == 0) {
+			--buckets;
+		}
+
+		for (std::size_t i = 0; i < buckets; ++i) {
+			std::cout << (i ? ", " : "") << result.latency_ns[i];
+		}
+
+		std::cout << "]\n}" << std::endl;
+	} catch (const std::exception& e) {
+		std::cerr << "Exception: " << e.what() << std::endl;
+		exit(1);
+	}
+}
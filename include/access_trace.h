@@ -0,0 +1,178 @@
+//!
+//! @file access_trace.h
+//! @brief Recording of the reads of a physical memory into a trace, and replay of a trace against any physical memory.
+//!
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "memory_stats.h"
+#include "physical_memory.h"
+
+namespace reven {
+namespace vmghost {
+
+class output_file;
+
+//! The @c physical_memory entry point of a recorded read.
+enum class access_kind : std::uint8_t {
+	read = 0,
+	read_buffer = 1,
+	try_read_buffer = 2,
+	read_async = 3,
+};
+
+//!
+//! A recorded read, as stored in a trace file.
+//!
+struct access_record {
+	std::uint64_t physical_address;
+	//! Start of the read, in nanoseconds since the start of the recording.
+	std::uint64_t timestamp_ns;
+	std::uint32_t size;
+	//! Index of the reading thread, in the order the threads first read.
+	std::uint16_t thread;
+	access_kind kind;
+	std::uint8_t reserved;
+};
+
+static_assert(sizeof(access_record) == 24, "access_record is a file format");
+
+struct access_trace_options {
+	//! Records one read out of @c sample_period on each thread, starting with its first read.
+	std::uint64_t sample_period{1};
+	//! Records buffered by each thread before they are written to the file.
+	std::size_t buffer_records{4096};
+	//! Records kept at most, 0 for no limit. Reads past the limit are only counted as dropped.
+	std::uint64_t max_records{0};
+};
+
+//!
+//! Physical memory that forwards reads to another one, and records them in a trace file.
+//!
+//! Each thread appends fixed-size records to its own buffer, without locking. Full buffers are written to the file
+//!   under a lock, so the cost of a recorded read is a clock read and a 24-byte store, plus a file write every
+//!   @c buffer_records records. Sampling and a record limit bound the overhead and the size of long recordings.
+//!
+//! Records of a thread are in the order of its reads, but the records of different threads are interleaved by
+//!   buffer: use the timestamps to order them globally.
+//!
+//! Reads may run concurrently with each other, but not with @c flush() or the destructor.
+//!
+class traced_memory : public physical_memory {
+public:
+	//! Creates the trace file @c path. Throws @c std::runtime_error if it can't be created.
+	traced_memory(std::shared_ptr<const physical_memory> memory, std::string const& path,
+	              access_trace_options const& options = {});
+
+	traced_memory(traced_memory const&) = delete;
+	traced_memory& operator=(traced_memory const&) = delete;
+
+	//! Writes the buffered records. Errors are ignored: call @c flush() to get them.
+	~traced_memory();
+
+	const physical_memory& memory() const { return *memory_; }
+
+	//! Writes the buffered records of all threads to the file. Throws @c std::runtime_error if a write failed, now or
+	//!   during the reads.
+	void flush();
+
+	//! Records written to the file.
+	std::uint64_t recorded() const;
+
+	//! Sampled reads that were not recorded because of @c max_records.
+	std::uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+protected:
+	bool do_read(std::uint64_t physical_address, std::uint8_t& data) const override;
+	void do_read_buffer(std::uint64_t physical_address, void* buffer, std::size_t size) const override;
+	std::future<void> do_read_async(std::uint64_t physical_address, void* buffer, std::size_t size) const override;
+	read_result do_try_read_buffer(std::uint64_t physical_address, void* buffer,
+	                               std::size_t size) const noexcept override;
+
+private:
+	struct thread_buffer {
+		std::uint16_t thread;
+		std::uint64_t countdown;
+		std::vector<access_record> records;
+	};
+
+	//! Records a read of the current thread, if it is sampled.
+	void record(access_kind kind, std::uint64_t physical_address, std::size_t size) const;
+
+	thread_buffer& local() const;
+
+	//! Writes the records of @c buffer, and empties it. Must be called with @c mutex_ held.
+	void write(thread_buffer& buffer) const;
+
+	std::shared_ptr<const physical_memory> memory_;
+	access_trace_options options_;
+
+	//! Unique among all traced memories, for the per-thread cache of @c local().
+	const std::uint64_t id_;
+	const std::chrono::steady_clock::time_point start_;
+
+	mutable std::mutex mutex_;
+	std::unique_ptr<output_file> file_;
+	mutable std::unordered_map<std::thread::id, std::unique_ptr<thread_buffer>> buffers_;
+	mutable std::uint64_t written_{0};
+	//! Set when @c max_records records were written.
+	mutable std::atomic<bool> full_{false};
+	mutable std::atomic<std::uint64_t> dropped_{0};
+	//! The first write error during the reads, which can't throw it.
+	mutable std::exception_ptr error_;
+
+}; // class traced_memory
+
+//!
+//! Reads the trace file at @c path. Throws @c std::runtime_error if it is not a valid trace.
+//!
+//! Records are sorted by thread, each thread keeping the order of its reads.
+//!
+std::vector<access_record> read_access_trace(std::string const& path);
+
+struct replay_options {
+	//! Replay threads. The reads of a recorded thread are replayed in order, on the replay thread of index
+	//!   (recorded thread % threads). 0: one replay thread per recorded thread.
+	std::size_t threads{0};
+	//! Times the trace is replayed. Each round is timed separately.
+	std::size_t rounds{1};
+};
+
+struct replay_result {
+	//! Reads and bytes requested by a round.
+	std::uint64_t reads{0};
+	std::uint64_t bytes{0};
+	//! Reads of all rounds that threw, or returned @c read_status::io_error.
+	std::uint64_t errors{0};
+	//! Wall-clock time of the best round.
+	double seconds{0};
+
+	//! Latency of the reads of all rounds.
+	std::uint64_t latency_p50_ns{0};
+	std::uint64_t latency_p90_ns{0};
+	std::uint64_t latency_p99_ns{0};
+	std::uint64_t latency_max_ns{0};
+	//! Same buckets as @c memory_stats::latency_ns.
+	std::uint64_t latency_ns[memory_stats::latency_buckets]{};
+};
+
+//!
+//! Executes the reads of @c records against @c memory, through the entry point they were recorded from, and
+//!   measures them. The reads of a round are the same each time, in the same order on each replay thread.
+//!
+replay_result replay_access_trace(physical_memory const& memory, std::vector<access_record> const& records,
+                                  replay_options const& options = {});
+}
+} // namespace reven::vmghost
@@ -0,0 +1,48 @@
+//!
+//! @file aligned_allocator.h
+//! @brief Declaration of class @c reven::vmghost::aligned_allocator.
+//!
+
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+namespace reven {
+namespace vmghost {
+
+//!
+//! Allocator honoring alignments above the one of @c operator new, which C++14 containers ignore otherwise.
+//!
+template <typename T, std::size_t Alignment = alignof(T)> class aligned_allocator {
+public:
+	typedef T value_type;
+
+	template <typename U> struct rebind {
+		typedef aligned_allocator<U, Alignment> other;
+	};
+
+	aligned_allocator() = default;
+
+	template <typename U> aligned_allocator(aligned_allocator<U, Alignment> const&) {}
+
+	T* allocate(std::size_t count)
+	{
+		void* pointer = nullptr;
+		const std::size_t alignment = Alignment < sizeof(void*) ? sizeof(void*) : Alignment;
+
+		if (::posix_memalign(&pointer, alignment, count * sizeof(T)) != 0) {
+			throw std::bad_alloc();
+		}
+
+		return static_cast<T*>(pointer);
+	}
+
+	void deallocate(T* pointer, std::size_t) { ::free(pointer); }
+
+	template <typename U> bool operator==(aligned_allocator<U, Alignment> const&) const { return true; }
+	template <typename U> bool operator!=(aligned_allocator<U, Alignment> const&) const { return false; }
+};
+}
+} // namespace reven::vmghost
@@ -0,0 +1,60 @@
+//!
+//! @file core_file.h
+//! @brief Declaration of class @c reven::vmghost::core_file.
+//!
+
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+namespace reven {
+namespace vmghost {
+
+//!
+//! Read-only file descriptor on a core file.
+//!
+//! Reads are positional (@c pread), so a single instance can be shared between threads without any locking, unlike
+//!   the @c std::ifstream used for parsing.
+//!
+class core_file {
+public:
+	//! Opens @c path read-only. Throws @c std::runtime_error if the file cannot be opened.
+	explicit core_file(std::string const& path);
+
+	core_file(core_file const&) = delete;
+	core_file& operator=(core_file const&) = delete;
+
+	~core_file();
+
+	//! The path the file was opened from.
+	std::string const& path() const { return path_; }
+
+	//! The underlying file descriptor.
+	int fd() const { return fd_; }
+
+	//! The size of the file in bytes.
+	std::uint64_t size() const;
+
+	//! Reads exactly @c size bytes at @c offset. Throws @c std::runtime_error on I/O error or short read.
+	void read(std::uint64_t offset, void* buffer, std::uint64_t size) const;
+
+	//! Same as @c read, but returns the number of bytes read instead of throwing. Less than @c size means an I/O
+	//!   error (@c errno is set) or the end of the file (@c errno is 0).
+	std::uint64_t try_read(std::uint64_t offset, void* buffer, std::uint64_t size) const noexcept;
+
+	//! Read-only mapping of the whole file, created on first call. Throws @c std::runtime_error if it can't be mapped.
+	const std::uint8_t* data() const;
+
+private:
+	std::string path_;
+	int fd_{-1};
+
+	mutable std::once_flag map_once_;
+	mutable const std::uint8_t* mapping_{nullptr};
+	mutable std::uint64_t mapping_size_{0};
+
+}; // class core_file
+}
+} // namespace reven::vmghost
@@ -9,6 +9,7 @@
 #include <fstream>
 #include <memory>
 
+#include "aligned_allocator.h"
 #include "cpu_virtualbox.h"
 #include "memory_virtualbox.h"
 #include "core_virtualbox_def.h"
@@ -22,7 +23,7 @@ namespace vmghost {
 //! @class core_virtualbox core_virtualbox.h <vmghost/core_virtualbox/core_virtualbox.h>
 //!
 class core_virtualbox {
-	typedef std::vector<cpu_virtualbox> cpu_vector;
+	typedef std::vector<cpu_virtualbox, aligned_allocator<cpu_virtualbox>> cpu_vector;
 
 public:
 	typedef cpu_vector::const_iterator cpu_iterator;
@@ -54,6 +55,15 @@ public:
 	//! The virtualbox revision which produce the core.
 	std::uint32_t virtualbox_revision() const { return descriptor_.u32VBoxRevision; }
 
+	//! The raw core descriptor.
+	const vbox::DBGFCOREDESCRIPTOR& descriptor() const { return descriptor_; }
+
+	//! Read statistics of the physical memory. See @c memory_stats.
+	memory_stats stats() const { return memory_->stats(); }
+
+	//! The path the core was parsed from.
+	std::string const& path() const { return core_path_; }
+
 	//! Writes the core's path.
 	template <typename Media> void serialize(Media& to) const;
 
@@ -74,6 +84,9 @@ private:
 	//! the core file.
 	std::shared_ptr<std::ifstream> file_;
 
+	//! the core file, for positional reads of the memory chunks.
+	std::shared_ptr<core_file> data_file_;
+
 	//! The description of the loaded core.
 	vbox::DBGFCOREDESCRIPTOR descriptor_;
 
@@ -0,0 +1,64 @@
+//!
+//! @file core_writer.h
+//! @brief Declares `reven::vmghost::core_writer`, which writes VirtualBox ELF cores.
+//!
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "core_virtualbox.h"
+#include "core_virtualbox_def.h"
+#include "cpu_virtualbox.h"
+#include "memory_virtualbox.h"
+#include "physical_memory.h"
+#include "physical_memory_map.h"
+
+namespace reven {
+namespace vmghost {
+
+//!
+//! Writes a VirtualBox ELF core, which @c core_virtualbox can parse, in a single pass.
+//!
+//! Memory is streamed to the file as it is added, one page-aligned PT_LOAD segment per range, with large writes. The
+//!   notes (the descriptor, then each CPU followed by its Tetrane note) and the program headers are written after
+//!   the memory, once all of it is known.
+//!
+class core_writer {
+public:
+	//! Creates @c path. Throws @c std::runtime_error if it can't be created.
+	explicit core_writer(std::string const& path);
+
+	~core_writer();
+
+	//! The descriptor to write. Its CPU count is replaced by the number of added CPUs. Without one, a descriptor of
+	//!   the version of the CPUs is written.
+	void set_descriptor(vbox::DBGFCOREDESCRIPTOR const& descriptor);
+
+	//! CPUs are read back in the order they are added. They must all have the same version, that of the descriptor.
+	void add_cpu(cpu_virtualbox const& cpu);
+
+	//! Adds @c range of @c memory as a segment. Bytes that are not backed are written as zeros.
+	void add_memory(const physical_memory& memory, memory_range range);
+
+	//!
+	//! Adds the parts of the chunks of @c memory that overlap @c range, one segment per chunk from the lowest
+	//!   address, keeping their uninitialized tails. The data of chunks backed by a @c core_file is copied from file
+	//!   to file (@c copy_file_range) when the file systems allow it.
+	//!
+	void add_memory(const MemoryVirtualBox& memory, memory_range range);
+
+	//! Writes the notes and program headers and closes the file.
+	void finish();
+
+private:
+	struct impl;
+	std::unique_ptr<impl> impl_;
+};
+
+//! Writes a copy of @c core to @c path.
+void write_core(core_virtualbox const& core, std::string const& path);
+}
+} // namespace reven::vmghost
@@ -0,0 +1,167 @@
+//!
+//! @file cpu_view.h
+//! @brief Compile-time specialized views of a @c reven::vmghost::cpu_virtualbox.
+//!
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include "cpu_virtualbox.h"
+
+namespace reven {
+namespace vmghost {
+
+//!
+//! Layout of the CPU context for a given core format version.
+//!
+template <std::uint32_t Version> struct cpu_layout;
+
+template <> struct cpu_layout<vbox::DBGFCORE_FMT_VERSIONv5> {
+	typedef vbox::DBGFCORECPUv5 type;
+	static constexpr bool has_tsc_aux = false;
+	static constexpr std::size_t ext_offset = offsetof(type, ext);
+};
+
+template <> struct cpu_layout<vbox::DBGFCORE_FMT_VERSIONv6> {
+	typedef vbox::DBGFCORECPUv6 type;
+	static constexpr bool has_tsc_aux = true;
+	static constexpr std::size_t ext_offset = offsetof(type, ext);
+};
+
+//!
+//! Read-only view of a @c cpu_virtualbox whose core format version is known at compile time.
+//!
+//! Unlike @c cpu_virtualbox, accessors are inline and never test the version at runtime. Use @c visit_cpu to select
+//!   the right view once per CPU. The view must not outlive the viewed CPU.
+//!
+//! Accessors of the XSAVE area (x87, SSE, MXCSR) load it on first use, see @c cpu_virtualbox::extended_state.
+//!
+template <std::uint32_t Version> class cpu_view {
+public:
+	typedef typename cpu_layout<Version>::type context_type;
+
+	static constexpr std::uint32_t version = Version;
+
+	//! The version of @c cpu must use the layout of @c Version, otherwise the behavior is undefined.
+	explicit cpu_view(const cpu_virtualbox& cpu) : cpu_(cpu), hot_(cpu.hot_state()) {}
+
+	const cpu_hot_state& hot_state() const { return hot_; }
+	const vbox::DBGFCORE_base& base() const { return hot_.base; }
+	const vbox::X86XSAVEAREA& ext() const { return cpu_.extended_state(); }
+
+	std::uint64_t rax() const { return hot_.base.rax; }
+	std::uint64_t rbx() const { return hot_.base.rbx; }
+	std::uint64_t rcx() const { return hot_.base.rcx; }
+	std::uint64_t rdx() const { return hot_.base.rdx; }
+	std::uint64_t rsp() const { return hot_.base.rsp; }
+	std::uint64_t rbp() const { return hot_.base.rbp; }
+	std::uint64_t rsi() const { return hot_.base.rsi; }
+	std::uint64_t rdi() const { return hot_.base.rdi; }
+	std::uint64_t r8() const { return hot_.base.r8; }
+	std::uint64_t r9() const { return hot_.base.r9; }
+	std::uint64_t r10() const { return hot_.base.r10; }
+	std::uint64_t r11() const { return hot_.base.r11; }
+	std::uint64_t r12() const { return hot_.base.r12; }
+	std::uint64_t r13() const { return hot_.base.r13; }
+	std::uint64_t r14() const { return hot_.base.r14; }
+	std::uint64_t r15() const { return hot_.base.r15; }
+
+	std::uint64_t rip() const { return hot_.base.rip; }
+	std::uint64_t rflags() const { return hot_.base.rflags; }
+
+	//! @name Control registers
+	//! @{
+
+	std::uint64_t cr0() const { return hot_.base.cr0; }
+	std::uint64_t cr2() const { return hot_.base.cr2; }
+	std::uint64_t cr3() const { return hot_.base.cr3; }
+	std::uint64_t cr4() const { return hot_.base.cr4; }
+	std::uint64_t cr8() const { return hot_.tetrane.cr8; }
+	std::uint64_t xcr(std::uint8_t index) const { return index < 2 ? hot_.aXcr[index] : 0; }
+
+	//! @}
+
+	//! @name Segments and descriptor tables
+	//! @{
+
+	const vbox::DBGFCORESEL& cs() const { return hot_.base.cs; }
+	const vbox::DBGFCORESEL& ds() const { return hot_.base.ds; }
+	const vbox::DBGFCORESEL& es() const { return hot_.base.es; }
+	const vbox::DBGFCORESEL& fs() const { return hot_.base.fs; }
+	const vbox::DBGFCORESEL& gs() const { return hot_.base.gs; }
+	const vbox::DBGFCORESEL& ss() const { return hot_.base.ss; }
+	const vbox::DBGFCORESEL& ldtr() const { return hot_.base.ldtr; }
+	const vbox::DBGFCORESEL& tr() const { return hot_.base.tr; }
+	const vbox::DBGFCOREXDTR& gdtr() const { return hot_.base.gdtr; }
+	const vbox::DBGFCOREXDTR& idtr() const { return hot_.base.idtr; }
+
+	//! @}
+
+	//! @name MSRs
+	//! @{
+
+	std::uint64_t msrEFER() const { return hot_.base.msrEFER; }
+	std::uint64_t msrSTAR() const { return hot_.base.msrSTAR; }
+	std::uint64_t msrPAT() const { return hot_.base.msrPAT; }
+	std::uint64_t msrLSTAR() const { return hot_.base.msrLSTAR; }
+	std::uint64_t msrCSTAR() const { return hot_.base.msrCSTAR; }
+	std::uint64_t msrSFMASK() const { return hot_.base.msrSFMASK; }
+	std::uint64_t msrKernelGSBase() const { return hot_.base.msrKernelGSBase; }
+	std::uint64_t msrApicBase() const { return hot_.base.msrApicBase; }
+
+	//! Only available on layouts that store it: using it on an older version does not compile.
+	template <std::uint32_t V = Version>
+	typename std::enable_if<cpu_layout<V>::has_tsc_aux, std::uint64_t>::type msrTscAux() const
+	{
+		return hot_.msrTscAux;
+	}
+
+	//! @}
+
+	//! @name Floating points and SIMD
+	//! @{
+
+	std::uint16_t fpu_status_word() const { return ext().x87.FSW; }
+	std::uint16_t fpu_control_word() const { return ext().x87.FCW; }
+	std::uint8_t fpu_abridged_tags() const { return ext().x87.FTW; }
+	std::uint8_t fpu_top() const { return (ext().x87.FSW >> 11) & 7; }
+
+	std::uint32_t partial_sse_register(std::uint8_t index, std::uint8_t part_index) const
+	{
+		return ext().x87.aXMM[index].au32[part_index];
+	}
+
+	std::uint32_t mxcsr() const { return ext().x87.MXCSR; }
+	std::uint32_t mxcsr_mask() const { return ext().x87.MXCSR_MASK; }
+
+	//! @}
+
+private:
+	const cpu_virtualbox& cpu_;
+	const cpu_hot_state& hot_;
+
+}; // class cpu_view
+
+typedef cpu_view<vbox::DBGFCORE_FMT_VERSIONv5> cpu_view_v5;
+typedef cpu_view<vbox::DBGFCORE_FMT_VERSIONv6> cpu_view_v6;
+
+//!
+//! Calls @c visitor with the view matching the version of @c cpu, and returns its result.
+//!
+//! The version is tested once; @c visitor is typically a generic lambda, instantiated for each view. Versions older
+//!   than v6 share the v5 layout.
+//!
+template <typename Visitor>
+auto visit_cpu(const cpu_virtualbox& cpu, Visitor&& visitor) -> decltype(visitor(std::declval<cpu_view_v5>()))
+{
+	if (cpu.version() == vbox::DBGFCORE_FMT_VERSIONv6) {
+		return visitor(cpu_view_v6(cpu));
+	}
+
+	return visitor(cpu_view_v5(cpu));
+}
+}
+} // namespace reven::vmghost
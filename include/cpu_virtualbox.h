@@ -1,29 +1,84 @@
 #pragma once
 
+#include <functional>
+#include <memory>
+
 #include "core_virtualbox_def.h"
+#include "xsave.h"
 
 namespace reven {
 namespace vmghost {
 
+enum class register_id : std::uint16_t;
+
+//!
+//! The registers of a CPU that analyses read the most, without the XSAVE area.
+//!
+//! It is cache-line aligned, and starts with the general purpose registers, RIP and RFLAGS, which fit in the first
+//!   three cache lines.
+//!
+struct alignas(64) cpu_hot_state {
+	vbox::DBGFCORE_base base;
+	//! Zero on formats older than v6, which don't store it.
+	std::uint64_t msrTscAux;
+	std::uint64_t aXcr[2];
+	tetrane_cpu_info tetrane;
+};
+
+static_assert(sizeof(cpu_hot_state) == 640, "Invalid cpu_hot_state size");
+
 class cpu_virtualbox {
 public:
+	//! Loads the XSAVE area of the CPU on first access.
+	typedef std::function<void(vbox::X86XSAVEAREA&)> extended_state_loader;
+
 	cpu_virtualbox() = default;
 
 	explicit cpu_virtualbox(std::uint32_t version, vbox::DBGFCORECPU context)
-		: version_(version)
-		, context_(context) {}
+	{
+		set_context(version, context);
+	}
 
+	// Copies share the XSAVE area, which is immutable once loaded.
+	cpu_virtualbox(cpu_virtualbox const& rhs) = default;
 	cpu_virtualbox(cpu_virtualbox&& rhs) = default;
+	cpu_virtualbox& operator=(cpu_virtualbox const& rhs) = default;
+	cpu_virtualbox& operator=(cpu_virtualbox&& rhs) = default;
 	~cpu_virtualbox() = default;
 
 
-	// The version of the passed context should be the same as version(), otherwise the behavior is undefined.
-	inline void set_context(const vbox::DBGFCORECPU& context) { context_ = context; }
-	inline void set_tetrane_context(const tetrane_cpu_info& tetrane_context) { tetrane_context_ = tetrane_context; }
+	//! Sets the version, and the registers of @c context laid out according to it.
+	void set_context(std::uint32_t version, const vbox::DBGFCORECPU& context);
+
+	//! Sets the registers of @c context, laid out according to version(). Throws @c std::runtime_error if no version
+	//!   is set: the context is split by version, so setting the version afterwards would not lay it out again.
+	void set_context(const vbox::DBGFCORECPU& context);
+	inline void set_tetrane_context(const tetrane_cpu_info& tetrane_context) { hot_.tetrane = tetrane_context; }
+
+	//! Sets the registers outside of the XSAVE area; the XSAVE area is read by @c loader on first access.
+	void set_hot_state(const cpu_hot_state& hot_state, extended_state_loader loader);
 
+	//! The registers outside of the XSAVE area of @c context, laid out according to @c version.
+	static cpu_hot_state make_hot_state(std::uint32_t version, const vbox::DBGFCORECPU& context);
+
+	//! Offset of the XSAVE area in a context laid out according to @c version.
+	static std::size_t extended_state_offset(std::uint32_t version);
+
+	//! Sets the version of the next @c set_context() or @c set_hot_state(). The registers already set are kept as
+	//!   they are.
 	inline void set_version(std::uint32_t version) { version_ = version; }
 	inline std::uint32_t version() const { return version_; }
 
+	//! The registers outside of the XSAVE area.
+	inline const cpu_hot_state& hot_state() const { return hot_; }
+
+	//! The XSAVE area, loaded on first access (which may throw if loading fails).
+	const vbox::X86XSAVEAREA& extended_state() const;
+
+	//! The raw context, laid out according to version(). It loads the XSAVE area.
+	vbox::DBGFCORECPU context() const;
+	inline const tetrane_cpu_info& tetrane_context() const { return hot_.tetrane; }
+
 	//! @name Paging features
 	//! @{
 
@@ -33,6 +88,10 @@ public:
 	bool is_smep_enabled() const;
 	bool is_pse36_enabled() const;
 	bool is_nx_enabled() const;
+	//! IA-32e mode active (EFER.LMA).
+	bool is_long_mode_enabled() const;
+	//! 5-level paging (CR4.LA57).
+	bool is_la57_enabled() const;
 
 	//! @}
 
@@ -226,6 +285,21 @@ public:
 	std::uint8_t mxcsr_fz() const;
 	std::uint8_t mxcsr_mm() const;
 
+	//! @}
+	//! @name XSAVE extended state (AVX, AVX-512)
+	//! @{
+
+	std::uint64_t xstate_bv() const;
+	std::uint64_t xcomp_bv() const;
+
+	vector128 xmm_register(std::uint8_t index) const;
+	vector256 ymm_register(std::uint8_t index) const;
+	vector512 zmm_register(std::uint8_t index) const;
+	std::uint64_t opmask_register(std::uint8_t index) const;
+
+	//! Decoder of the whole XSAVE area, for bulk accesses. It must not outlive this CPU.
+	xsave_decoder xsave() const { return xsave_decoder(extended_state()); }
+
 	//! @}
 
 	//! Retrieves the associated debug register
@@ -243,14 +317,31 @@ public:
 	//! Throws: RuntimeError on v5 cores
 	std::uint64_t msrTscAux() const;
 
+	//! @name Generic accesses, see register_id.h
+	//! @{
+
+	//! Value of @c id, zero-extended. Throws std::runtime_error if @c id is wider than 8 bytes or not stored by
+	//!   version().
+	std::uint64_t get(register_id id) const;
+
+	//! Values of the @c count registers of @c ids to @c out, as get().
+	void get_many(const register_id* ids, std::size_t count, std::uint64_t* out) const;
+
+	//! Copies the raw bytes of @c id (register_info::size of them) to @c buffer, for registers of any width.
+	void get_raw(register_id id, void* buffer) const;
+
+	//! @}
+
 private:
 	std::uint16_t fpu_rebuild_tag_word() const;
 
-	const vbox::X86XSAVEAREA& ext() const;
+	const vbox::X86XSAVEAREA& ext() const { return extended_state(); }
+
+	struct lazy_extended_state;
 
-	std::uint32_t version_;
-	vbox::DBGFCORECPU context_;
-	tetrane_cpu_info tetrane_context_;
+	cpu_hot_state hot_{};
+	std::uint32_t version_{0};
+	std::shared_ptr<lazy_extended_state> ext_;
 
 }; // class cpu_virtualbox
 }
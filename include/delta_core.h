@@ -0,0 +1,162 @@
+//!
+//! @file delta_core.h
+//! @brief Cores stored as the difference with a base core.
+//!
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "aligned_allocator.h"
+#include "core_file.h"
+#include "core_virtualbox.h"
+#include "core_virtualbox_def.h"
+#include "cpu_virtualbox.h"
+#include "physical_memory.h"
+#include "physical_memory_map.h"
+
+namespace reven {
+namespace vmghost {
+
+//!
+//! Where the pages of a run of a delta core are read from.
+//!
+enum class delta_page_source : std::uint32_t {
+	//! The base memory, at the same address.
+	base,
+	//! The delta file.
+	delta,
+	//! Zeros.
+	zero,
+};
+
+//!
+//! Consecutive pages read from the same source. Delta pages of a run are consecutive in the delta file too.
+//!
+struct delta_page_run {
+	std::uint64_t first_page;
+	std::uint32_t page_count;
+	delta_page_source source;
+	//! Index of the first page in the delta file, for delta runs.
+	std::uint64_t first_delta_page;
+};
+
+static_assert(sizeof(delta_page_run) == 24, "Invalid delta_page_run size");
+
+//! Page counts of a written delta core.
+struct delta_stats {
+	std::uint64_t pages{0};
+	std::uint64_t base_pages{0};
+	std::uint64_t zero_pages{0};
+	std::uint64_t delta_pages{0};
+};
+
+//!
+//! Writes a delta core: the descriptor and CPUs of a core, and the pages of its memory that differ from a base
+//!   memory.
+//!
+//! Pages are 4 KiB. A page identical to the base page at the same address (holes of the base reading as zeros) is
+//!   read from the base, an all-zero page is stored as such, and the other pages are stored in the delta file.
+//!
+class delta_core_writer {
+public:
+	static constexpr std::size_t page_size = 0x1000;
+
+	//! Creates @c path. @c base_path is recorded to help finding the base core back, it is not checked.
+	delta_core_writer(std::string const& path, const physical_memory& base, std::string const& base_path = "");
+
+	~delta_core_writer();
+
+	void set_descriptor(vbox::DBGFCOREDESCRIPTOR const& descriptor);
+
+	//! CPUs are read back in the order they are added. They must all have the version of the descriptor: throws
+	//!   @c std::runtime_error otherwise.
+	void add_cpu(cpu_virtualbox const& cpu);
+
+	//! Adds the pages of @c range of @c memory, compared with the base. Ranges must be added in increasing order and
+	//!   are rounded to pages.
+	void add_memory(const physical_memory& memory, memory_range range);
+
+	//! Writes the tables and closes the file.
+	delta_stats finish();
+
+private:
+	struct impl;
+	std::unique_ptr<impl> impl_;
+};
+
+//!
+//! Writes @c core as a delta against @c base, in a single pass over their memories.
+//!
+delta_stats write_delta_core(core_virtualbox const& core, core_virtualbox const& base, std::string const& path);
+
+//!
+//! Physical memory of a delta core.
+//!
+//! A read resolves its pages with a binary search in the table of runs, then reads each run from the base memory
+//!   or the delta file. Pages outside of any run are holes, read as zeros.
+//!
+class delta_memory : public physical_memory {
+public:
+	delta_memory(std::shared_ptr<core_file> file, std::uint64_t data_offset, std::vector<delta_page_run> runs,
+	             std::shared_ptr<const physical_memory> base);
+
+	std::vector<delta_page_run> const& runs() const { return runs_; }
+
+	const physical_memory& base() const { return *base_; }
+
+protected:
+	bool do_read(std::uint64_t physical_address, std::uint8_t& data) const override;
+	void do_read_buffer(std::uint64_t physical_address, void* buffer, std::size_t size) const override;
+	//! Zero runs are backed. The bytes of base runs that the base memory doesn't back are uninitialized.
+	read_result do_try_read_buffer(std::uint64_t physical_address, void* buffer,
+	                               std::size_t size) const noexcept override;
+
+private:
+	//! Calls @c visitor(run, address, size, offset) for each run or hole (null run) of the range.
+	template <typename Visitor>
+	void split(std::uint64_t physical_address, std::size_t size, Visitor&& visitor) const;
+
+	std::shared_ptr<core_file> file_;
+	std::uint64_t data_offset_;
+	std::vector<delta_page_run> runs_;
+	std::shared_ptr<const physical_memory> base_;
+
+}; // class delta_memory
+
+//!
+//! A core read from a delta core file and its base memory.
+//!
+class delta_core {
+	typedef std::vector<cpu_virtualbox, aligned_allocator<cpu_virtualbox>> cpu_vector;
+
+public:
+	typedef cpu_vector::const_iterator cpu_iterator;
+
+	//! Opens the delta core at @c path. Throws @c std::runtime_error if it is not a valid delta core, including when
+	//!   its tables are outside of the file or its page runs are not sorted and disjoint.
+	delta_core(std::string const& path, std::shared_ptr<const vmghost::physical_memory> base);
+
+	std::shared_ptr<const delta_memory> physical_memory() const { return memory_; }
+
+	cpu_iterator cpu_begin() const { return cpus_.begin(); }
+	cpu_iterator cpu_end() const { return cpus_.end(); }
+
+	vbox::DBGFCOREDESCRIPTOR const& descriptor() const { return descriptor_; }
+
+	//! The path of the base core, as given to the writer.
+	std::string const& base_path() const { return base_path_; }
+
+private:
+	vbox::DBGFCOREDESCRIPTOR descriptor_;
+	std::string base_path_;
+	cpu_vector cpus_;
+	std::shared_ptr<delta_memory> memory_;
+
+}; // class delta_core
+}
+} // namespace reven::vmghost
@@ -0,0 +1,99 @@
+//!
+//! @file descriptor_table.h
+//! @brief Decoding of the GDT, IDT and LDT of a CPU.
+//!
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "cpu_virtualbox.h"
+#include "virtual_memory.h"
+
+namespace reven {
+namespace vmghost {
+
+//! What a descriptor describes.
+enum class descriptor_kind : std::uint8_t {
+	//! Not present and all zeros.
+	null,
+	code,
+	data,
+	ldt,
+	tss,
+	call_gate,
+	task_gate,
+	interrupt_gate,
+	trap_gate,
+	//! Second half of a 16-byte IA-32e system descriptor of the GDT or LDT.
+	upper_half,
+	//! A system type that is reserved in the current mode.
+	reserved,
+};
+
+//!
+//! A decoded segment, system or gate descriptor.
+//!
+struct segment_descriptor {
+	//! Present bit.
+	static constexpr std::uint8_t present = 1 << 0;
+	//! 64-bit code segment (L bit).
+	static constexpr std::uint8_t long_mode = 1 << 1;
+	//! 32-bit segment (D/B bit).
+	static constexpr std::uint8_t default_big = 1 << 2;
+	//! Limit in 4 KiB units (G bit). @c limit is already scaled.
+	static constexpr std::uint8_t granularity = 1 << 3;
+	//! Available for system software (AVL bit).
+	static constexpr std::uint8_t available = 1 << 4;
+
+	//! Segment base, or target offset of a gate.
+	std::uint64_t base;
+	//! Segment limit in bytes.
+	std::uint32_t limit;
+	//! Target code segment of a call, interrupt or trap gate, TSS segment of a task gate.
+	std::uint16_t selector;
+	descriptor_kind kind;
+	//! Raw type field (bits 8-11 of the high dword).
+	std::uint8_t type;
+	std::uint8_t dpl;
+	//! Combination of the flags above.
+	std::uint8_t flags;
+	//! Interrupt stack table index of IA-32e interrupt and trap gates, parameter count of legacy call gates.
+	std::uint8_t ist;
+
+	bool is_present() const { return flags & present; }
+};
+
+//! The kind of table to decode.
+enum class descriptor_table_type : std::uint8_t {
+	//! GDT or LDT, indexed by selector: a 16-byte system descriptor takes two entries.
+	segments,
+	//! IDT, indexed by vector.
+	interrupts,
+};
+
+//!
+//! Decodes the descriptors of a table of @c size bytes.
+//!
+//! In IA-32e mode (@c long_mode), system descriptors and gates are 16 bytes, and the IDT has one entry per 16
+//!   bytes. Trailing bytes that don't make a full entry are ignored.
+//!
+std::vector<segment_descriptor> decode_descriptors(const void* table, std::size_t size, descriptor_table_type type,
+                                                   bool long_mode);
+
+//!
+//! Decodes the global descriptor table of @c cpu, read with one bulk read of @c memory.
+//!
+//! Throws std::runtime_error if the table is not mapped.
+//!
+std::vector<segment_descriptor> read_gdt(const virtual_memory& memory, const cpu_virtualbox& cpu);
+
+//! Same as @c read_gdt, for the interrupt descriptor table.
+std::vector<segment_descriptor> read_idt(const virtual_memory& memory, const cpu_virtualbox& cpu);
+
+//! Same as @c read_gdt, for the local descriptor table. It is empty if the LDTR is null.
+std::vector<segment_descriptor> read_ldt(const virtual_memory& memory, const cpu_virtualbox& cpu);
+}
+} // namespace reven::vmghost
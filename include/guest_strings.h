@@ -0,0 +1,75 @@
+//!
+//! @file guest_strings.h
+//! @brief Reads of NUL-terminated strings, and search of the strings of a @c reven::vmghost::MemoryVirtualBox.
+//!
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "memory_virtualbox.h"
+#include "physical_memory.h"
+#include "virtual_memory.h"
+
+namespace reven {
+namespace vmghost {
+
+//! @name Single strings
+//!
+//! The string is read in blocks rather than character by character, and ends at the first NUL character, after
+//!   @c max_length characters, or at the first byte that can't be read (not mapped, or a hole).
+//! @{
+
+std::string read_string(const virtual_memory& memory, std::uint64_t virtual_address, std::size_t max_length = 0x1000);
+std::string read_string(const physical_memory& memory, std::uint64_t physical_address,
+                        std::size_t max_length = 0x1000);
+
+//! UTF-16 strings, in code units.
+std::u16string read_utf16_string(const virtual_memory& memory, std::uint64_t virtual_address,
+                                 std::size_t max_length = 0x1000);
+std::u16string read_utf16_string(const physical_memory& memory, std::uint64_t physical_address,
+                                 std::size_t max_length = 0x1000);
+
+//! @}
+
+//! Encoding of a string found by @c find_strings.
+enum class string_encoding : std::uint8_t {
+	//! Printable ASCII characters and tabs.
+	ascii,
+	//! The same characters, as 16-bit little-endian code units, aligned on 2 bytes.
+	utf16,
+};
+
+//! A string found by @c find_strings.
+struct string_match {
+	std::uint64_t physical_address;
+	//! Length in characters.
+	std::uint64_t length;
+	string_encoding encoding;
+};
+
+//! Options of @c find_strings.
+struct strings_options {
+	//! Minimum number of characters of a string.
+	std::size_t min_length{4};
+	bool ascii{true};
+	bool utf16{true};
+	//! Number of threads (0: one per hardware thread).
+	std::size_t threads{0};
+};
+
+//!
+//! Finds the runs of printable characters of the backed memory of @c memory, as the `strings` utility does.
+//!
+//! The backed memory is split in slices scanned in parallel, 16 bytes at a time with SSE2 when available. A string
+//!   is reported once, by the slice it starts in, even if it continues in the next slices or in a physically
+//!   adjacent chunk. Strings stop at holes. Matches are sorted by address.
+//!
+//! The chunks must be backed by a core file (see @c page_range).
+//!
+std::vector<string_match> find_strings(const MemoryVirtualBox& memory, strings_options const& options);
+}
+} // namespace reven::vmghost
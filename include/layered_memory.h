@@ -0,0 +1,99 @@
+//!
+//! @file layered_memory.h
+//! @brief Declares `reven::vmghost::layered_memory`, a stack of physical memories.
+//!
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "memory_virtualbox.h"
+#include "overlay_memory.h"
+#include "physical_memory.h"
+#include "physical_memory_map.h"
+#include "raw_image_memory.h"
+
+namespace reven {
+namespace vmghost {
+
+//! @name Address ranges served by the usual layers
+//! @{
+
+//! The chunks of @c memory, uninitialized tails included.
+std::vector<memory_range> memory_coverage(const MemoryVirtualBox& memory);
+//! The pages of @c memory that were written, at the time of the call.
+std::vector<memory_range> memory_coverage(const overlay_memory& memory);
+//! The whole image.
+std::vector<memory_range> memory_coverage(const raw_image_memory& memory);
+
+//! @}
+
+//!
+//! Physical memory made of layers stacked on top of each other, such as a core, raw images and patches.
+//!
+//! Each layer serves a set of address ranges, and an address is read from the topmost layer serving it. Rather than
+//!   asking each layer in turn, reads resolve the layer through a table of address runs built once, when layers
+//!   are added or their ranges change: a read costs one binary search, plus one read per run it crosses. Addresses
+//!   served by no layer are holes, read as zeros.
+//!
+//! The layers are shared: reading is thread-safe as long as the layers are.
+//!
+class layered_memory : public physical_memory {
+public:
+	//! Identifies a layer: layers are numbered from the bottom, starting at 0.
+	typedef std::size_t layer_id;
+
+	layered_memory() = default;
+
+	//! Stacks @c layer on top of the current layers, serving @c coverage (see @c memory_coverage).
+	layer_id add_layer(std::shared_ptr<const physical_memory> layer, std::vector<memory_range> coverage);
+
+	//! Changes the ranges served by @c layer, e.g. after writing to an overlay.
+	void set_coverage(layer_id layer, std::vector<memory_range> coverage);
+
+	std::size_t layer_count() const { return layers_.size(); }
+
+	const physical_memory& layer(layer_id layer) const { return *layers_.at(layer).memory; }
+
+	//! The layer serving @c physical_address. Returns false if it is a hole.
+	bool layer_at(std::uint64_t physical_address, layer_id& layer) const;
+
+	//! Number of runs of the routing table.
+	std::size_t run_count() const { return runs_.size(); }
+
+protected:
+	bool do_read(std::uint64_t physical_address, std::uint8_t& data) const override;
+	void do_read_buffer(std::uint64_t physical_address, void* buffer, std::size_t size) const override;
+	read_result do_try_read_buffer(std::uint64_t physical_address, void* buffer,
+	                               std::size_t size) const noexcept override;
+
+private:
+	static constexpr layer_id no_layer = ~layer_id(0);
+
+	struct layer_entry {
+		std::shared_ptr<const physical_memory> memory;
+		std::vector<memory_range> coverage;
+	};
+
+	//! Addresses from @c begin to the begin of the next run are served by @c layer.
+	struct run {
+		std::uint64_t begin;
+		layer_id layer;
+	};
+
+	void build_runs();
+
+	//! Calls @c visitor(layer, address, size, offset) for each run of the range, with @c no_layer for holes.
+	template <typename Visitor>
+	void split(std::uint64_t physical_address, std::size_t size, Visitor&& visitor) const;
+
+	std::vector<layer_entry> layers_;
+
+	//! Sorted by address. Starts at address 0.
+	std::vector<run> runs_{ run{ 0, no_layer } };
+
+}; // class layered_memory
+}
+} // namespace reven::vmghost
@@ -3,6 +3,9 @@
 #include <fstream>
 #include <memory>
 
+#include "core_file.h"
+#include "read_status.h"
+
 namespace reven {
 namespace vmghost {
 
@@ -10,6 +13,8 @@ class MemoryChunk {
 public:
 	MemoryChunk(std::shared_ptr<std::ifstream> file, std::uint64_t offset_in_file, std::uint64_t size_in_file, std::uint64_t physical_address, std::uint64_t size_in_memory)
 		: file_(file), offset_in_file_(offset_in_file), size_in_file_(size_in_file), physical_address_(physical_address), size_in_memory_(size_in_memory) {}
+	MemoryChunk(std::shared_ptr<core_file> file, std::uint64_t offset_in_file, std::uint64_t size_in_file, std::uint64_t physical_address, std::uint64_t size_in_memory)
+		: core_file_(file), offset_in_file_(offset_in_file), size_in_file_(size_in_file), physical_address_(physical_address), size_in_memory_(size_in_memory) {}
 	~MemoryChunk() = default;
 
 	std::uint64_t offset_in_file() const { return offset_in_file_; }
@@ -17,12 +22,20 @@ public:
 	std::uint64_t physical_address() const { return physical_address_; }
 	std::uint64_t size_in_memory() const { return size_in_memory_; }
 
+	//! The file backing this chunk, if it was created from a @c core_file (null otherwise).
+	std::shared_ptr<core_file> file() const { return core_file_; }
+
 	void read(std::uint64_t physical_address, void* data, std::uint64_t size) const;
 
+	//! Reads [physical_address, physical_address + size), which must be inside the chunk, without throwing. Bytes
+	//!   that are not read from the file are set to zero.
+	read_result try_read(std::uint64_t physical_address, void* data, std::uint64_t size) const noexcept;
+
 	bool contains(std::uint64_t physical_address) const;
 
 private:
 	std::shared_ptr<std::ifstream> file_;
+	std::shared_ptr<core_file> core_file_;
 	std::uint64_t offset_in_file_{0};
 	std::uint64_t size_in_file_{0};
 	std::uint64_t physical_address_{0};
@@ -0,0 +1,55 @@
+//!
+//! @file memory_stats.h
+//! @brief Declares `reven::vmghost::memory_stats`, the read statistics of a @c MemoryVirtualBox.
+//!
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace reven {
+namespace vmghost {
+
+//!
+//! Counts of the reads of a @c MemoryVirtualBox, summed over all threads.
+//!
+//! They are only collected when the library is built with the @c MEMORY_STATS CMake option: otherwise they stay at
+//!   zero, and collecting them costs nothing.
+//!
+struct memory_stats {
+	//! Reads of 1, 2 to 8, 9 to 64, 65 to 4096, 4097 to 65536 and more bytes.
+	static constexpr std::size_t size_classes = 6;
+
+	//! Bucket i counts the reads that took [2^i, 2^(i+1)) ns (bucket 0 includes 0 ns, the last one has no bound).
+	static constexpr std::size_t latency_buckets = 32;
+
+	//! Reads and bytes read, by size class. Typed reads of the @c physical_memory interface are made of 1-byte reads.
+	std::uint64_t reads[size_classes]{};
+	std::uint64_t read_bytes[size_classes]{};
+
+	//! Chunk lookups, each a search of the chunk map: there is no lookup cache.
+	std::uint64_t chunk_lookups{0};
+
+	//! Reads that hit a hole, and bytes zero-filled because they are in a hole or a @c read_buffer across chunks, or
+	//!   in an uninitialized chunk tail read by @c try_read_buffer (@c read_buffer leaves those bytes unchanged).
+	//!   Reads that span several chunks or holes.
+	std::uint64_t hole_reads{0};
+	std::uint64_t zero_filled_bytes{0};
+	std::uint64_t cross_chunk_reads{0};
+
+	std::uint64_t latency_ns[latency_buckets]{};
+
+	static std::size_t size_class(std::size_t size);
+	static std::size_t latency_bucket(std::uint64_t ns);
+
+	std::uint64_t total_reads() const;
+	std::uint64_t total_read_bytes() const;
+
+	memory_stats& operator+=(memory_stats const& other);
+};
+
+//! Whether the library was built with the @c MEMORY_STATS option.
+bool memory_stats_enabled();
+}
+} // namespace reven::vmghost
@@ -2,13 +2,17 @@
 
 #include <map>
 #include <functional>
+#include <memory>
 
 #include "memory_chunk.h"
+#include "memory_stats.h"
 #include "physical_memory.h"
 
 namespace reven {
 namespace vmghost {
 
+class memory_stats_collector;
+
 class MemoryVirtualBox : public physical_memory {
 	typedef std::map<std::uint64_t, MemoryChunk, std::greater<std::uint64_t>> MemoryChunksContainer;
 
@@ -17,7 +21,7 @@ public:
 	typedef MemoryChunksContainer::const_iterator const_iterator;
 	typedef MemoryChunksContainer::value_type value_type;
 
-	MemoryVirtualBox() = default;
+	MemoryVirtualBox();
 
 	void clear();
 
@@ -27,13 +31,43 @@ public:
 
 	void visit_chunks(std::function<void(const MemoryChunk&)> visitor) const;
 
+	//! The chunk containing @c physical_address, or null if it lies in a hole.
+	const MemoryChunk* chunk_at(std::uint64_t physical_address) const;
+
+	//! Read statistics of all threads since construction or the last @c reset_stats(). See @c memory_stats.
+	memory_stats stats() const;
+
+	void reset_stats();
+
 private:
 	bool do_read(std::uint64_t physical_address, std::uint8_t& data) const final;
 	void do_read_buffer(std::uint64_t physical_address, void* buffer, std::size_t size) const final;
+	read_result do_try_read_buffer(std::uint64_t physical_address, void* buffer, std::size_t size) const noexcept final;
 
 	const_iterator findChunk(std::uint64_t physical_address) const;
 
+	//!
+	//! The statistics collector of the memory, only set in builds with the @c MEMORY_STATS option. Copies get a new
+	//!   collector, so that a memory and its copies count their reads apart.
+	//!
+	class stats_handle {
+	public:
+		stats_handle();
+		stats_handle(stats_handle const&);
+		stats_handle(stats_handle&& other);
+		~stats_handle();
+
+		stats_handle& operator=(stats_handle const&);
+		stats_handle& operator=(stats_handle&& other);
+
+		memory_stats_collector* get() const { return collector_.get(); }
+
+	private:
+		std::unique_ptr<memory_stats_collector> collector_;
+	};
+
 	MemoryChunksContainer chunks_;
+	stats_handle stats_;
 
 }; // class MemoryVirtualBox
 
@@ -47,6 +81,17 @@ inline std::size_t MemoryVirtualBox::chunks_count() const
 	return chunks_.size();
 }
 
+inline const MemoryChunk* MemoryVirtualBox::chunk_at(std::uint64_t physical_address) const
+{
+	auto found_chunk = findChunk(physical_address);
+
+	if (found_chunk == chunks_.end() or not found_chunk->second.contains(physical_address)) {
+		return nullptr;
+	}
+
+	return &found_chunk->second;
+}
+
 inline MemoryVirtualBox::const_iterator MemoryVirtualBox::findChunk(std::uint64_t physical_address) const
 {
 	auto where = chunks_.lower_bound(physical_address);
@@ -0,0 +1,134 @@
+//!
+//! @file memory_virtualbox_reader.h
+//! @brief Declaration of class @c reven::vmghost::MemoryVirtualBoxReader.
+//!
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "memory_virtualbox.h"
+
+namespace reven {
+namespace vmghost {
+
+//!
+//! Non-virtual reader of the physical memory of a @c MemoryVirtualBox.
+//!
+//! It offers the same reads as @c physical_memory, but as inline functions over a sorted array of chunks and a
+//!   mapping of the core files, so that reads in tight loops compile down to a binary search and a @c memcpy.
+//!
+//! Results are the same as through @c physical_memory, except that the uninitialized tail of a chunk reads as
+//!   zeros (@c MemoryChunk::read leaves the buffer untouched there).
+//!
+//! The reader is a snapshot of the chunks at construction time and must not outlive them. It is immutable, so it can
+//!   be shared between threads.
+//!
+class MemoryVirtualBoxReader final {
+public:
+	//! Throws @c std::runtime_error if a chunk is not backed by a @c core_file.
+	explicit MemoryVirtualBoxReader(const MemoryVirtualBox& memory);
+
+	bool read(std::uint64_t physical_address, std::uint8_t& data) const;
+
+	template <typename ReadTypeSize, typename DataType>
+	bool read(std::uint64_t physical_address, DataType& data) const;
+
+	void read_buffer(std::uint64_t physical_address, void* buffer, std::size_t size) const;
+
+private:
+	struct chunk {
+		std::uint64_t physical_address;
+		std::uint64_t size_in_memory;
+		std::uint64_t backed_size;
+		const std::uint8_t* data;
+	};
+
+	//! The chunk containing @c physical_address, or null.
+	const chunk* find(std::uint64_t physical_address) const;
+
+	//! Copies [physical_address, physical_address + size) which must be inside @c where.
+	static void copy(const chunk& where, std::uint64_t physical_address, void* buffer, std::size_t size);
+
+	//! Sorted by increasing physical address.
+	std::vector<chunk> chunks_;
+
+}; // class MemoryVirtualBoxReader
+
+inline const MemoryVirtualBoxReader::chunk* MemoryVirtualBoxReader::find(std::uint64_t physical_address) const
+{
+	auto found = std::upper_bound(chunks_.begin(), chunks_.end(), physical_address,
+	                              [](std::uint64_t address, const chunk& entry) {
+		                              return address < entry.physical_address;
+	                              });
+
+	if (found == chunks_.begin()) {
+		return nullptr;
+	}
+
+	--found;
+
+	if (physical_address - found->physical_address >= found->size_in_memory) {
+		return nullptr;
+	}
+
+	return &*found;
+}
+
+inline void MemoryVirtualBoxReader::copy(const chunk& where, std::uint64_t physical_address, void* buffer,
+                                         std::size_t size)
+{
+	const std::uint64_t offset = physical_address - where.physical_address;
+	const std::uint64_t backed = offset < where.backed_size ? std::min<std::uint64_t>(size, where.backed_size - offset)
+	                                                        : 0;
+
+	if (backed) {
+		std::memcpy(buffer, where.data + offset, backed);
+	}
+
+	std::memset(static_cast<std::uint8_t*>(buffer) + backed, 0, size - backed);
+}
+
+inline bool MemoryVirtualBoxReader::read(std::uint64_t physical_address, std::uint8_t& data) const
+{
+	read_buffer(physical_address, &data, 1);
+	return true;
+}
+
+template <typename ReadTypeSize, typename DataType>
+inline bool MemoryVirtualBoxReader::read(std::uint64_t physical_address, DataType& data) const
+{
+	static_assert(sizeof(data) >= sizeof(ReadTypeSize), "Data does not fit the requested size!");
+
+	const chunk* where = find(physical_address);
+
+	if (where and physical_address - where->physical_address + sizeof(ReadTypeSize) <= where->size_in_memory) {
+		copy(*where, physical_address, &data, sizeof(ReadTypeSize));
+		return true;
+	}
+
+	// Crosses a chunk boundary: like physical_memory::read, read byte per byte.
+	for (std::size_t i = 0; i < sizeof(ReadTypeSize); ++i) {
+		read(physical_address + i, reinterpret_cast<std::uint8_t*>(&data)[i]);
+	}
+
+	return true;
+}
+
+inline void MemoryVirtualBoxReader::read_buffer(std::uint64_t physical_address, void* buffer, std::size_t size) const
+{
+	const chunk* where = find(physical_address);
+
+	if (where == nullptr or size == 0
+	    or physical_address - where->physical_address + size > where->size_in_memory) {
+		std::memset(buffer, 0, size);
+		return;
+	}
+
+	copy(*where, physical_address, buffer, size);
+}
+}
+} // namespace reven::vmghost
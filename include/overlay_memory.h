@@ -0,0 +1,127 @@
+//!
+//! @file overlay_memory.h
+//! @brief Declares `reven::vmghost::overlay_memory`, a writable copy-on-write view of a physical memory.
+//!
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "physical_memory.h"
+
+namespace reven {
+namespace vmghost {
+
+//!
+//! Writable physical memory on top of a read-only one.
+//!
+//! Written pages are copied from the base memory into a pooled arena on their first write, and tracked in a dirty
+//!   bitmap. Reads of clean pages go straight to the base memory, so the overlay costs nothing for pages that were
+//!   never written.
+//!
+//! Checkpoints save the content of a page the first time it is written after them, so that rolling back costs
+//!   O(pages written since the checkpoint).
+//!
+//! Reads may run concurrently with each other, but not with writes or rollbacks.
+//!
+class overlay_memory : public physical_memory {
+public:
+	static constexpr std::size_t page_size = 0x1000;
+
+	//! Identifies a checkpoint. Identifiers are never reused, even after a rollback or a reset.
+	typedef std::uint64_t checkpoint_id;
+
+	explicit overlay_memory(std::shared_ptr<const physical_memory> base);
+
+	overlay_memory(overlay_memory const&) = delete;
+	overlay_memory& operator=(overlay_memory const&) = delete;
+
+	~overlay_memory();
+
+	const physical_memory& base() const { return *base_; }
+
+	//! Writes @c size bytes at @c physical_address.
+	void write_buffer(std::uint64_t physical_address, const void* buffer, std::size_t size);
+
+	template <typename DataType> void write(std::uint64_t physical_address, DataType const& data)
+	{
+		write_buffer(physical_address, &data, sizeof(data));
+	}
+
+	//! Whether the page of number @c page (address / page_size) was written.
+	bool is_dirty(std::uint64_t page) const
+	{
+		return page / 64 < dirty_bits_.size() and (dirty_bits_[page / 64] >> (page % 64)) & 1;
+	}
+
+	//! The content of the written page of number @c page, or null if it is clean.
+	const std::uint8_t* dirty_page(std::uint64_t page) const;
+
+	//! The numbers of the written pages, in increasing order.
+	std::vector<std::uint64_t> dirty_pages() const;
+
+	std::size_t dirty_page_count() const { return pages_.size(); }
+
+	//! Starts recording the pages written from now on, and returns an identifier for @c rollback.
+	checkpoint_id checkpoint();
+
+	//! Restores the memory as it was when @c checkpoint was taken, and drops it and the checkpoints taken after it.
+	//!
+	//! Throws std::runtime_error if @c checkpoint was already dropped.
+	void rollback(checkpoint_id checkpoint);
+
+	//! Drops every written page and checkpoint: the memory is the base memory again.
+	void reset();
+
+protected:
+	bool do_read(std::uint64_t physical_address, std::uint8_t& data) const override;
+	void do_read_buffer(std::uint64_t physical_address, void* buffer, std::size_t size) const override;
+	read_result do_try_read_buffer(std::uint64_t physical_address, void* buffer,
+	                               std::size_t size) const noexcept override;
+
+private:
+	class page_arena;
+
+	struct page {
+		std::uint8_t* data;
+		//! Number of checkpoints when the page was last saved to the undo log.
+		std::size_t saved_depth;
+	};
+
+	struct undo_entry {
+		std::uint64_t page;
+		//! The content to restore, or null if the page was clean.
+		std::uint8_t* data;
+		std::size_t saved_depth;
+	};
+
+	//! Calls @c clean(address, size, offset) for each run of clean pages, and @c dirty(data, size, offset) for each
+	//!   part of a dirty page, of the range.
+	template <typename CleanVisitor, typename DirtyVisitor>
+	void split(std::uint64_t physical_address, std::size_t size, CleanVisitor&& clean, DirtyVisitor&& dirty) const;
+
+	void set_dirty(std::uint64_t page, bool dirty);
+
+	std::shared_ptr<const physical_memory> base_;
+	std::unique_ptr<page_arena> arena_;
+	std::unordered_map<std::uint64_t, page> pages_;
+	std::vector<std::uint64_t> dirty_bits_;
+
+	struct checkpoint_mark {
+		checkpoint_id id;
+		//! Size of the undo log when the checkpoint was taken.
+		std::size_t log_size;
+	};
+
+	std::vector<undo_entry> undo_log_;
+	//! The active checkpoints, by increasing identifier.
+	std::vector<checkpoint_mark> checkpoints_;
+	checkpoint_id next_checkpoint_{0};
+
+}; // class overlay_memory
+}
+} // namespace reven::vmghost
@@ -0,0 +1,204 @@
+//!
+//! @file page_iterator.h
+//! @brief Zero-copy iteration over the backed pages of a @c reven::vmghost::MemoryVirtualBox.
+//!
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <iterator>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "memory_virtualbox.h"
+
+namespace reven {
+namespace vmghost {
+
+//!
+//! A range of backed physical memory, pointing directly into the mapped core file.
+//!
+struct page_span {
+	std::uint64_t physical_address;
+	const std::uint8_t* data;
+	std::size_t size;
+};
+
+//!
+//! Range over the pages of a @c MemoryVirtualBox that are backed by its core file, in increasing physical address
+//!   order.
+//!
+//! Holes between chunks and uninitialized chunk tails are skipped. Pages are aligned on physical addresses, so the
+//!   first and last page of a chunk can be partial. With a page size of 0, every contiguous backed run is yielded as
+//!   a single span.
+//!
+//! The spans point into a read-only mapping of the core files, which stays valid as long as the chunks of the
+//!   memory do. Chunks that are not backed by a @c core_file can't be mapped: building the range throws
+//!   @c std::runtime_error.
+//!
+class page_range {
+public:
+	class iterator {
+	public:
+		typedef std::forward_iterator_tag iterator_category;
+		typedef page_span value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef const page_span* pointer;
+		typedef const page_span& reference;
+
+		iterator() = default;
+
+		reference operator*() const { return current_; }
+		pointer operator->() const { return &current_; }
+
+		iterator& operator++()
+		{
+			offset_ += current_.size;
+
+			if (offset_ == range_->runs_[run_].size) {
+				++run_;
+				offset_ = 0;
+			}
+
+			update();
+			return *this;
+		}
+
+		iterator operator++(int)
+		{
+			iterator previous = *this;
+			++*this;
+			return previous;
+		}
+
+		bool operator==(iterator const& other) const { return run_ == other.run_ and offset_ == other.offset_; }
+		bool operator!=(iterator const& other) const { return not(*this == other); }
+
+	private:
+		friend class page_range;
+
+		iterator(const page_range* range, std::size_t run, std::uint64_t offset)
+			: range_(range), run_(run), offset_(offset)
+		{
+			update();
+		}
+
+		void update()
+		{
+			if (run_ == range_->runs_.size()) {
+				return;
+			}
+
+			const page_span& run = range_->runs_[run_];
+			current_.physical_address = run.physical_address + offset_;
+			current_.data = run.data + offset_;
+			current_.size = run.size - offset_;
+
+			if (range_->page_size_) {
+				const std::uint64_t to_boundary = range_->page_size_
+				                                  - current_.physical_address % range_->page_size_;
+				current_.size = std::min<std::uint64_t>(current_.size, to_boundary);
+			}
+		}
+
+		const page_range* range_{nullptr};
+		std::size_t run_{0};
+		std::uint64_t offset_{0};
+		page_span current_{0, nullptr, 0};
+	};
+
+	explicit page_range(const MemoryVirtualBox& memory, std::size_t page_size = 0x1000);
+
+	iterator begin() const { return iterator(this, 0, 0); }
+	iterator end() const { return iterator(this, runs_.size(), 0); }
+
+	//! The contiguous backed runs, in increasing physical address order.
+	std::vector<page_span> const& runs() const { return runs_; }
+
+	//! Number of spans the range yields.
+	std::uint64_t page_count() const { return first_page_.back(); }
+
+	//! Iterator on the span of index @c page, in O(log(runs)).
+	iterator at(std::uint64_t page) const;
+
+private:
+	std::size_t page_size_;
+	std::vector<page_span> runs_;
+
+	//! For each run, the index of its first span. Ends with the total number of spans.
+	std::vector<std::uint64_t> first_page_;
+
+}; // class page_range
+
+//!
+//! Calls @c visitor with every backed page of @c memory (see @c page_range), in increasing physical address order.
+//!
+template <typename Visitor>
+void for_each_page(const MemoryVirtualBox& memory, Visitor&& visitor, std::size_t page_size = 0x1000)
+{
+	page_range range(memory, page_size);
+
+	for (auto const& page : range) {
+		visitor(page);
+	}
+}
+
+//!
+//! Same as @c for_each_page, but splits the pages evenly across @c threads threads (0: one per hardware thread).
+//!
+//! @c visitor is shared by all the threads and must be thread-safe. Pages are visited in increasing order within
+//!   a thread only. The first exception thrown by @c visitor is rethrown once all threads are done.
+//!
+template <typename Visitor>
+void parallel_for_each_page(const MemoryVirtualBox& memory, Visitor&& visitor, std::size_t threads = 0,
+                            std::size_t page_size = 0x1000)
+{
+	page_range range(memory, page_size);
+
+	if (threads == 0) {
+		threads = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	const std::uint64_t pages = range.page_count();
+	threads = static_cast<std::size_t>(std::max<std::uint64_t>(1, std::min<std::uint64_t>(threads, pages)));
+
+	std::exception_ptr error;
+	std::mutex error_mutex;
+
+	auto work = [&](std::uint64_t first, std::uint64_t last) {
+		try {
+			auto page = range.at(first);
+
+			for (std::uint64_t i = first; i < last; ++i, ++page) {
+				visitor(*page);
+			}
+		} catch (...) {
+			std::lock_guard<std::mutex> lock(error_mutex);
+
+			if (not error) {
+				error = std::current_exception();
+			}
+		}
+	};
+
+	std::vector<std::thread> workers;
+
+	for (std::size_t i = 1; i < threads; ++i) {
+		workers.emplace_back(work, pages * i / threads, pages * (i + 1) / threads);
+	}
+
+	work(0, pages / threads);
+
+	for (auto& worker : workers) {
+		worker.join();
+	}
+
+	if (error) {
+		std::rethrow_exception(error);
+	}
+}
+}
+} // namespace reven::vmghost
@@ -0,0 +1,197 @@
+//!
+//! @file page_store.h
+//! @brief Declares `reven::vmghost::page_store`, which stores the pages of many cores once.
+//!
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "aligned_allocator.h"
+#include "core_file.h"
+#include "core_virtualbox.h"
+#include "cpu_virtualbox.h"
+#include "physical_memory.h"
+#include "physical_memory_map.h"
+
+namespace reven {
+namespace vmghost {
+
+class output_file;
+
+//! Identifies a page of a @c page_store.
+typedef std::uint32_t page_id;
+
+//! Page counts of an ingested core.
+struct page_store_stats {
+	std::uint64_t pages{0};
+	//! All-zero pages, which are not stored.
+	std::uint64_t zero_pages{0};
+	//! Pages stored for the first time.
+	std::uint64_t new_pages{0};
+	//! Pages that were already stored.
+	std::uint64_t shared_pages{0};
+};
+
+//!
+//! Physical memory of a core ingested in a @c page_store.
+//!
+//! Each page of a region is resolved through a table of page ids into the pack file. Addresses outside of the
+//!   regions are holes, read as zeros.
+//!
+class stored_memory : public physical_memory {
+public:
+	//! Pages [first_page, first_page + page_count) have the ids [first_index, first_index + page_count) of the
+	//!   page table.
+	struct region {
+		std::uint64_t first_page;
+		std::uint64_t page_count;
+		std::uint64_t first_index;
+	};
+
+	stored_memory(std::shared_ptr<core_file> pack, std::vector<region> regions, std::vector<page_id> pages);
+
+	std::vector<region> const& regions() const { return regions_; }
+
+	//! The id of the page of number @c page. Returns false if the page is in no region.
+	bool page_at(std::uint64_t page, page_id& id) const;
+
+protected:
+	bool do_read(std::uint64_t physical_address, std::uint8_t& data) const override;
+	void do_read_buffer(std::uint64_t physical_address, void* buffer, std::size_t size) const override;
+	//! Zero pages are backed.
+	read_result do_try_read_buffer(std::uint64_t physical_address, void* buffer,
+	                               std::size_t size) const noexcept override;
+
+private:
+	std::shared_ptr<core_file> pack_;
+	std::vector<region> regions_;
+	std::vector<page_id> pages_;
+
+}; // class stored_memory
+
+//!
+//! A core read back from a @c page_store.
+//!
+class stored_core {
+	typedef std::vector<cpu_virtualbox, aligned_allocator<cpu_virtualbox>> cpu_vector;
+
+public:
+	typedef cpu_vector::const_iterator cpu_iterator;
+
+	stored_core(vbox::DBGFCOREDESCRIPTOR const& descriptor, cpu_vector cpus, std::shared_ptr<stored_memory> memory)
+		: descriptor_(descriptor), cpus_(std::move(cpus)), memory_(std::move(memory))
+	{
+	}
+
+	std::shared_ptr<const stored_memory> physical_memory() const { return memory_; }
+
+	cpu_iterator cpu_begin() const { return cpus_.begin(); }
+	cpu_iterator cpu_end() const { return cpus_.end(); }
+
+	vbox::DBGFCOREDESCRIPTOR const& descriptor() const { return descriptor_; }
+
+private:
+	vbox::DBGFCOREDESCRIPTOR descriptor_;
+	cpu_vector cpus_;
+	std::shared_ptr<stored_memory> memory_;
+
+}; // class stored_core
+
+//!
+//! Content-addressed store of the pages of many cores, in a directory.
+//!
+//! Unique pages are appended to a pack file (`pages.pack`), and found back through their 64-bit hash: in a sorted
+//!   index file (`pages.index`) that is mapped in memory, or in a table of the pages added since the index was last
+//!   written. A hash match is confirmed by comparing the pages, so collisions never merge different pages.
+//!
+//! Each ingested core (`cores/<name>.core`) keeps its descriptor and CPU contexts verbatim, and a page id for each of
+//!   its pages. All-zero pages are not stored.
+//!
+//! A store is not meant to be written by several instances or threads at once. A read-only instance writes nothing,
+//!   and can read a store while another instance writes it, up to the last flush of that instance.
+//!
+class page_store {
+public:
+	static constexpr std::size_t page_size = 0x1000;
+
+	//! Id of all-zero pages.
+	static constexpr page_id zero_page = 0xffffffff;
+
+	//! Opens the store in @c directory, creating it if needed. With @c read_only, the store must exist, and
+	//!   @c ingest() and @c flush() throw @c std::runtime_error.
+	explicit page_store(std::string const& directory, bool read_only = false);
+
+	page_store(page_store const&) = delete;
+	page_store& operator=(page_store const&) = delete;
+
+	//! Writes the index, unless the store is read-only. Errors are ignored: call @c flush() to get them.
+	~page_store();
+
+	bool read_only() const { return not pack_; }
+
+	//!
+	//! Stores the memory and CPUs of @c core as @c name, replacing any core of that name. Pages are hashed by
+	//!   @c threads threads (0: one per hardware thread).
+	//!
+	page_store_stats ingest(core_virtualbox const& core, std::string const& name, std::size_t threads = 0);
+
+	//! Same as the other @c ingest, for the @c ranges of any physical memory.
+	page_store_stats ingest(std::string const& name, vbox::DBGFCOREDESCRIPTOR const& descriptor,
+	                        const cpu_virtualbox* cpus, std::size_t cpu_count, const physical_memory& memory,
+	                        std::vector<memory_range> const& ranges, std::size_t threads = 0);
+
+	//! Writes the index of the pages added since the last flush.
+	void flush();
+
+	//! Number of stored pages.
+	std::uint64_t page_count() const { return page_count_; }
+
+	//! The id of the stored page with the content of the @c page_size bytes at @c page. Returns false if there is
+	//!   none.
+	bool find_page(const std::uint8_t* page, page_id& id) const;
+
+	//! Opens the core stored as @c name. Throws @c std::runtime_error if there is none.
+	stored_core open(std::string const& name) const;
+
+private:
+	//! Same as @c find_page, with the hash of the page already computed.
+	bool find_page(const std::uint8_t* page, std::uint64_t hash, page_id& id) const;
+
+	//! Whether the stored page @c id has the content of @c page. The page must be either buffered or flushed whole.
+	bool has_content(page_id id, const std::uint8_t* page) const;
+
+	void map_index();
+
+	std::string core_path(std::string const& name) const;
+
+	struct index_entry {
+		std::uint64_t hash;
+		page_id id;
+		std::uint32_t reserved;
+	};
+
+	std::string directory_;
+	std::uint64_t page_count_{0};
+
+	//! Null if the store is read-only.
+	std::unique_ptr<output_file> pack_;
+	std::shared_ptr<core_file> pack_reader_;
+
+	std::shared_ptr<core_file> index_file_;
+	const index_entry* index_{nullptr};
+	std::uint64_t index_size_{0};
+	//! The index covers the pages [0, indexed_pages_).
+	std::uint64_t indexed_pages_{0};
+
+	//! The pages added since the index was written.
+	std::unordered_multimap<std::uint64_t, page_id> pending_;
+
+}; // class page_store
+}
+} // namespace reven::vmghost
@@ -5,7 +5,11 @@
 
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
+#include <future>
+
+#include "read_status.h"
 
 namespace reven {
 namespace vmghost {
@@ -30,6 +34,15 @@ public:
 
 	void read_buffer(std::uint64_t physical_address, void* buffer, std::size_t size) const;
 
+	//! Same as @c read_buffer, but returns immediately. @c buffer must stay valid until the future is ready.
+	//!
+	//! For many reads in flight at once, prefer a @c read_queue.
+	std::future<void> read_async(std::uint64_t physical_address, void* buffer, std::size_t size) const;
+
+	//! Same as @c read_buffer, but never throws and tells whether the bytes are backed. Bytes that are not backed
+	//!   are set to zero.
+	read_result try_read_buffer(std::uint64_t physical_address, void* buffer, std::size_t size) const noexcept;
+
 	template <typename Media> void serialize(Media& to) const;
 
 	template <typename Media> void deserialize(Media& from);
@@ -38,6 +51,15 @@ protected:
 	virtual bool do_read(std::uint64_t physical_address, std::uint8_t& data) const = 0;
 	virtual void do_read_buffer(std::uint64_t physical_address, void* buffer, std::size_t size) const = 0;
 
+	//! Default implementation runs @c do_read_buffer on a process-wide pool of I/O threads, so it requires
+	//!   @c do_read_buffer to be thread-safe.
+	virtual std::future<void> do_read_async(std::uint64_t physical_address, void* buffer, std::size_t size) const;
+
+	//! Default implementation reports every successful @c do_read_buffer as backed, and any exception as an I/O
+	//!   error. Implementations that know their holes should override it.
+	virtual read_result do_try_read_buffer(std::uint64_t physical_address, void* buffer,
+	                                       std::size_t size) const noexcept;
+
 }; // class physical_memory
 
 //!
@@ -49,6 +71,18 @@ inline void physical_memory::read_buffer(std::uint64_t physical_address, void* b
 	do_read_buffer(physical_address, buffer, size);
 }
 
+inline std::future<void> physical_memory::read_async(std::uint64_t physical_address, void* buffer,
+                                                     std::size_t size) const
+{
+	return do_read_async(physical_address, buffer, size);
+}
+
+inline read_result physical_memory::try_read_buffer(std::uint64_t physical_address, void* buffer,
+                                                    std::size_t size) const noexcept
+{
+	return do_try_read_buffer(physical_address, buffer, size);
+}
+
 template <typename Media> inline void physical_memory::serialize(Media& to __attribute__((unused))) const
 {
 	// nothing to do
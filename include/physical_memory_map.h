@@ -0,0 +1,85 @@
+//!
+//! @file physical_memory_map.h
+//! @brief Declaration of class @c reven::vmghost::physical_memory_map.
+//!
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "memory_virtualbox.h"
+
+namespace reven {
+namespace vmghost {
+
+//!
+//! A half-open range of physical addresses.
+//!
+struct memory_range {
+	std::uint64_t begin;
+	std::uint64_t end;
+};
+
+//!
+//! The extent of a memory chunk.
+//!
+struct memory_region {
+	//! First address.
+	std::uint64_t begin;
+	//! Past the last address.
+	std::uint64_t end;
+	//! Past the last address whose content is stored in the file (<tt>begin <= backed_end <= end</tt>).
+	std::uint64_t backed_end;
+};
+
+//!
+//! Queryable map of the physical memory layout of a @c MemoryVirtualBox.
+//!
+//! The regions are kept sorted with a prefix sum of their backed bytes, so that every query is a binary search.
+//!   "Backed" bytes are the ones stored in the core file; holes are the addresses outside of any region.
+//!
+//! The map is a snapshot: it does not follow chunks inserted in the memory afterwards.
+//!
+class physical_memory_map {
+public:
+	explicit physical_memory_map(const MemoryVirtualBox& memory);
+
+	//! All the regions, in increasing address order.
+	std::vector<memory_region> const& regions() const { return regions_; }
+
+	//! The regions overlapping [begin, end).
+	std::vector<memory_region> overlapping(std::uint64_t begin, std::uint64_t end) const;
+
+	//! The first backed address not below @c address. Returns false if there is none.
+	bool next_backed(std::uint64_t address, std::uint64_t& backed_address) const;
+
+	//! Total number of backed bytes.
+	std::uint64_t backed_bytes() const { return backed_before_.back(); }
+
+	//! Number of backed bytes in [begin, end).
+	std::uint64_t backed_bytes(std::uint64_t begin, std::uint64_t end) const;
+
+	//! The address of the backed byte of index @c backed_offset, counting backed bytes only. Returns false if
+	//!   @c backed_offset is not below @c backed_bytes().
+	bool backed_address_at(std::uint64_t backed_offset, std::uint64_t& address) const;
+
+	//! The ranges of [begin, end) that are not in any region.
+	std::vector<memory_range> holes(std::uint64_t begin, std::uint64_t end) const;
+
+	//! Splits the mapped address space into at most @c parts consecutive ranges holding the same number of backed
+	//!   bytes, with boundaries aligned on @c alignment (a power of two). Meant to plan parallel scans.
+	std::vector<memory_range> partition(std::size_t parts, std::uint64_t alignment = 0x1000) const;
+
+private:
+	//! Index of the first region whose end is above @c address.
+	std::size_t first_ending_after(std::uint64_t address) const;
+
+	std::vector<memory_region> regions_;
+
+	//! For each region, the number of backed bytes in the regions before it. Ends with the total.
+	std::vector<std::uint64_t> backed_before_;
+
+}; // class physical_memory_map
+}
+} // namespace reven::vmghost
@@ -0,0 +1,88 @@
+//!
+//! @file pointer_chase.h
+//! @brief Walks linked structures in guest virtual memory.
+//!
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "read_queue.h"
+#include "virtual_memory.h"
+
+namespace reven {
+namespace vmghost {
+
+//!
+//! Describes the records of a linked structure.
+//!
+struct pointer_chase_options {
+	//! Size of each record, copied from its start.
+	std::size_t record_size{0};
+	//! Offset of the next pointer in a record.
+	std::size_t next_offset{0};
+	//! Size of the next pointer: 8, or 4 for 32-bit guests.
+	std::size_t pointer_size{8};
+	//! Whether next pointers point to the next pointer of the next record (as `LIST_ENTRY` links do) rather than to
+	//!   the start of the record.
+	bool intrusive_links{false};
+	//! Maximum number of records.
+	std::size_t limit{1024};
+	//! The walk also stops before following a next pointer of this value (e.g. the head of a circular list): a record
+	//!   address, or with @c intrusive_links the address of a link such as the list head's `LIST_ENTRY`. 0: none.
+	std::uint64_t stop_address{0};
+	//! Options of the queue copying the records, when the walk makes its own.
+	read_queue_options queue;
+};
+
+//! Why a walk stopped.
+enum class pointer_chase_stop : std::uint8_t {
+	//! A next pointer was null.
+	null_pointer,
+	//! The walk came back to its first record, or reached @c pointer_chase_options::stop_address.
+	loop,
+	//! @c pointer_chase_options::limit records were read.
+	limit,
+	//! A next pointer led to a record that is not entirely mapped.
+	unmapped,
+};
+
+//!
+//! The records visited by a walk.
+//!
+struct pointer_chase_result {
+	//! Virtual address of the start of each record.
+	std::vector<std::uint64_t> addresses;
+	//! The records, one after the other.
+	std::vector<std::uint8_t> records;
+	std::size_t record_size{0};
+	pointer_chase_stop stop{pointer_chase_stop::null_pointer};
+
+	std::size_t size() const { return addresses.size(); }
+	const std::uint8_t* record(std::size_t index) const { return records.data() + index * record_size; }
+};
+
+//!
+//! Walks the records linked from the record at @c start (a record address, or the address of its next pointer
+//!   with @c pointer_chase_options::intrusive_links).
+//!
+//! Only the next pointer of a record is read before moving on: the copy of record N is queued on a @c read_queue
+//!   and runs while record N+1 is translated. Translations are cached per page for the duration of the walk.
+//!
+//! Throws std::runtime_error if @c start is not mapped, and rethrows the errors of the physical reads.
+//!
+pointer_chase_result chase_pointers(const virtual_memory& memory, std::uint64_t start,
+                                    pointer_chase_options const& options);
+
+//!
+//! Same as the other @c chase_pointers, with the records copied by @c queue, which must read the physical memory of
+//!   @c memory. Reusing a queue across walks saves setting up one per walk (an io_uring ring or a thread pool).
+//!
+//! The walk waits for all the reads of @c queue, including those submitted before it.
+//!
+pointer_chase_result chase_pointers(const virtual_memory& memory, read_queue& queue, std::uint64_t start,
+                                    pointer_chase_options const& options);
+}
+} // namespace reven::vmghost
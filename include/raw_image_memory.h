@@ -0,0 +1,76 @@
+//!
+//! @file raw_image_memory.h
+//! @brief Declares `reven::vmghost::raw_image_memory`, a physical memory read from a flat image file, and the export of
+//!   a core to such a file.
+//!
+
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "core_file.h"
+#include "memory_virtualbox.h"
+#include "physical_memory.h"
+
+namespace reven {
+namespace vmghost {
+
+//!
+//! Physical memory stored in a flat file, where the file offset is the physical address.
+//!
+//! Addresses beyond the end of the file are holes, read as zeros. Reads are positional, so the instance can be
+//!   shared between threads.
+//!
+class raw_image_memory : public physical_memory {
+public:
+	//! Opens @c path. Throws @c std::runtime_error if it cannot be opened.
+	explicit raw_image_memory(std::string const& path);
+
+	//! The size of the image, which is also the end of its address space.
+	std::uint64_t size() const { return size_; }
+
+	const core_file& file() const { return *file_; }
+
+protected:
+	bool do_read(std::uint64_t physical_address, std::uint8_t& data) const override;
+	void do_read_buffer(std::uint64_t physical_address, void* buffer, std::size_t size) const override;
+	read_result do_try_read_buffer(std::uint64_t physical_address, void* buffer,
+	                               std::size_t size) const noexcept override;
+
+private:
+	//! Number of bytes of [physical_address, physical_address + size) inside the image.
+	std::size_t backed_size(std::uint64_t physical_address, std::size_t size) const;
+
+	std::shared_ptr<core_file> file_;
+	std::uint64_t size_;
+
+}; // class raw_image_memory
+
+struct raw_image_options {
+	//! Leaves the all-zero pages of the core as holes instead of copying them. Finding them reads the whole core.
+	bool skip_zero_pages{true};
+};
+
+struct raw_image_stats {
+	//! Size of the image: the end of the highest chunk.
+	std::uint64_t image_size{0};
+	std::uint64_t copied_bytes{0};
+	//! All-zero pages left as holes.
+	std::uint64_t zero_pages{0};
+};
+
+//!
+//! Writes the physical memory of @c memory to @c path as a flat image, where the file offset is the physical address.
+//!
+//! The image is a sparse file: only the data of the chunks is written, copied from file to file with
+//!   @c copy_file_range when the file systems allow it. Unmapped ranges, uninitialized chunk tails, holes of the core
+//!   file (found with @c SEEK_DATA) and, with @c skip_zero_pages, all-zero pages are never written, so they are holes
+//!   of the image and read as zeros.
+//!
+//! Throws @c std::runtime_error if a chunk is not backed by a @c core_file, or on I/O error.
+//!
+raw_image_stats write_raw_image(MemoryVirtualBox const& memory, std::string const& path,
+                                raw_image_options const& options = {});
+}
+} // namespace reven::vmghost
@@ -0,0 +1,79 @@
+//!
+//! @file read_queue.h
+//! @brief Declaration of class @c reven::vmghost::read_queue.
+//!
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+#include "physical_memory.h"
+
+namespace reven {
+namespace vmghost {
+
+//!
+//! Options of a @c read_queue.
+//!
+struct read_queue_options {
+	//! Maximum number of reads in flight. @c submit() blocks while it is reached.
+	std::size_t depth{256};
+
+	//! Number of threads of the thread-pool backend (0: as many as @c depth, capped to 64).
+	std::size_t threads{0};
+
+	//! Use io_uring when the memory is a @c MemoryVirtualBox and the kernel supports it.
+	bool use_io_uring{true};
+};
+
+//!
+//! Submission queue keeping many physical memory reads in flight.
+//!
+//! When reading a @c MemoryVirtualBox backed by core files, reads are turned into io_uring requests on the core
+//!   files. Otherwise, or when io_uring is not available, they are executed by a pool of threads calling
+//!   @c physical_memory::read_buffer, which must then be thread-safe.
+//!
+//! Results are the same as with @c physical_memory::read_buffer. A read that failed rethrows its error from
+//!   @c wait() or @c wait_all().
+//!
+class read_queue {
+public:
+	//! Identifies a submitted read.
+	typedef std::uint64_t token;
+
+	explicit read_queue(const physical_memory& memory, read_queue_options options = read_queue_options());
+
+	read_queue(read_queue const&) = delete;
+	read_queue& operator=(read_queue const&) = delete;
+
+	//! Waits for the reads still in flight (their errors are dropped).
+	~read_queue();
+
+	//! Queues a read of @c size bytes at @c physical_address into @c buffer, which must stay valid until the read
+	//!   is complete.
+	token submit(std::uint64_t physical_address, void* buffer, std::size_t size);
+
+	//! Whether the read identified by @c read is complete. Does not block.
+	bool is_done(token read);
+
+	//! Waits until the read identified by @c read is complete.
+	void wait(token read);
+
+	//! Waits until all submitted reads are complete.
+	void wait_all();
+
+	//! Number of submitted reads that are not complete yet.
+	std::size_t in_flight() const;
+
+	//! Whether reads go through io_uring rather than the thread pool.
+	bool uses_io_uring() const;
+
+	class backend;
+
+private:
+	std::unique_ptr<backend> backend_;
+
+}; // class read_queue
+}
+} // namespace reven::vmghost
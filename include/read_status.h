@@ -0,0 +1,56 @@
+//!
+//! @file read_status.h
+//! @brief Declares the outcome of non-throwing physical memory reads.
+//!
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace reven {
+namespace vmghost {
+
+//!
+//! What a non-throwing read found at the requested range.
+//!
+enum class read_status : std::uint8_t {
+	//! Every byte was read from the backing store.
+	backed,
+	//! Some bytes were read from the backing store, the others are zeros.
+	partially_backed,
+	//! No byte is mapped: the buffer is filled with zeros.
+	hole,
+	//! The bytes are mapped but have no stored content (e.g. a chunk tail beyond its file data): zeros.
+	uninitialized,
+	//! The backing store failed to deliver the data. The bytes not read are zeros.
+	io_error,
+};
+
+//!
+//! Result of a non-throwing read.
+//!
+struct read_result {
+	read_status status;
+	//! Number of bytes actually read from the backing store.
+	std::size_t bytes_read;
+};
+
+//!
+//! The status of a read of @c size bytes, @c bytes_read of which came from the backing store and @c uninitialized
+//!   of which are mapped without content (the rest being holes).
+//!
+inline read_status make_read_status(std::size_t size, std::size_t bytes_read, std::size_t uninitialized)
+{
+	if (bytes_read == size) {
+		return read_status::backed;
+	}
+
+	if (bytes_read > 0) {
+		return read_status::partially_backed;
+	}
+
+	return uninitialized > 0 ? read_status::uninitialized : read_status::hole;
+}
+}
+} // namespace reven::vmghost
@@ -0,0 +1,57 @@
+//!
+//! @file register_export.h
+//! @brief Columnar export of the registers of the CPUs of one or many cores.
+//!
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "core_virtualbox.h"
+#include "register_id.h"
+
+namespace reven {
+namespace vmghost {
+
+//!
+//! Values of a set of registers for a set of CPUs, one column per register and one row per CPU.
+//!
+//! Values are stored column after column, so that @c column(i) is a contiguous array of @c rows() values.
+//!
+struct register_columns {
+	//! The exported registers, one per column.
+	std::vector<register_id> registers;
+
+	//! First row of each exported core, followed by the total number of rows.
+	std::vector<std::size_t> core_rows;
+
+	//! The values, column after column.
+	std::vector<std::uint64_t> values;
+
+	std::size_t rows() const { return core_rows.empty() ? 0 : core_rows.back(); }
+
+	const std::uint64_t* column(std::size_t index) const { return values.data() + index * rows(); }
+
+	std::uint64_t at(std::size_t row, std::size_t column) const { return values[column * rows() + row]; }
+};
+
+//!
+//! Exports @c registers (of at most 8 bytes, see @c cpu_virtualbox::get) for every CPU of @c core, in
+//!   @c cpu_begin() order.
+//!
+//! Throws std::runtime_error if a register is wider than 8 bytes or not stored by the format of the core.
+//!
+register_columns export_registers(const core_virtualbox& core, std::vector<register_id> registers);
+
+//!
+//! Same as the single core @c export_registers, with the rows of @c cores one after the other. Cores are spread
+//!   over @c threads threads (0: one per hardware thread).
+//!
+//! The first exception thrown by a core is rethrown once all threads are done.
+//!
+register_columns export_registers(const std::vector<const core_virtualbox*>& cores,
+                                  std::vector<register_id> registers, std::size_t threads = 0);
+}
+} // namespace reven::vmghost
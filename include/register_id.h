@@ -0,0 +1,222 @@
+//!
+//! @file register_id.h
+//! @brief Register identifiers and their location in a @c reven::vmghost::cpu_virtualbox.
+//!
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "cpu_virtualbox.h"
+
+namespace reven {
+namespace vmghost {
+
+//!
+//! Identifies a register of a @c cpu_virtualbox, for generic accesses through @c cpu_virtualbox::get.
+//!
+enum class register_id : std::uint16_t {
+	rax, rbx, rcx, rdx, rsi, rdi, r8, r9, r10, r11, r12, r13, r14, r15,
+	rip, rsp, rbp, rflags,
+
+	cs, cs_base, cs_limit, cs_attr,
+	ds, ds_base, ds_limit, ds_attr,
+	es, es_base, es_limit, es_attr,
+	fs, fs_base, fs_limit, fs_attr,
+	gs, gs_base, gs_limit, gs_attr,
+	ss, ss_base, ss_limit, ss_attr,
+
+	cr0, cr2, cr3, cr4, cr8,
+	dr0, dr1, dr2, dr3, dr4, dr5, dr6, dr7,
+
+	gdtr_base, gdtr_limit, idtr_base, idtr_limit,
+	ldtr, ldtr_base, ldtr_limit, ldtr_attr,
+	tr, tr_base, tr_limit, tr_attr,
+
+	sysenter_cs, sysenter_eip, sysenter_esp,
+
+	msr_efer, msr_star, msr_pat, msr_lstar, msr_cstar, msr_sfmask, msr_kernel_gs_base, msr_apic_base, msr_tsc_aux,
+	xcr0, xcr1,
+
+	fpu_control_word, fpu_status_word, fpu_abridged_tags, fpu_fop, fpu_ip, fpu_cs, fpu_dp, fpu_ds,
+	mxcsr, mxcsr_mask,
+
+	//! Raw 80-bit x87 registers, in stack order as stored by FXSAVE.
+	st0, st1, st2, st3, st4, st5, st6, st7,
+	xmm0, xmm1, xmm2, xmm3, xmm4, xmm5, xmm6, xmm7,
+	xmm8, xmm9, xmm10, xmm11, xmm12, xmm13, xmm14, xmm15,
+
+	count
+};
+
+//! Where the bytes of a register are stored.
+enum class register_location : std::uint8_t {
+	//! In @c cpu_hot_state.
+	hot_state,
+	//! In the XSAVE area (@c vbox::X86XSAVEAREA), loaded on first access.
+	extended_state,
+};
+
+//!
+//! Static description of a register.
+//!
+struct register_info {
+	register_id id;
+	const char* name;
+	register_location location;
+	std::uint16_t offset;
+	std::uint8_t size;
+	//! First core format version storing the register.
+	std::uint32_t since_version;
+};
+
+#define RVN_REGISTER_INFO(location, type, name, member, size, version) \
+	{ register_id::name, #name, register_location::location, offsetof(type, member), size, version }
+#define RVN_HOT_REGISTER(name, member, size) \
+	RVN_REGISTER_INFO(hot_state, cpu_hot_state, name, member, size, vbox::DBGFCORE_FMT_VERSION_COMPAT)
+#define RVN_EXT_REGISTER(name, member, size) \
+	RVN_REGISTER_INFO(extended_state, vbox::X86XSAVEAREA, name, member, size, vbox::DBGFCORE_FMT_VERSION_COMPAT)
+#define RVN_SELECTOR_REGISTERS(name) \
+	RVN_HOT_REGISTER(name, base.name.uSel, 2), \
+	RVN_HOT_REGISTER(name##_base, base.name.uBase, 8), \
+	RVN_HOT_REGISTER(name##_limit, base.name.uLimit, 4), \
+	RVN_HOT_REGISTER(name##_attr, base.name.uAttr, 4)
+
+//! Description of every register, indexed by @c register_id.
+constexpr register_info register_table[] = {
+	RVN_HOT_REGISTER(rax, base.rax, 8),
+	RVN_HOT_REGISTER(rbx, base.rbx, 8),
+	RVN_HOT_REGISTER(rcx, base.rcx, 8),
+	RVN_HOT_REGISTER(rdx, base.rdx, 8),
+	RVN_HOT_REGISTER(rsi, base.rsi, 8),
+	RVN_HOT_REGISTER(rdi, base.rdi, 8),
+	RVN_HOT_REGISTER(r8, base.r8, 8),
+	RVN_HOT_REGISTER(r9, base.r9, 8),
+	RVN_HOT_REGISTER(r10, base.r10, 8),
+	RVN_HOT_REGISTER(r11, base.r11, 8),
+	RVN_HOT_REGISTER(r12, base.r12, 8),
+	RVN_HOT_REGISTER(r13, base.r13, 8),
+	RVN_HOT_REGISTER(r14, base.r14, 8),
+	RVN_HOT_REGISTER(r15, base.r15, 8),
+	RVN_HOT_REGISTER(rip, base.rip, 8),
+	RVN_HOT_REGISTER(rsp, base.rsp, 8),
+	RVN_HOT_REGISTER(rbp, base.rbp, 8),
+	RVN_HOT_REGISTER(rflags, base.rflags, 8),
+
+	RVN_SELECTOR_REGISTERS(cs),
+	RVN_SELECTOR_REGISTERS(ds),
+	RVN_SELECTOR_REGISTERS(es),
+	RVN_SELECTOR_REGISTERS(fs),
+	RVN_SELECTOR_REGISTERS(gs),
+	RVN_SELECTOR_REGISTERS(ss),
+
+	RVN_HOT_REGISTER(cr0, base.cr0, 8),
+	RVN_HOT_REGISTER(cr2, base.cr2, 8),
+	RVN_HOT_REGISTER(cr3, base.cr3, 8),
+	RVN_HOT_REGISTER(cr4, base.cr4, 8),
+	RVN_HOT_REGISTER(cr8, tetrane.cr8, 8),
+	RVN_HOT_REGISTER(dr0, base.dr[0], 8),
+	RVN_HOT_REGISTER(dr1, base.dr[1], 8),
+	RVN_HOT_REGISTER(dr2, base.dr[2], 8),
+	RVN_HOT_REGISTER(dr3, base.dr[3], 8),
+	RVN_HOT_REGISTER(dr4, base.dr[4], 8),
+	RVN_HOT_REGISTER(dr5, base.dr[5], 8),
+	RVN_HOT_REGISTER(dr6, base.dr[6], 8),
+	RVN_HOT_REGISTER(dr7, base.dr[7], 8),
+
+	RVN_HOT_REGISTER(gdtr_base, base.gdtr.uAddr, 8),
+	RVN_HOT_REGISTER(gdtr_limit, base.gdtr.cb, 4),
+	RVN_HOT_REGISTER(idtr_base, base.idtr.uAddr, 8),
+	RVN_HOT_REGISTER(idtr_limit, base.idtr.cb, 4),
+	RVN_SELECTOR_REGISTERS(ldtr),
+	RVN_SELECTOR_REGISTERS(tr),
+
+	RVN_HOT_REGISTER(sysenter_cs, base.sysenter.cs, 8),
+	RVN_HOT_REGISTER(sysenter_eip, base.sysenter.eip, 8),
+	RVN_HOT_REGISTER(sysenter_esp, base.sysenter.esp, 8),
+
+	RVN_HOT_REGISTER(msr_efer, base.msrEFER, 8),
+	RVN_HOT_REGISTER(msr_star, base.msrSTAR, 8),
+	RVN_HOT_REGISTER(msr_pat, base.msrPAT, 8),
+	RVN_HOT_REGISTER(msr_lstar, base.msrLSTAR, 8),
+	RVN_HOT_REGISTER(msr_cstar, base.msrCSTAR, 8),
+	RVN_HOT_REGISTER(msr_sfmask, base.msrSFMASK, 8),
+	RVN_HOT_REGISTER(msr_kernel_gs_base, base.msrKernelGSBase, 8),
+	RVN_HOT_REGISTER(msr_apic_base, base.msrApicBase, 8),
+	RVN_REGISTER_INFO(hot_state, cpu_hot_state, msr_tsc_aux, msrTscAux, 8, vbox::DBGFCORE_FMT_VERSIONv6),
+	RVN_HOT_REGISTER(xcr0, aXcr[0], 8),
+	RVN_HOT_REGISTER(xcr1, aXcr[1], 8),
+
+	RVN_EXT_REGISTER(fpu_control_word, x87.FCW, 2),
+	RVN_EXT_REGISTER(fpu_status_word, x87.FSW, 2),
+	RVN_EXT_REGISTER(fpu_abridged_tags, x87.FTW, 1),
+	RVN_EXT_REGISTER(fpu_fop, x87.FOP, 2),
+	RVN_EXT_REGISTER(fpu_ip, x87.FPUIP, 4),
+	RVN_EXT_REGISTER(fpu_cs, x87.CS, 2),
+	RVN_EXT_REGISTER(fpu_dp, x87.FPUDP, 4),
+	RVN_EXT_REGISTER(fpu_ds, x87.DS, 2),
+	RVN_EXT_REGISTER(mxcsr, x87.MXCSR, 4),
+	RVN_EXT_REGISTER(mxcsr_mask, x87.MXCSR_MASK, 4),
+
+	RVN_EXT_REGISTER(st0, x87.aRegs[0], 10),
+	RVN_EXT_REGISTER(st1, x87.aRegs[1], 10),
+	RVN_EXT_REGISTER(st2, x87.aRegs[2], 10),
+	RVN_EXT_REGISTER(st3, x87.aRegs[3], 10),
+	RVN_EXT_REGISTER(st4, x87.aRegs[4], 10),
+	RVN_EXT_REGISTER(st5, x87.aRegs[5], 10),
+	RVN_EXT_REGISTER(st6, x87.aRegs[6], 10),
+	RVN_EXT_REGISTER(st7, x87.aRegs[7], 10),
+	RVN_EXT_REGISTER(xmm0, x87.aXMM[0], 16),
+	RVN_EXT_REGISTER(xmm1, x87.aXMM[1], 16),
+	RVN_EXT_REGISTER(xmm2, x87.aXMM[2], 16),
+	RVN_EXT_REGISTER(xmm3, x87.aXMM[3], 16),
+	RVN_EXT_REGISTER(xmm4, x87.aXMM[4], 16),
+	RVN_EXT_REGISTER(xmm5, x87.aXMM[5], 16),
+	RVN_EXT_REGISTER(xmm6, x87.aXMM[6], 16),
+	RVN_EXT_REGISTER(xmm7, x87.aXMM[7], 16),
+	RVN_EXT_REGISTER(xmm8, x87.aXMM[8], 16),
+	RVN_EXT_REGISTER(xmm9, x87.aXMM[9], 16),
+	RVN_EXT_REGISTER(xmm10, x87.aXMM[10], 16),
+	RVN_EXT_REGISTER(xmm11, x87.aXMM[11], 16),
+	RVN_EXT_REGISTER(xmm12, x87.aXMM[12], 16),
+	RVN_EXT_REGISTER(xmm13, x87.aXMM[13], 16),
+	RVN_EXT_REGISTER(xmm14, x87.aXMM[14], 16),
+	RVN_EXT_REGISTER(xmm15, x87.aXMM[15], 16),
+};
+
+#undef RVN_SELECTOR_REGISTERS
+#undef RVN_EXT_REGISTER
+#undef RVN_HOT_REGISTER
+#undef RVN_REGISTER_INFO
+
+namespace detail {
+
+constexpr bool is_register_table_sorted()
+{
+	for (std::size_t i = 0; i < sizeof(register_table) / sizeof(*register_table); ++i) {
+		if (static_cast<std::size_t>(register_table[i].id) != i) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+} // namespace detail
+
+static_assert(sizeof(register_table) / sizeof(*register_table) == static_cast<std::size_t>(register_id::count),
+              "register_table misses registers");
+static_assert(detail::is_register_table_sorted(), "register_table must be in register_id order");
+
+//! Description of @c id.
+constexpr const register_info& get_register_info(register_id id)
+{
+	return register_table[static_cast<std::size_t>(id)];
+}
+
+//! The register named @c name (as in @c register_info::name). Returns false if there is none.
+bool find_register(std::string const& name, register_id& id);
+}
+} // namespace reven::vmghost
@@ -0,0 +1,65 @@
+//!
+//! @file streaming_reader.h
+//! @brief Declaration of class @c reven::vmghost::streaming_reader.
+//!
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "memory_virtualbox.h"
+
+namespace reven {
+namespace vmghost {
+
+//!
+//! Options of a @c streaming_reader.
+//!
+struct streaming_options {
+	//! Maximum number of bytes delivered per batch. Rounded up to a multiple of the page size.
+	std::size_t batch_size{8 * 1024 * 1024};
+
+	//! Bypass the page cache with @c O_DIRECT. If the file system refuses it, the reader falls back to buffered
+	//!   reads and drops every batch from the page cache once delivered.
+	bool direct_io{true};
+};
+
+//!
+//! One-shot sequential reader over all the file-backed memory of a @c MemoryVirtualBox.
+//!
+//! Chunks are read in increasing physical address order, in page-aligned batches, with the read of batch N+1 running
+//!   on a background thread while batch N is handed to the visitor. It is meant for whole-core scans (hashing,
+//!   export) that must not evict the page cache of the host.
+//!
+//! Uninitialized chunk tails (memory size greater than file size) and holes are not delivered.
+//!
+class streaming_reader {
+public:
+	//! Receives a batch: its physical address, its data and its size. The data is only valid during the call.
+	typedef std::function<void(std::uint64_t physical_address, const std::uint8_t* data, std::size_t size)> batch_visitor;
+
+	explicit streaming_reader(const MemoryVirtualBox& memory, streaming_options options = streaming_options());
+
+	//! Streams the whole memory to @c visitor. Exceptions thrown by the visitor or by the reads are propagated.
+	void run(batch_visitor visitor) const;
+
+	//! Total number of bytes that @c run() delivers.
+	std::uint64_t size() const;
+
+private:
+	struct batch {
+		const core_file* file;
+		std::uint64_t offset_in_file;
+		std::uint64_t physical_address;
+		std::size_t size;
+	};
+
+	std::vector<MemoryChunk> chunks_;
+	std::vector<batch> batches_;
+	streaming_options options_;
+
+}; // class streaming_reader
+}
+} // namespace reven::vmghost
@@ -0,0 +1,113 @@
+//!
+//! @file synthetic_core.h
+//! @brief Generation of reproducible VirtualBox cores of any size, for benchmarks and scale tests.
+//!
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "core_virtualbox_def.h"
+#include "cpu_virtualbox.h"
+#include "physical_memory.h"
+#include "physical_memory_map.h"
+
+namespace reven {
+namespace vmghost {
+
+//!
+//! Shape of a synthetic core. The same options always produce the same core.
+//!
+struct synthetic_core_options {
+	//! Backed memory, rounded up to pages and split evenly between the segments.
+	std::uint64_t memory_size{64 << 20};
+	std::size_t segment_count{1};
+	//! Hole between two segments, rounded up to pages.
+	std::uint64_t gap_size{1 << 20};
+
+	std::size_t cpu_count{1};
+	//! One of @c vbox::DBGFCORE_FMT_VERSION_COMPAT, @c vbox::DBGFCORE_FMT_VERSIONv5 or @c vbox::DBGFCORE_FMT_VERSIONv6.
+	std::uint32_t version{vbox::DBGFCORE_FMT_VERSIONv6};
+
+	//! Start of the virtual range mapped by the IA-32e page tables. Must be canonical and aligned on 512 GiB.
+	std::uint64_t virtual_base{0xfffff80000000000};
+	//! Size of the mapped virtual range, rounded up to pages. Virtual pages map the data pages in order, wrapping
+	//!   around if there are fewer data pages.
+	std::uint64_t mapped_size{16 << 20};
+
+	//! Fractions of the data pages that are all zeros, and that are copies of a few shared pages.
+	double zero_page_ratio{0.1};
+	double duplicate_page_ratio{0.1};
+
+	std::uint64_t seed{1};
+};
+
+//!
+//! Physical memory of a synthetic core, computed on the fly.
+//!
+//! The first segment starts at address 0. The page tables follow the first backed page: the PML4, then the PDPTs,
+//!   PDs and PTs, in as many segments as they need. Every other backed page is a data page: zeros, a copy of one of 16 shared pages,
+//!   or pseudo-random bytes unique to the page, depending on the options.
+//!
+class synthetic_memory : public physical_memory {
+public:
+	static constexpr std::size_t page_size = 0x1000;
+
+	//! Throws @c std::invalid_argument if the options can't make a core.
+	explicit synthetic_memory(synthetic_core_options const& options);
+
+	synthetic_core_options const& options() const { return options_; }
+
+	//! The backed ranges, in increasing order.
+	std::vector<memory_range> const& segments() const { return segments_; }
+
+	//! Physical address of the PML4, for CR3.
+	std::uint64_t page_table_root() const { return backed_page_address(table_first_page_); }
+
+	//! Physical address of the backed page of index @c page (in the order of the segments).
+	std::uint64_t backed_page_address(std::uint64_t page) const;
+
+	//! Physical address that the virtual address @c virtual_address maps to. It must be in the mapped range.
+	std::uint64_t translate(std::uint64_t virtual_address) const;
+
+protected:
+	bool do_read(std::uint64_t physical_address, std::uint8_t& data) const override;
+	void do_read_buffer(std::uint64_t physical_address, void* buffer, std::size_t size) const override;
+	read_result do_try_read_buffer(std::uint64_t physical_address, void* buffer,
+	                               std::size_t size) const noexcept override;
+
+private:
+	//! Writes the page of backed index @c page to @c data.
+	void fill_page(std::uint64_t page, std::uint8_t* data) const;
+
+	synthetic_core_options options_;
+	std::vector<memory_range> segments_;
+	//! For each segment, the backed index of its first page. Ends with the number of backed pages.
+	std::vector<std::uint64_t> first_page_;
+
+	std::uint64_t mapped_pages_;
+	std::uint64_t pdpt_count_;
+	std::uint64_t pd_count_;
+	std::uint64_t pt_count_;
+	//! Backed index of the PML4. The other tables follow it.
+	std::uint64_t table_first_page_{1};
+	//! Backed index of the first data page after the tables.
+	std::uint64_t tables_end_page_;
+
+}; // class synthetic_memory
+
+//!
+//! The CPU @c index of a synthetic core of @c memory: in 64-bit mode with paging on, its page tables in CR3, and
+//!   recognizable values in its other registers.
+//!
+cpu_virtualbox synthetic_cpu(synthetic_memory const& memory, std::size_t index);
+
+//!
+//! Writes the synthetic core described by @c options to @c path.
+//!
+void write_synthetic_core(std::string const& path, synthetic_core_options const& options);
+}
+} // namespace reven::vmghost
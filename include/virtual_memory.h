@@ -0,0 +1,99 @@
+//!
+//! @file virtual_memory.h
+//! @brief Declares `reven::vmghost::virtual_memory`, which translates guest virtual addresses.
+//!
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "cpu_virtualbox.h"
+#include "physical_memory.h"
+
+namespace reven {
+namespace vmghost {
+
+//!
+//! How a CPU translates virtual addresses.
+//!
+enum class paging_mode : std::uint8_t {
+	//! Virtual addresses are physical addresses.
+	none,
+	//! 32-bit paging, with 4 MiB pages when CR4.PSE is set.
+	legacy,
+	//! PAE paging, 3 levels.
+	pae,
+	//! IA-32e paging, 4 levels.
+	ia32e,
+	//! IA-32e paging, 5 levels (CR4.LA57).
+	ia32e_la57,
+};
+
+//! The paging mode @c cpu is in.
+paging_mode get_paging_mode(const cpu_virtualbox& cpu);
+
+//!
+//! Reads guest memory through the page tables of an address space.
+//!
+//! Page table entries are read from the physical memory on each translation: there is no cache, so that the
+//!   instance only costs the few fields it stores and can be built for every CPU of every core.
+//!
+class virtual_memory {
+public:
+	//! The address space @c cpu is currently in.
+	virtual_memory(const physical_memory& memory, const cpu_virtualbox& cpu);
+
+	//! The address space whose page tables start at @c cr3.
+	virtual_memory(const physical_memory& memory, std::uint64_t cr3, paging_mode mode, bool pse = true);
+
+	const physical_memory& physical() const { return memory_; }
+	std::uint64_t cr3() const { return cr3_; }
+	paging_mode mode() const { return mode_; }
+
+	//!
+	//! Translates @c virtual_address. Returns false if it is not mapped (or not canonical).
+	//!
+	//! @param page_size Receives the size of the page mapping @c virtual_address.
+	//!
+	bool translate(std::uint64_t virtual_address, std::uint64_t& physical_address, std::uint64_t& page_size) const;
+
+	bool translate(std::uint64_t virtual_address, std::uint64_t& physical_address) const
+	{
+		std::uint64_t page_size;
+		return translate(virtual_address, physical_address, page_size);
+	}
+
+	//!
+	//! Reads @c size bytes at @c virtual_address, with one physical read per physically contiguous run of pages.
+	//!
+	//! Throws std::runtime_error if a page of the range is not mapped.
+	//!
+	void read_buffer(std::uint64_t virtual_address, void* buffer, std::size_t size) const;
+
+	//!
+	//! Same as @c read_buffer, but stops at the first page that is not mapped or can't be read, and returns the
+	//!   number of bytes read. The remaining bytes are set to zero.
+	//!
+	std::size_t try_read_buffer(std::uint64_t virtual_address, void* buffer, std::size_t size) const noexcept;
+
+	template <typename DataType> DataType read(std::uint64_t virtual_address) const
+	{
+		DataType data;
+		read_buffer(virtual_address, &data, sizeof(data));
+		return data;
+	}
+
+private:
+	std::uint64_t read_entry(std::uint64_t physical_address) const;
+
+	//! The physical run starting at @c virtual_address, up to @c size bytes. Returns 0 if it is not mapped.
+	std::size_t physical_run(std::uint64_t virtual_address, std::size_t size, std::uint64_t& physical_address) const;
+
+	const physical_memory& memory_;
+	std::uint64_t cr3_;
+	paging_mode mode_;
+	bool pse_;
+};
+}
+} // namespace reven::vmghost
@@ -0,0 +1,113 @@
+//!
+//! @file xsave.h
+//! @brief Decoding of the XSAVE area of a VirtualBox CPU context.
+//!
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "core_virtualbox_def.h"
+
+namespace reven {
+namespace vmghost {
+
+//! A 128-bit vector register, in memory order (byte 0 is the least significant).
+struct vector128 {
+	std::uint8_t bytes[16];
+};
+
+//! A 256-bit vector register, in memory order.
+struct vector256 {
+	std::uint8_t bytes[32];
+};
+
+//! A 512-bit vector register, in memory order.
+struct vector512 {
+	std::uint8_t bytes[64];
+};
+
+namespace xsave {
+
+//! XSAVE state components, as numbered in XSTATE_BV and XCOMP_BV.
+enum component : unsigned {
+	x87 = 0,
+	sse = 1,
+	//! Upper halves of YMM0-15.
+	ymm_hi128 = 2,
+	bndregs = 3,
+	bndcsr = 4,
+	//! K0-K7.
+	opmask = 5,
+	//! Upper halves of ZMM0-15.
+	zmm_hi256 = 6,
+	//! ZMM16-31.
+	hi16_zmm = 7,
+	pt = 8,
+	pkru = 9,
+};
+
+//! XCOMP_BV bit telling that the area uses the compacted format.
+static constexpr std::uint64_t compacted_format = 1ull << 63;
+
+} // namespace xsave
+
+//!
+//! Reads the state components of an XSAVE area, in standard or compacted format.
+//!
+//! Components absent from XSTATE_BV are in their initial state and read as zeros. Components whose location can't be
+//!   computed (in compacted format, after a component of unknown size) or that don't fit in the area throw
+//!   @c std::runtime_error.
+//!
+class xsave_decoder {
+public:
+	explicit xsave_decoder(const vbox::X86XSAVEAREA& area) : area_(area) {}
+
+	//! Components present in the area.
+	std::uint64_t xstate_bv() const { return area_.Hdr.bmXState; }
+
+	//! Components stored in a compacted area, with bit 63 set for the compacted format.
+	std::uint64_t xcomp_bv() const { return area_.Hdr.bmXComp; }
+
+	bool is_compacted() const { return xcomp_bv() & xsave::compacted_format; }
+
+	//! Whether @c component holds a value other than its initial state.
+	bool is_present(unsigned component) const { return component < 63 and ((xstate_bv() >> component) & 1); }
+
+	//! Location of an extended @c component (2 and above) in the area, or null if it is in its initial state.
+	const std::uint8_t* component_data(unsigned component) const;
+
+	//! XMM0-15, from the legacy region.
+	vector128 xmm(std::uint8_t index) const;
+
+	//! YMM0-15: XMM and the upper halves from the YMM_Hi128 component.
+	vector256 ymm(std::uint8_t index) const;
+
+	//! ZMM0-31: ZMM0-15 are built from YMM and ZMM_Hi256, ZMM16-31 come from Hi16_ZMM.
+	vector512 zmm(std::uint8_t index) const;
+
+	//! K0-7.
+	std::uint64_t opmask(std::uint8_t index) const;
+
+	//! @name Bulk accessors
+	//! @{
+
+	void ymm_registers(vector256 (&registers)[16]) const;
+	void zmm_registers(vector512 (&registers)[32]) const;
+	void opmask_registers(std::uint64_t (&registers)[8]) const;
+
+	//! @}
+
+	//! Size of @c component in bytes, or 0 if unknown.
+	static std::size_t component_size(unsigned component);
+
+	//! Offset of @c component in a standard format area, or 0 if unknown.
+	static std::size_t standard_offset(unsigned component);
+
+private:
+	const vbox::X86XSAVEAREA& area_;
+
+}; // class xsave_decoder
+}
+} // namespace reven::vmghost
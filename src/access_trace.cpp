@@ -0,0 +1,363 @@
+#include <access_trace.h>
+
+#include <core_file.h>
+
+#include "output_file.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace reven {
+namespace vmghost {
+
+namespace {
+
+constexpr char trace_magic[8] = { 'R', 'V', 'N', 'T', 'R', 'A', 'C', 'E' };
+constexpr std::uint32_t trace_version = 1;
+
+struct trace_header {
+	char magic[8];
+	std::uint32_t version;
+	std::uint32_t record_size;
+};
+
+std::uint64_t next_trace_id()
+{
+	static std::atomic<std::uint64_t> next{1};
+	return next++;
+}
+
+std::uint64_t nanoseconds_since(std::chrono::steady_clock::time_point start)
+{
+	return static_cast<std::uint64_t>(
+	    std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+}
+
+} // anonymous namespace
+
+traced_memory::traced_memory(std::shared_ptr<const physical_memory> memory, std::string const& path,
+                             access_trace_options const& options)
+	: memory_(std::move(memory)), options_(options), id_(next_trace_id()), start_(std::chrono::steady_clock::now())
+{
+	if (options_.sample_period == 0 or options_.buffer_records == 0) {
+		throw std::invalid_argument("The sample period and buffer size must not be 0.");
+	}
+
+	file_.reset(new output_file(path));
+
+	trace_header header;
+	std::memcpy(header.magic, trace_magic, sizeof(header.magic));
+	header.version = trace_version;
+	header.record_size = sizeof(access_record);
+	file_->append(header);
+	file_->flush();
+}
+
+traced_memory::~traced_memory()
+{
+	try {
+		flush();
+	} catch (...) {
+	}
+}
+
+void traced_memory::flush()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	for (auto& entry : buffers_) {
+		write(*entry.second);
+	}
+
+	file_->flush();
+
+	if (error_) {
+		std::rethrow_exception(error_);
+	}
+}
+
+std::uint64_t traced_memory::recorded() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return written_;
+}
+
+traced_memory::thread_buffer& traced_memory::local() const
+{
+	// The buffer of the last traced memory the thread read.
+	thread_local std::uint64_t cached_id = 0;
+	thread_local thread_buffer* cached_buffer = nullptr;
+
+	if (cached_id != id_) {
+		std::lock_guard<std::mutex> lock(mutex_);
+
+		auto& entry = buffers_[std::this_thread::get_id()];
+
+		if (not entry) {
+			entry.reset(new thread_buffer{ static_cast<std::uint16_t>(buffers_.size() - 1), 1, {} });
+			entry->records.reserve(options_.buffer_records);
+		}
+
+		cached_buffer = entry.get();
+		cached_id = id_;
+	}
+
+	return *cached_buffer;
+}
+
+void traced_memory::record(access_kind kind, std::uint64_t physical_address, std::size_t size) const
+{
+	try {
+		thread_buffer& buffer = local();
+
+		if (--buffer.countdown != 0) {
+			return;
+		}
+
+		buffer.countdown = options_.sample_period;
+
+		if (full_.load(std::memory_order_relaxed)) {
+			dropped_.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+
+		buffer.records.push_back(access_record{ physical_address, nanoseconds_since(start_),
+		                                        static_cast<std::uint32_t>(size), buffer.thread, kind, 0 });
+
+		if (buffer.records.size() >= options_.buffer_records) {
+			std::lock_guard<std::mutex> lock(mutex_);
+			write(buffer);
+		}
+	} catch (...) {
+		std::lock_guard<std::mutex> lock(mutex_);
+
+		if (not error_) {
+			error_ = std::current_exception();
+		}
+	}
+}
+
+void traced_memory::write(thread_buffer& buffer) const
+{
+	std::uint64_t count = buffer.records.size();
+
+	if (options_.max_records != 0) {
+		count = std::min(count, options_.max_records - written_);
+	}
+
+	// Empty the buffer even if the write fails, so that a failing file doesn't make it grow.
+	std::vector<access_record> records;
+	records.reserve(options_.buffer_records);
+	records.swap(buffer.records);
+
+	dropped_.fetch_add(records.size() - count, std::memory_order_relaxed);
+	written_ += count;
+
+	if (options_.max_records != 0 and written_ == options_.max_records) {
+		full_.store(true, std::memory_order_relaxed);
+	}
+
+	file_->append(records.data(), static_cast<std::size_t>(count * sizeof(access_record)));
+}
+
+bool traced_memory::do_read(std::uint64_t physical_address, std::uint8_t& data) const
+{
+	record(access_kind::read, physical_address, 1);
+	return memory_->read(physical_address, data);
+}
+
+void traced_memory::do_read_buffer(std::uint64_t physical_address, void* buffer, std::size_t size) const
+{
+	record(access_kind::read_buffer, physical_address, size);
+	memory_->read_buffer(physical_address, buffer, size);
+}
+
+std::future<void> traced_memory::do_read_async(std::uint64_t physical_address, void* buffer, std::size_t size) const
+{
+	record(access_kind::read_async, physical_address, size);
+	return memory_->read_async(physical_address, buffer, size);
+}
+
+read_result traced_memory::do_try_read_buffer(std::uint64_t physical_address, void* buffer,
+                                              std::size_t size) const noexcept
+{
+	record(access_kind::try_read_buffer, physical_address, size);
+	return memory_->try_read_buffer(physical_address, buffer, size);
+}
+
+std::vector<access_record> read_access_trace(std::string const& path)
+{
+	core_file file(path);
+	const std::uint64_t size = file.size();
+
+	trace_header header;
+
+	if (size < sizeof(header)) {
+		throw std::runtime_error("Not an access trace: " + path);
+	}
+
+	file.read(0, &header, sizeof(header));
+
+	if (std::memcmp(header.magic, trace_magic, sizeof(header.magic)) != 0) {
+		throw std::runtime_error("Not an access trace: " + path);
+	}
+
+	if (header.version != trace_version or header.record_size != sizeof(access_record)) {
+		throw std::runtime_error("Unsupported access trace version: " + path);
+	}
+
+	if ((size - sizeof(header)) % sizeof(access_record) != 0) {
+		throw std::runtime_error("Truncated access trace: " + path);
+	}
+
+	std::vector<access_record> records(static_cast<std::size_t>((size - sizeof(header)) / sizeof(access_record)));
+	file.read(sizeof(header), records.data(), records.size() * sizeof(access_record));
+
+	std::stable_sort(records.begin(), records.end(),
+	                 [](access_record const& a, access_record const& b) { return a.thread < b.thread; });
+
+	return records;
+}
+
+namespace {
+
+//! Executes @c record against @c memory through @c buffer. Returns false on error.
+bool replay_record(physical_memory const& memory, access_record const& record, std::uint8_t* buffer)
+{
+	try {
+		switch (record.kind) {
+			case access_kind::read:
+				memory.read(record.physical_address, buffer[0]);
+				return true;
+			case access_kind::read_buffer:
+				memory.read_buffer(record.physical_address, buffer, record.size);
+				return true;
+			case access_kind::try_read_buffer:
+				return memory.try_read_buffer(record.physical_address, buffer, record.size).status !=
+				       read_status::io_error;
+			case access_kind::read_async:
+				memory.read_async(record.physical_address, buffer, record.size).get();
+				return true;
+		}
+	} catch (...) {
+	}
+
+	return false;
+}
+
+} // anonymous namespace
+
+replay_result replay_access_trace(physical_memory const& memory, std::vector<access_record> const& records,
+                                  replay_options const& options)
+{
+	replay_result result;
+
+	// The reads of each replay thread, keeping the order of each recorded thread.
+	std::vector<const access_record*> ordered;
+	ordered.reserve(records.size());
+
+	for (auto const& record : records) {
+		ordered.push_back(&record);
+	}
+
+	std::stable_sort(ordered.begin(), ordered.end(),
+	                 [](const access_record* a, const access_record* b) { return a->thread < b->thread; });
+
+	std::vector<std::vector<const access_record*>> work;
+	std::size_t buffer_size = 1;
+
+	for (std::size_t i = 0; i < ordered.size(); ++i) {
+		const access_record& record = *ordered[i];
+
+		std::size_t worker;
+
+		if (options.threads != 0) {
+			worker = record.thread % options.threads;
+		} else {
+			// A new replay thread for each recorded thread.
+			worker = work.size() - (i != 0 and ordered[i - 1]->thread == record.thread);
+		}
+
+		if (worker >= work.size()) {
+			work.resize(worker + 1);
+		}
+
+		work[worker].push_back(&record);
+
+		result.reads += 1;
+		result.bytes += record.kind == access_kind::read ? 1 : record.size;
+		buffer_size = std::max<std::size_t>(buffer_size, record.size);
+	}
+
+	const std::size_t rounds = std::max<std::size_t>(1, options.rounds);
+
+	std::vector<std::vector<std::uint64_t>> latencies(work.size());
+	std::vector<std::uint64_t> errors(work.size(), 0);
+
+	for (std::size_t worker = 0; worker < work.size(); ++worker) {
+		latencies[worker].reserve(work[worker].size() * rounds);
+	}
+
+	for (std::size_t round = 0; round < rounds; ++round) {
+		std::vector<std::thread> threads;
+		const auto start = std::chrono::steady_clock::now();
+
+		for (std::size_t worker = 0; worker < work.size(); ++worker) {
+			threads.emplace_back([&, worker]() {
+				std::vector<std::uint8_t> buffer(buffer_size);
+
+				for (const access_record* record : work[worker]) {
+					const auto read_start = std::chrono::steady_clock::now();
+
+					if (not replay_record(memory, *record, buffer.data())) {
+						++errors[worker];
+					}
+
+					latencies[worker].push_back(nanoseconds_since(read_start));
+				}
+			});
+		}
+
+		for (auto& thread : threads) {
+			thread.join();
+		}
+
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		if (round == 0 or seconds < result.seconds) {
+			result.seconds = seconds;
+		}
+	}
+
+	std::vector<std::uint64_t> all;
+	all.reserve(result.reads * rounds);
+
+	for (std::size_t worker = 0; worker < work.size(); ++worker) {
+		all.insert(all.end(), latencies[worker].begin(), latencies[worker].end());
+		result.errors += errors[worker];
+	}
+
+	if (all.empty()) {
+		return result;
+	}
+
+	for (auto ns : all) {
+		++result.latency_ns[memory_stats::latency_bucket(ns)];
+	}
+
+	auto percentile = [&all](std::size_t per_mille) {
+		auto nth = all.begin() + static_cast<std::ptrdiff_t>((all.size() - 1) * per_mille / 1000);
+		std::nth_element(all.begin(), nth, all.end());
+		return *nth;
+	};
+
+	result.latency_p50_ns = percentile(500);
+	result.latency_p90_ns = percentile(900);
+	result.latency_p99_ns = percentile(990);
+	result.latency_max_ns = *std::max_element(all.begin(), all.end());
+
+	return result;
+}
+}
+} // namespace reven::vmghost
@@ -0,0 +1,106 @@
+#include <core_file.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+namespace reven {
+namespace vmghost {
+
+core_file::core_file(std::string const& path) : path_(path)
+{
+	fd_ = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+	if (fd_ < 0) {
+		throw std::runtime_error("Can't open the core file.");
+	}
+}
+
+core_file::~core_file()
+{
+	if (mapping_) {
+		::munmap(const_cast<std::uint8_t*>(mapping_), mapping_size_);
+	}
+
+	::close(fd_);
+}
+
+std::uint64_t core_file::size() const
+{
+	struct stat st;
+
+	if (::fstat(fd_, &st) != 0) {
+		throw std::runtime_error(std::string("Can't stat the core file: ") + std::strerror(errno));
+	}
+
+	return st.st_size;
+}
+
+void core_file::read(std::uint64_t offset, void* buffer, std::uint64_t size) const
+{
+	if (try_read(offset, buffer, size) == size) {
+		return;
+	}
+
+	if (errno != 0) {
+		throw std::runtime_error(std::string("Can't read the core file: ") + std::strerror(errno));
+	}
+
+	throw std::runtime_error("Unexpected end of core file.");
+}
+
+std::uint64_t core_file::try_read(std::uint64_t offset, void* buffer, std::uint64_t size) const noexcept
+{
+	auto output = static_cast<char*>(buffer);
+	std::uint64_t done = 0;
+
+	while (done < size) {
+		ssize_t result = ::pread(fd_, output + done, size - done, offset + done);
+
+		if (result < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+
+			return done;
+		}
+
+		if (result == 0) {
+			errno = 0;
+			return done;
+		}
+
+		done += result;
+	}
+
+	return done;
+}
+
+const std::uint8_t* core_file::data() const
+{
+	std::call_once(map_once_, [this]() {
+		const std::uint64_t file_size = size();
+
+		if (file_size == 0) {
+			return;
+		}
+
+		void* mapping = ::mmap(nullptr, file_size, PROT_READ, MAP_SHARED, fd_, 0);
+
+		if (mapping == MAP_FAILED) {
+			throw std::runtime_error(std::string("Can't map the core file: ") + std::strerror(errno));
+		}
+
+		mapping_ = static_cast<const std::uint8_t*>(mapping);
+		mapping_size_ = file_size;
+	});
+
+	return mapping_;
+}
+}
+} // namespace reven::vmghost
@@ -8,6 +8,7 @@
 
 #include <elf.h>
 
+#include <cstring>
 #include <iostream>
 
 #define ALIGN_UP(value, alignment) (((value) + (alignment) - 1) & ~((alignment) - 1))
@@ -46,13 +47,26 @@ void core_virtualbox::read_cpu(std::uint8_t cpu_nb, std::uint64_t file_offset) {
 		throw std::runtime_error("More cpu than expected");
 	}
 
+	const std::uint32_t version = descriptor_.u32FmtVersion;
+	const std::size_t ext_offset = cpu_virtualbox::extended_state_offset(version);
+
+	// Only the registers before the XSAVE area are read now: the XSAVE area is read on first access.
 	vbox::DBGFCORECPU context;
+	std::memset(&context, 0, sizeof(context));
 
 	file_->seekg(file_offset);
-	file_->read(reinterpret_cast<char*>(&context), sizeof(context));
+	file_->read(reinterpret_cast<char*>(&context), ext_offset);
+
+	cpu_hot_state hot_state = cpu_virtualbox::make_hot_state(version, context);
+	hot_state.tetrane = cpus_[cpu_nb].tetrane_context();
 
-	cpus_[cpu_nb].set_context(context);
-	cpus_[cpu_nb].set_version(descriptor_.u32FmtVersion);
+	auto file = data_file_;
+	const std::uint64_t ext_file_offset = file_offset + ext_offset;
+
+	cpus_[cpu_nb].set_version(version);
+	cpus_[cpu_nb].set_hot_state(hot_state, [file, ext_file_offset](vbox::X86XSAVEAREA& area) {
+		file->read(ext_file_offset, &area, sizeof(area));
+	});
 }
 
 void core_virtualbox::read_tetrane_cpu(std::uint8_t cpu_nb, std::uint64_t file_offset) {
@@ -93,6 +107,8 @@ void core_virtualbox::parse(std::string const& filepath)
 		throw std::runtime_error("Can't open the core file.");
 	}
 
+	data_file_ = std::make_shared<core_file>(filepath);
+
 	Elf64_Ehdr ehdr;
 	file_->read(reinterpret_cast<char*>(&ehdr), sizeof(ehdr));
 
@@ -112,7 +128,7 @@ void core_virtualbox::parse(std::string const& filepath)
 
 		if (phdr.p_type == PT_LOAD) {
 			memory_->insert(
-				MemoryChunk(file_, phdr.p_offset, phdr.p_filesz, phdr.p_paddr, phdr.p_memsz)
+				MemoryChunk(data_file_, phdr.p_offset, phdr.p_filesz, phdr.p_paddr, phdr.p_memsz)
 			);
 		} else if (phdr.p_type == PT_NOTE) {
 			std::uint64_t note_offset = 0;
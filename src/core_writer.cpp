@@ -0,0 +1,277 @@
+#include <core_writer.h>
+
+#include <elf.h>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include "file_copy.h"
+#include "output_file.h"
+
+#define ALIGN_UP(value, alignment) (((value) + (alignment) - 1) & ~((alignment) - 1))
+
+namespace reven {
+namespace vmghost {
+
+namespace {
+
+//! Offset of the first segment in the file, and alignment of the segments.
+constexpr std::uint64_t data_offset = 0x1000;
+
+//! Bytes read from a memory per write.
+constexpr std::size_t block_size = 4 << 20;
+
+//! Name of the Tetrane CPU notes. The reader only looks at their type.
+constexpr const char* tetrane_note_name = "TETRANE";
+
+//! Description of the Tetrane CPU notes.
+struct tetrane_note {
+	std::uint64_t magic;
+	std::uint64_t size;
+	tetrane_cpu_info tetrane;
+} __attribute__((packed));
+
+std::uint64_t note_size(const char* name, std::uint64_t desc_size)
+{
+	return sizeof(Elf64_Nhdr) + ALIGN_UP(std::strlen(name) + 1, 4) + ALIGN_UP(desc_size, 4);
+}
+
+void write_note(output_file& file, std::uint32_t type, const char* name, const void* desc, std::size_t desc_size)
+{
+	static const std::uint8_t zeros[4] = {};
+
+	const std::size_t name_size = std::strlen(name) + 1;
+
+	Elf64_Nhdr note;
+	note.n_namesz = static_cast<Elf64_Word>(name_size);
+	note.n_descsz = static_cast<Elf64_Word>(desc_size);
+	note.n_type = type;
+
+	file.append(note);
+	file.append(name, name_size);
+	file.append(zeros, ALIGN_UP(name_size, 4) - name_size);
+	file.append(desc, desc_size);
+	file.append(zeros, ALIGN_UP(desc_size, 4) - desc_size);
+}
+
+} // anonymous namespace
+
+struct core_writer::impl {
+	explicit impl(std::string const& path) : file(path)
+	{
+		// The ELF header is written last, once the program headers are known.
+		file.skip_to(data_offset);
+	}
+
+	//! Starts a PT_LOAD segment at the end of the file, aligned to a page.
+	void add_segment(std::uint64_t physical_address, std::uint64_t file_size, std::uint64_t memory_size)
+	{
+		if (segments.size() + 2 > PN_XNUM) {
+			throw std::runtime_error("Too many memory segments for an ELF core.");
+		}
+
+		file.align(data_offset);
+
+		Elf64_Phdr segment;
+		std::memset(&segment, 0, sizeof(segment));
+		segment.p_type = PT_LOAD;
+		segment.p_flags = PF_R | PF_W | PF_X;
+		segment.p_offset = file.offset();
+		segment.p_paddr = physical_address;
+		segment.p_filesz = file_size;
+		segment.p_memsz = memory_size;
+
+		segments.push_back(segment);
+	}
+
+	//! Appends @c size bytes at @c offset of @c source, from file to file when possible.
+	void copy(core_file const& source, std::uint64_t offset, std::uint64_t size)
+	{
+		file.flush();
+		copier.copy(source, offset, file.offset(), size);
+		file.appended(size);
+	}
+
+	output_file file;
+	file_copier copier{ file };
+	bool has_descriptor{false};
+	vbox::DBGFCOREDESCRIPTOR descriptor{};
+	std::vector<cpu_virtualbox, aligned_allocator<cpu_virtualbox>> cpus;
+	std::vector<Elf64_Phdr> segments;
+	std::vector<std::uint8_t> block;
+};
+
+core_writer::core_writer(std::string const& path) : impl_(new impl(path))
+{
+}
+
+core_writer::~core_writer() = default;
+
+void core_writer::set_descriptor(vbox::DBGFCOREDESCRIPTOR const& descriptor)
+{
+	impl_->descriptor = descriptor;
+	impl_->has_descriptor = true;
+}
+
+void core_writer::add_cpu(cpu_virtualbox const& cpu)
+{
+	if (not impl_->cpus.empty() and impl_->cpus.front().version() != cpu.version()) {
+		throw std::runtime_error("All CPUs must have the same version.");
+	}
+
+	impl_->cpus.push_back(cpu);
+}
+
+void core_writer::add_memory(const physical_memory& memory, memory_range range)
+{
+	impl_->add_segment(range.begin, range.end - range.begin, range.end - range.begin);
+
+	auto& block = impl_->block;
+	block.resize(block_size);
+
+	for (std::uint64_t address = range.begin; address < range.end; address += block.size()) {
+		const std::size_t size = static_cast<std::size_t>(std::min<std::uint64_t>(block.size(), range.end - address));
+
+		if (memory.try_read_buffer(address, block.data(), size).status == read_status::io_error) {
+			throw std::runtime_error("Can't read the memory to write.");
+		}
+
+		impl_->file.append(block.data(), size);
+	}
+}
+
+void core_writer::add_memory(const MemoryVirtualBox& memory, memory_range range)
+{
+	// The chunks are visited from the highest address: the segments are written from the lowest.
+	std::vector<const MemoryChunk*> chunks;
+	memory.visit_chunks([&](const MemoryChunk& chunk) { chunks.push_back(&chunk); });
+
+	for (auto it = chunks.rbegin(); it != chunks.rend(); ++it) {
+		const MemoryChunk& chunk = **it;
+
+		const std::uint64_t begin = std::max(range.begin, chunk.physical_address());
+		const std::uint64_t end = std::min(range.end, chunk.physical_address() + chunk.size_in_memory());
+
+		if (begin >= end) {
+			continue;
+		}
+
+		// The part of [begin, end) that is read from the file.
+		const std::uint64_t file_end = std::min(end, chunk.physical_address() + chunk.size_in_file());
+		const std::uint64_t file_size = file_end > begin ? file_end - begin : 0;
+
+		impl_->add_segment(begin, file_size, end - begin);
+
+		if (file_size == 0) {
+			continue;
+		}
+
+		if (chunk.file()) {
+			impl_->copy(*chunk.file(), chunk.offset_in_file() + (begin - chunk.physical_address()), file_size);
+			continue;
+		}
+
+		auto& block = impl_->block;
+		block.resize(block_size);
+
+		for (std::uint64_t address = begin; address < file_end; address += block.size()) {
+			const std::size_t size = static_cast<std::size_t>(std::min<std::uint64_t>(block.size(), file_end - address));
+
+			if (chunk.try_read(address, block.data(), size).status == read_status::io_error) {
+				throw std::runtime_error("Can't read the memory to write.");
+			}
+
+			impl_->file.append(block.data(), size);
+		}
+	}
+}
+
+void core_writer::finish()
+{
+	auto& file = impl_->file;
+	auto const& cpus = impl_->cpus;
+
+	vbox::DBGFCOREDESCRIPTOR descriptor = impl_->descriptor;
+
+	if (not impl_->has_descriptor) {
+		descriptor.u32Magic = vbox::DBGFCORE_MAGIC;
+		descriptor.u32FmtVersion = cpus.empty() ? vbox::DBGFCORE_FMT_VERSIONv6 : cpus.front().version();
+		descriptor.cbSelf = sizeof(descriptor);
+		descriptor.u32VBoxVersion = 0;
+		descriptor.u32VBoxRevision = 0;
+	}
+
+	descriptor.cCpus = static_cast<std::uint32_t>(cpus.size());
+
+	if (not cpus.empty() and cpus.front().version() != descriptor.u32FmtVersion) {
+		throw std::runtime_error("The CPUs must have the version of the descriptor.");
+	}
+
+	const std::size_t context_size =
+	    cpu_virtualbox::extended_state_offset(descriptor.u32FmtVersion) + sizeof(vbox::X86XSAVEAREA);
+
+	// The notes.
+	file.align(8);
+
+	Elf64_Phdr notes;
+	std::memset(&notes, 0, sizeof(notes));
+	notes.p_type = PT_NOTE;
+	notes.p_flags = PF_R;
+	notes.p_offset = file.offset();
+	notes.p_filesz = note_size(vbox::NN_VBOXCORE, sizeof(descriptor)) +
+	                 cpus.size() * (note_size(vbox::NN_VBOXCPU, context_size) +
+	                                note_size(tetrane_note_name, sizeof(tetrane_note)));
+
+	write_note(file, vbox::NT_VBOXCORE, vbox::NN_VBOXCORE, &descriptor, sizeof(descriptor));
+
+	for (auto const& cpu : cpus) {
+		const vbox::DBGFCORECPU context = cpu.context();
+		write_note(file, vbox::NT_VBOXCPU, vbox::NN_VBOXCPU, &context, context_size);
+
+		const tetrane_note tetrane{ vbox::TETRANE_SECTION_MAGIC, sizeof(tetrane_cpu_info), cpu.tetrane_context() };
+		write_note(file, vbox::TETRANE_CPU_SECTION_NOTE_TYPE, tetrane_note_name, &tetrane, sizeof(tetrane));
+	}
+
+	// The program headers, notes first.
+	file.align(8);
+
+	Elf64_Ehdr header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.e_ident, ELFMAG, SELFMAG);
+	header.e_ident[EI_CLASS] = ELFCLASS64;
+	header.e_ident[EI_DATA] = ELFDATA2LSB;
+	header.e_ident[EI_VERSION] = EV_CURRENT;
+	header.e_ident[EI_OSABI] = ELFOSABI_SYSV;
+	header.e_type = ET_CORE;
+	header.e_machine = EM_X86_64;
+	header.e_version = EV_CURRENT;
+	header.e_phoff = file.offset();
+	header.e_ehsize = sizeof(header);
+	header.e_phentsize = sizeof(Elf64_Phdr);
+	header.e_phnum = static_cast<Elf64_Half>(impl_->segments.size() + 1);
+
+	file.append(notes);
+	file.append(impl_->segments.data(), impl_->segments.size() * sizeof(Elf64_Phdr));
+
+	file.flush();
+	file.write_at(0, &header, sizeof(header));
+	file.close();
+}
+
+void write_core(core_virtualbox const& core, std::string const& path)
+{
+	core_writer writer(path);
+
+	writer.set_descriptor(core.descriptor());
+
+	for (auto cpu = core.cpu_begin(); cpu != core.cpu_end(); ++cpu) {
+		writer.add_cpu(*cpu);
+	}
+
+	writer.add_memory(*core.physical_memory(), memory_range{ 0, UINT64_MAX });
+	writer.finish();
+}
+}
+} // namespace reven::vmghost
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstring>
+#include <stdexcept>
+
+#include <cpu_virtualbox.h>
+
+#include "output_file.h"
+
+namespace reven {
+namespace vmghost {
+
+//!
+//! Header of a CPU stored by the library's own file formats, followed by its context laid out according to
+//!   @c version, XSAVE area included.
+//!
+struct cpu_record_header {
+	std::uint32_t version;
+	std::uint32_t reserved;
+	tetrane_cpu_info tetrane;
+};
+
+static_assert(sizeof(cpu_record_header) == 16, "Invalid cpu_record_header size");
+
+//! Size of the record of a CPU of version @c version.
+inline std::size_t cpu_record_size(std::uint32_t version)
+{
+	return sizeof(cpu_record_header) + cpu_virtualbox::extended_state_offset(version) + sizeof(vbox::X86XSAVEAREA);
+}
+
+inline void write_cpu_record(output_file& file, cpu_virtualbox const& cpu)
+{
+	cpu_record_header header{};
+	header.version = cpu.version();
+	header.tetrane = cpu.tetrane_context();
+
+	const vbox::DBGFCORECPU context = cpu.context();
+
+	file.append(header);
+	file.append(&context, cpu_record_size(cpu.version()) - sizeof(header));
+}
+
+//! The CPU stored in the @c size bytes of @c record. Throws std::runtime_error if they are not a valid record.
+inline cpu_virtualbox read_cpu_record(const std::uint8_t* record, std::size_t size)
+{
+	cpu_record_header header;
+
+	if (size < sizeof(header)) {
+		throw std::runtime_error("Invalid CPU record.");
+	}
+
+	std::memcpy(&header, record, sizeof(header));
+
+	if (size != cpu_record_size(header.version)) {
+		throw std::runtime_error("Invalid CPU record.");
+	}
+
+	vbox::DBGFCORECPU context;
+	std::memset(&context, 0, sizeof(context));
+	std::memcpy(&context, record + sizeof(header), size - sizeof(header));
+
+	cpu_virtualbox cpu(header.version, context);
+	cpu.set_tetrane_context(header.tetrane);
+	return cpu;
+}
+}
+} // namespace reven::vmghost
@@ -1,7 +1,9 @@
 #include <cpu_virtualbox.h>
 
+#include <cstddef>
 #include <cstring>
 
+#include <mutex>
 #include <stdexcept>
 
 namespace reven {
@@ -47,12 +49,102 @@ std::uint16_t fpu_restore_tag(const vbox::X86FXSTATE* pFpu, unsigned int iReg)
 
 } // anonymous-namespace
 
-const vbox::X86XSAVEAREA& cpu_virtualbox::ext() const {
+struct cpu_virtualbox::lazy_extended_state {
+	std::once_flag loaded;
+	extended_state_loader loader;
+	vbox::X86XSAVEAREA area;
+};
+
+cpu_hot_state cpu_virtualbox::make_hot_state(std::uint32_t version, const vbox::DBGFCORECPU& context)
+{
+	cpu_hot_state hot_state{};
+
+	hot_state.base = context.base;
+
+	if (version == vbox::DBGFCORE_FMT_VERSIONv6) {
+		hot_state.msrTscAux = context.v6.msrTscAux;
+		std::memcpy(hot_state.aXcr, context.v6.aXcr, sizeof(hot_state.aXcr));
+	} else {
+		std::memcpy(hot_state.aXcr, context.v5.aXcr, sizeof(hot_state.aXcr));
+	}
+
+	return hot_state;
+}
+
+std::size_t cpu_virtualbox::extended_state_offset(std::uint32_t version)
+{
+	if (version == vbox::DBGFCORE_FMT_VERSIONv6) {
+		return offsetof(vbox::DBGFCORECPUv6, ext);
+	}
+
+	return offsetof(vbox::DBGFCORECPUv5, ext);
+}
+
+void cpu_virtualbox::set_context(std::uint32_t version, const vbox::DBGFCORECPU& context)
+{
+	version_ = version;
+	set_context(context);
+}
+
+void cpu_virtualbox::set_context(const vbox::DBGFCORECPU& context)
+{
+	if (version_ == 0) {
+		throw std::runtime_error("The version of the CPU must be set before its context.");
+	}
+
+	const tetrane_cpu_info tetrane = hot_.tetrane;
+
+	hot_ = make_hot_state(version_, context);
+	hot_.tetrane = tetrane;
+
+	ext_ = std::make_shared<lazy_extended_state>();
+	std::memcpy(&ext_->area, reinterpret_cast<const std::uint8_t*>(&context) + extended_state_offset(version_),
+	            sizeof(ext_->area));
+}
+
+void cpu_virtualbox::set_hot_state(const cpu_hot_state& hot_state, extended_state_loader loader)
+{
+	hot_ = hot_state;
+
+	ext_ = std::make_shared<lazy_extended_state>();
+	ext_->loader = std::move(loader);
+}
+
+const vbox::X86XSAVEAREA& cpu_virtualbox::extended_state() const
+{
+	static const vbox::X86XSAVEAREA empty_area = vbox::X86XSAVEAREA();
+
+	if (not ext_) {
+		return empty_area;
+	}
+
+	std::call_once(ext_->loaded, [this]() {
+		if (ext_->loader) {
+			ext_->loader(ext_->area);
+			ext_->loader = nullptr;
+		}
+	});
+
+	return ext_->area;
+}
+
+vbox::DBGFCORECPU cpu_virtualbox::context() const
+{
+	vbox::DBGFCORECPU context;
+	std::memset(&context, 0, sizeof(context));
+
+	context.base = hot_.base;
+
 	if (version_ == vbox::DBGFCORE_FMT_VERSIONv6) {
-		return context_.v6.ext;
+		context.v6.msrTscAux = hot_.msrTscAux;
+		std::memcpy(context.v6.aXcr, hot_.aXcr, sizeof(hot_.aXcr));
+		context.v6.ext = extended_state();
 	} else {
-		return context_.v5.ext;
+		std::memcpy(context.v5.aXcr, hot_.aXcr, sizeof(hot_.aXcr));
+		context.v5.ext = extended_state();
 	}
+
+	return context;
 }
 
 std::uint16_t cpu_virtualbox::fpu_rebuild_tag_word() const
@@ -242,38 +334,64 @@ std::uint8_t cpu_virtualbox::mxcsr_mm() const
 	return (ext().x87.MXCSR >> 17) & 1;
 }
 
+std::uint64_t cpu_virtualbox::xstate_bv() const
+{
+	return ext().Hdr.bmXState;
+}
+std::uint64_t cpu_virtualbox::xcomp_bv() const
+{
+	return ext().Hdr.bmXComp;
+}
+
+vector128 cpu_virtualbox::xmm_register(std::uint8_t index) const
+{
+	return xsave().xmm(index);
+}
+vector256 cpu_virtualbox::ymm_register(std::uint8_t index) const
+{
+	return xsave().ymm(index);
+}
+vector512 cpu_virtualbox::zmm_register(std::uint8_t index) const
+{
+	return xsave().zmm(index);
+}
+std::uint64_t cpu_virtualbox::opmask_register(std::uint8_t index) const
+{
+	return xsave().opmask(index);
+}
+
 std::uint64_t cpu_virtualbox::rflags() const {
-	return (context_.base.rflags);
+	return (hot_.base.rflags);
 }
 
 //! @return Set if an arithmetic operation generates a carry or a borrow out of the most significant bit of the result.
 bool cpu_virtualbox::carry_flag() const
 {
-	return (context_.base.rflags) & 1;
+	return (hot_.base.rflags) & 1;
 }
 
 //! @return Set if the least significant byte of the result contains an even number of 1 bits.
 bool cpu_virtualbox::parity_flag() const
 {
-	return (context_.base.rflags) & (1 << 2);
+	return (hot_.base.rflags) & (1 << 2);
 }
 
 //! @return Set if an arithmetic operation generates a carry or a borrow out of bit 3 of the result.
 bool cpu_virtualbox::adjust_flag() const
 {
-	return (context_.base.rflags) & (1 << 4);
+	return (hot_.base.rflags) & (1 << 4);
 }
 
 //! @return Set if the result is zero.
 bool cpu_virtualbox::zero_flag() const
 {
-	return (context_.base.rflags) & (1 << 6);
+	return (hot_.base.rflags) & (1 << 6);
 }
 
 //! @return Set equal to the most-significant bit of the result, which is the sign bit of a signed integer.
 bool cpu_virtualbox::sign_flag() const
 {
-	return (context_.base.rflags) & (1 << 7);
+	return (hot_.base.rflags) & (1 << 7);
 }
 
 //! @return Set if the integer result is too large a positive number of too small a negative number (excluding the
@@ -281,156 +399,164 @@ bool cpu_virtualbox::sign_flag() const
 //!   to fit in the destination operand.
 bool cpu_virtualbox::overflow_flag() const
 {
-	return (context_.base.rflags) & (1 << 11);
+	return (hot_.base.rflags) & (1 << 11);
 }
 
 bool cpu_virtualbox::directional_flag() const
 {
-	return (context_.base.rflags) & (1 << 10);
+	return (hot_.base.rflags) & (1 << 10);
 }
 bool cpu_virtualbox::resume_flag() const
 {
-	return (context_.base.rflags) & (1 << 16);
+	return (hot_.base.rflags) & (1 << 16);
 }
 bool cpu_virtualbox::trap_flag() const
 {
-	return (context_.base.rflags) & (1 << 8);
+	return (hot_.base.rflags) & (1 << 8);
 }
 bool cpu_virtualbox::interrupt_flag() const
 {
-	return (context_.base.rflags) & (1 << 9);
+	return (hot_.base.rflags) & (1 << 9);
 }
 bool cpu_virtualbox::cpuid_flag() const
 {
-	return (context_.base.rflags) & (1 << 21);
+	return (hot_.base.rflags) & (1 << 21);
 }
 bool cpu_virtualbox::iopl_flag() const
 {
-	return (context_.base.rflags) & (3 << 12);
+	return (hot_.base.rflags) & (3 << 12);
 }
 
 bool cpu_virtualbox::eflag_reserved_bit1() const
 {
-	return (context_.base.rflags) & (1 << 1);
+	return (hot_.base.rflags) & (1 << 1);
 }
 
 bool cpu_virtualbox::is_paging_enabled() const
 {
-	return context_.base.cr0 & 0x80000000;
+	return hot_.base.cr0 & 0x80000000;
 }
 bool cpu_virtualbox::is_pae_enabled() const
 {
-	return is_paging_enabled() && (context_.base.cr4 & 0x00000020);
+	return is_paging_enabled() && (hot_.base.cr4 & 0x00000020);
 }
 bool cpu_virtualbox::is_pse_enabled() const
 {
-	return (context_.base.cr4 & 0x00000010);
+	return (hot_.base.cr4 & 0x00000010);
 }
 bool cpu_virtualbox::is_smep_enabled() const
 {
-	return (context_.base.cr4 & 0x100000);
+	return (hot_.base.cr4 & 0x100000);
 }
 bool cpu_virtualbox::is_pse36_enabled() const
 {
-	return (context_.base.rdx & 0x20000);
+	return (hot_.base.rdx & 0x20000);
 }
 bool cpu_virtualbox::is_nx_enabled() const
 {
-	return (context_.base.msrEFER & 0x800);
+	return (hot_.base.msrEFER & 0x800);
+}
+bool cpu_virtualbox::is_long_mode_enabled() const
+{
+	return (hot_.base.msrEFER & 0x400);
+}
+bool cpu_virtualbox::is_la57_enabled() const
+{
+	return (hot_.base.cr4 & 0x1000);
 }
 
 std::uint64_t cpu_virtualbox::rax() const
 {
-	return context_.base.rax;
+	return hot_.base.rax;
 }
 std::uint64_t cpu_virtualbox::rbx() const
 {
-	return context_.base.rbx;
+	return hot_.base.rbx;
 }
 std::uint64_t cpu_virtualbox::rcx() const
 {
-	return context_.base.rcx;
+	return hot_.base.rcx;
 }
 std::uint64_t cpu_virtualbox::rdx() const
 {
-	return context_.base.rdx;
+	return hot_.base.rdx;
 }
 
 std::uint64_t cpu_virtualbox::rsp() const
 {
-	return context_.base.rsp;
+	return hot_.base.rsp;
 }
 std::uint64_t cpu_virtualbox::rbp() const
 {
-	return context_.base.rbp;
+	return hot_.base.rbp;
 }
 std::uint64_t cpu_virtualbox::rsi() const
 {
-	return context_.base.rsi;
+	return hot_.base.rsi;
 }
 std::uint64_t cpu_virtualbox::rdi() const
 {
-	return context_.base.rdi;
+	return hot_.base.rdi;
 }
 
 std::uint64_t cpu_virtualbox::r8() const {
-	return context_.base.r8;
+	return hot_.base.r8;
 }
 std::uint64_t cpu_virtualbox::r9() const {
-	return context_.base.r9;
+	return hot_.base.r9;
 }
 std::uint64_t cpu_virtualbox::r10() const {
-	return context_.base.r10;
+	return hot_.base.r10;
 }
 std::uint64_t cpu_virtualbox::r11() const {
-	return context_.base.r11;
+	return hot_.base.r11;
 }
 std::uint64_t cpu_virtualbox::r12() const {
-	return context_.base.r12;
+	return hot_.base.r12;
 }
 std::uint64_t cpu_virtualbox::r13() const {
-	return context_.base.r13;
+	return hot_.base.r13;
 }
 std::uint64_t cpu_virtualbox::r14() const {
-	return context_.base.r14;
+	return hot_.base.r14;
 }
 std::uint64_t cpu_virtualbox::r15() const {
-	return context_.base.r15;
+	return hot_.base.r15;
 }
 
 std::uint64_t cpu_virtualbox::cr0() const
 {
-	return context_.base.cr0;
+	return hot_.base.cr0;
 }
 std::uint64_t cpu_virtualbox::cr2() const
 {
-	return context_.base.cr2;
+	return hot_.base.cr2;
 }
 std::uint64_t cpu_virtualbox::cr3() const
 {
-	return context_.base.cr3;
+	return hot_.base.cr3;
 }
 std::uint64_t cpu_virtualbox::cr4() const
 {
-	return context_.base.cr4;
+	return hot_.base.cr4;
 }
 std::uint64_t cpu_virtualbox::cr8() const
 {
-	return tetrane_context_.cr8;
+	return hot_.tetrane.cr8;
 }
 
 std::uint64_t cpu_virtualbox::rip() const
 {
-	return context_.base.rip;
+	return hot_.base.rip;
 }
 
 #define GENERATE_DESCRIPTOR_FUNCTIONS(name)					\
 	std::uint64_t cpu_virtualbox::name##_base() const {		\
-		return context_.base.name.uAddr; 						\
+		return hot_.base.name.uAddr; 						\
 	} 														\
  															\
 	std::uint32_t cpu_virtualbox::name##_limit() const {	\
-		return context_.base.name.cb; 							\
+		return hot_.base.name.cb; 							\
 	}
 
 GENERATE_DESCRIPTOR_FUNCTIONS(gdtr)
@@ -440,51 +566,51 @@ GENERATE_DESCRIPTOR_FUNCTIONS(idtr)
 
 #define GENERATE_SELECTOR_FUNCTIONS(name)					\
 	std::uint16_t cpu_virtualbox::name() const {			\
-		return context_.base.name.uSel;							\
+		return hot_.base.name.uSel;							\
 	}														\
 															\
 	std::uint64_t cpu_virtualbox::name##_base() const {		\
-		return context_.base.name.uBase;							\
+		return hot_.base.name.uBase;							\
 	}														\
 															\
 	std::uint32_t cpu_virtualbox::name##_limit() const {	\
-		return context_.base.name.uLimit;						\
+		return hot_.base.name.uLimit;						\
 	}														\
 															\
 	std::uint32_t cpu_virtualbox::name##_attr() const {		\
-		return context_.base.name.uAttr;							\
+		return hot_.base.name.uAttr;							\
 	}														\
 															\
 	std::uint8_t cpu_virtualbox::name##_attr_type() const {	\
-		return context_.base.name.attr.u4Type;					\
+		return hot_.base.name.attr.u4Type;					\
 	}														\
 															\
 	bool cpu_virtualbox::name##_attr_desc_type() const {	\
-		return context_.base.name.attr.u1DescType;				\
+		return hot_.base.name.attr.u1DescType;				\
 	}														\
 															\
 	std::uint8_t cpu_virtualbox::name##_attr_dpl() const {	\
-		return context_.base.name.attr.u2Dpl;					\
+		return hot_.base.name.attr.u2Dpl;					\
 	}														\
 															\
 	bool cpu_virtualbox::name##_attr_present() const {		\
-		return context_.base.name.attr.u1Present;				\
+		return hot_.base.name.attr.u1Present;				\
 	}														\
 															\
 	bool cpu_virtualbox::name##_attr_available() const {	\
-		return context_.base.name.attr.u1Available;				\
+		return hot_.base.name.attr.u1Available;				\
 	}														\
 															\
 	bool cpu_virtualbox::name##_attr_long() const {			\
-		return context_.base.name.attr.u1Long;					\
+		return hot_.base.name.attr.u1Long;					\
 	}														\
 															\
 	bool cpu_virtualbox::name##_attr_def_big() const {		\
-		return context_.base.name.attr.u1DefBig;					\
+		return hot_.base.name.attr.u1DefBig;					\
 	}														\
 															\
 	bool cpu_virtualbox::name##_attr_granularity() const {	\
-		return context_.base.name.attr.u1Granularity;			\
+		return hot_.base.name.attr.u1Granularity;			\
 	}
 
 GENERATE_SELECTOR_FUNCTIONS(ldtr)
@@ -501,19 +627,19 @@ GENERATE_SELECTOR_FUNCTIONS(es)
 
 std::uint64_t cpu_virtualbox::sysenter_eip_r0() const
 {
-	return context_.base.sysenter.eip;
+	return hot_.base.sysenter.eip;
 }
 std::uint64_t cpu_virtualbox::sysenter_esp_r0() const
 {
-	return context_.base.sysenter.esp;
+	return hot_.base.sysenter.esp;
 }
 std::uint64_t cpu_virtualbox::sysenter_ss_r0() const
 {
-	return (context_.base.sysenter.cs & 0xFF) + 8;
+	return (hot_.base.sysenter.cs & 0xFF) + 8;
 }
 std::uint64_t cpu_virtualbox::sysenter_cs_r0() const
 {
-	return context_.base.sysenter.cs & 0xFF;
+	return hot_.base.sysenter.cs & 0xFF;
 }
 
 std::uint16_t cpu_virtualbox::cs_r3() const
@@ -531,47 +657,47 @@ std::uint16_t cpu_virtualbox::ds_r3() const
 
 std::uint64_t cpu_virtualbox::dr(std::uint8_t reg) const
 {
-	return reg < sizeof(context_.base.dr) / sizeof(*context_.base.dr) ? context_.base.dr[reg] : 0;
+	return reg < sizeof(hot_.base.dr) / sizeof(*hot_.base.dr) ? hot_.base.dr[reg] : 0;
 }
 
 
 std::uint64_t cpu_virtualbox::msrEFER() const
 {
-	return (context_.base.msrEFER);
+	return (hot_.base.msrEFER);
 }
 std::uint64_t cpu_virtualbox::msrSTAR() const
 {
-	return (context_.base.msrSTAR);
+	return (hot_.base.msrSTAR);
 }
 std::uint64_t cpu_virtualbox::msrPAT() const
 {
-	return (context_.base.msrPAT);
+	return (hot_.base.msrPAT);
 }
 std::uint64_t cpu_virtualbox::msrLSTAR() const
 {
-	return (context_.base.msrLSTAR);
+	return (hot_.base.msrLSTAR);
 }
 std::uint64_t cpu_virtualbox::msrCSTAR() const
 {
-	return (context_.base.msrCSTAR);
+	return (hot_.base.msrCSTAR);
 }
 std::uint64_t cpu_virtualbox::msrSFMASK() const
 {
-	return (context_.base.msrSFMASK);
+	return (hot_.base.msrSFMASK);
 }
 std::uint64_t cpu_virtualbox::msrKernelGSBase() const
 {
-	return (context_.base.msrKernelGSBase);
+	return (hot_.base.msrKernelGSBase);
 }
 std::uint64_t cpu_virtualbox::msrApicBase() const
 {
-	return (context_.base.msrApicBase);
+	return (hot_.base.msrApicBase);
 }
 
 std::uint64_t cpu_virtualbox::msrTscAux() const
 {
 	if (version_ == vbox::DBGFCORE_FMT_VERSIONv6) {
-	    return (context_.v6.msrTscAux);
+	    return (hot_.msrTscAux);
 	} else {
 		throw std::runtime_error("Attempt to access msrTscAux from an old version");
 	}
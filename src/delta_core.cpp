@@ -0,0 +1,421 @@
+#include <delta_core.h>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "cpu_record.h"
+#include "file_copy.h"
+#include "output_file.h"
+
+namespace reven {
+namespace vmghost {
+
+namespace {
+
+constexpr char delta_magic[8] = { 'R', 'V', 'N', 'D', 'E', 'L', 'T', 'A' };
+constexpr std::uint32_t delta_format_version = 1;
+
+//! Pages compared per read of the memories.
+constexpr std::size_t block_pages = 256;
+
+//!
+//! Start of a delta core file. The page data starts on a page boundary, and the run table follows it.
+//!
+struct delta_header {
+	char magic[8];
+	std::uint32_t version;
+	std::uint32_t page_size;
+	vbox::DBGFCOREDESCRIPTOR descriptor;
+	std::uint64_t cpu_offset;
+	std::uint64_t cpu_count;
+	std::uint64_t cpu_record_size;
+	std::uint64_t base_path_offset;
+	std::uint64_t base_path_size;
+	std::uint64_t data_offset;
+	std::uint64_t data_pages;
+	std::uint64_t run_offset;
+	std::uint64_t run_count;
+};
+
+} // anonymous namespace
+
+constexpr std::size_t delta_core_writer::page_size;
+
+struct delta_core_writer::impl {
+	impl(std::string const& path, const physical_memory& base, std::string const& base_path)
+		: file(path), base(base), base_path(base_path)
+	{
+		std::memset(&header, 0, sizeof(header));
+		std::memcpy(header.magic, delta_magic, sizeof(delta_magic));
+		header.version = delta_format_version;
+		header.page_size = page_size;
+
+		// The header is written again once complete. CPU records follow it as they are added.
+		file.append(header);
+		header.cpu_offset = file.offset();
+	}
+
+	//! Ends the CPU records, and starts the page data.
+	void start_data()
+	{
+		header.base_path_offset = file.offset();
+		header.base_path_size = base_path.size();
+		file.append(base_path.data(), base_path.size());
+		file.align(page_size);
+		header.data_offset = file.offset();
+		data_started = true;
+	}
+
+	void add_page(std::uint64_t page, delta_page_source source, const std::uint8_t* data)
+	{
+		if (not data_started) {
+			start_data();
+		}
+
+		++stats.pages;
+
+		switch (source) {
+			case delta_page_source::base: ++stats.base_pages; break;
+			case delta_page_source::zero: ++stats.zero_pages; break;
+			case delta_page_source::delta:
+				file.append(data, page_size);
+				++stats.delta_pages;
+				break;
+		}
+
+		if (not runs.empty()) {
+			auto& last = runs.back();
+
+			const bool extends = last.source == source and last.first_page + last.page_count == page and
+			                     last.page_count < UINT32_MAX and
+			                     (source != delta_page_source::delta or
+			                      last.first_delta_page + last.page_count == stats.delta_pages - 1);
+
+			if (extends) {
+				++last.page_count;
+				return;
+			}
+
+			if (page < last.first_page + last.page_count) {
+				throw std::runtime_error("Memory ranges must be added in increasing order.");
+			}
+		}
+
+		runs.push_back(delta_page_run{ page, 1, source, source == delta_page_source::delta ? stats.delta_pages - 1 : 0 });
+	}
+
+	output_file file;
+	const physical_memory& base;
+	std::string base_path;
+	delta_header header;
+	bool has_descriptor{false};
+	//! Version of the CPUs added, if any.
+	std::uint32_t cpu_version{0};
+	bool data_started{false};
+	std::vector<delta_page_run> runs;
+	delta_stats stats;
+};
+
+delta_core_writer::delta_core_writer(std::string const& path, const physical_memory& base,
+                                     std::string const& base_path)
+  : impl_(new impl(path, base, base_path))
+{
+}
+
+delta_core_writer::~delta_core_writer() = default;
+
+void delta_core_writer::set_descriptor(vbox::DBGFCOREDESCRIPTOR const& descriptor)
+{
+	if (impl_->header.cpu_count != 0 and descriptor.u32FmtVersion != impl_->cpu_version) {
+		throw std::runtime_error("The CPUs must have the version of the descriptor.");
+	}
+
+	impl_->header.descriptor = descriptor;
+	impl_->has_descriptor = true;
+}
+
+void delta_core_writer::add_cpu(cpu_virtualbox const& cpu)
+{
+	if (impl_->data_started) {
+		throw std::runtime_error("CPUs must be added before the memory.");
+	}
+
+	if (impl_->has_descriptor and cpu.version() != impl_->header.descriptor.u32FmtVersion) {
+		throw std::runtime_error("The CPUs must have the version of the descriptor.");
+	}
+
+	if (impl_->header.cpu_count != 0 and cpu.version() != impl_->cpu_version) {
+		throw std::runtime_error("All CPUs must have the same version.");
+	}
+
+	write_cpu_record(impl_->file, cpu);
+
+	impl_->cpu_version = cpu.version();
+	impl_->header.cpu_record_size = cpu_record_size(cpu.version());
+	++impl_->header.cpu_count;
+}
+
+void delta_core_writer::add_memory(const physical_memory& memory, memory_range range)
+{
+	const std::uint64_t first_page = range.begin / page_size;
+	const std::uint64_t end_page = (range.end + page_size - 1) / page_size;
+
+	std::vector<std::uint8_t> block(block_pages * page_size);
+	std::vector<std::uint8_t> base_block(block_pages * page_size);
+
+	for (std::uint64_t page = first_page; page < end_page; page += block_pages) {
+		const std::size_t pages = static_cast<std::size_t>(std::min<std::uint64_t>(block_pages, end_page - page));
+		const std::size_t size = pages * page_size;
+
+		// Reads that are not backed come back as zeros, which is what the readers see too.
+		if (memory.try_read_buffer(page * page_size, block.data(), size).status == read_status::io_error or
+		    impl_->base.try_read_buffer(page * page_size, base_block.data(), size).status == read_status::io_error) {
+			throw std::runtime_error("Can't read the memory to compare.");
+		}
+
+		for (std::size_t i = 0; i < pages; ++i) {
+			const std::uint8_t* data = block.data() + i * page_size;
+
+			if (std::memcmp(data, base_block.data() + i * page_size, page_size) == 0) {
+				impl_->add_page(page + i, delta_page_source::base, data);
+			} else if (is_zero(data, page_size)) {
+				impl_->add_page(page + i, delta_page_source::zero, data);
+			} else {
+				impl_->add_page(page + i, delta_page_source::delta, data);
+			}
+		}
+	}
+}
+
+delta_stats delta_core_writer::finish()
+{
+	if (not impl_->data_started) {
+		impl_->start_data();
+	}
+
+	auto& header = impl_->header;
+	auto& file = impl_->file;
+
+	header.data_pages = impl_->stats.delta_pages;
+	header.run_offset = file.offset();
+	header.run_count = impl_->runs.size();
+	file.append(impl_->runs.data(), impl_->runs.size() * sizeof(delta_page_run));
+
+	file.flush();
+	file.write_at(0, &header, sizeof(header));
+	file.close();
+
+	return impl_->stats;
+}
+
+delta_stats write_delta_core(core_virtualbox const& core, core_virtualbox const& base, std::string const& path)
+{
+	delta_core_writer writer(path, *base.physical_memory(), base.path());
+
+	writer.set_descriptor(core.descriptor());
+
+	for (auto cpu = core.cpu_begin(); cpu != core.cpu_end(); ++cpu) {
+		writer.add_cpu(*cpu);
+	}
+
+	const physical_memory_map map(*core.physical_memory());
+
+	for (auto const& region : map.regions()) {
+		writer.add_memory(*core.physical_memory(), memory_range{ region.begin, region.end });
+	}
+
+	return writer.finish();
+}
+
+delta_memory::delta_memory(std::shared_ptr<core_file> file, std::uint64_t data_offset,
+                           std::vector<delta_page_run> runs, std::shared_ptr<const physical_memory> base)
+  : file_(std::move(file)), data_offset_(data_offset), runs_(std::move(runs)), base_(std::move(base))
+{
+}
+
+template <typename Visitor>
+void delta_memory::split(std::uint64_t physical_address, std::size_t size, Visitor&& visitor) const
+{
+	constexpr std::uint64_t page_size = delta_core_writer::page_size;
+
+	// The first run ending after the address.
+	auto run = std::upper_bound(runs_.begin(), runs_.end(), physical_address / page_size,
+	                            [](std::uint64_t page, delta_page_run const& entry) {
+		                            return page < entry.first_page + entry.page_count;
+	                            });
+
+	std::size_t done = 0;
+
+	while (done < size) {
+		const std::uint64_t address = physical_address + done;
+		std::size_t length = size - done;
+
+		if (run == runs_.end() or address < run->first_page * page_size) {
+			if (run != runs_.end()) {
+				length = static_cast<std::size_t>(std::min<std::uint64_t>(length, run->first_page * page_size - address));
+			}
+
+			visitor(nullptr, address, length, done);
+		} else {
+			const std::uint64_t run_end = (run->first_page + run->page_count) * page_size;
+			length = static_cast<std::size_t>(std::min<std::uint64_t>(length, run_end - address));
+
+			visitor(&*run, address, length, done);
+			++run;
+		}
+
+		done += length;
+	}
+}
+
+bool delta_memory::do_read(std::uint64_t physical_address, std::uint8_t& data) const
+{
+	bool mapped = false;
+
+	split(physical_address, 1, [&](const delta_page_run* run, std::uint64_t, std::size_t, std::size_t) {
+		mapped = run != nullptr;
+	});
+
+	do_read_buffer(physical_address, &data, 1);
+	return mapped;
+}
+
+void delta_memory::do_read_buffer(std::uint64_t physical_address, void* buffer, std::size_t size) const
+{
+	auto output = static_cast<std::uint8_t*>(buffer);
+
+	split(physical_address, size, [&](const delta_page_run* run, std::uint64_t address, std::size_t length,
+	                                  std::size_t offset) {
+		if (run == nullptr or run->source == delta_page_source::zero) {
+			std::memset(output + offset, 0, length);
+		} else if (run->source == delta_page_source::base) {
+			// As when writing, the bytes the base doesn't back read as zeros.
+			if (base_->try_read_buffer(address, output + offset, length).status == read_status::io_error) {
+				throw std::runtime_error("Can't read the base memory.");
+			}
+		} else {
+			const std::uint64_t run_offset = address - run->first_page * delta_core_writer::page_size;
+			file_->read(data_offset_ + run->first_delta_page * delta_core_writer::page_size + run_offset,
+			            output + offset, length);
+		}
+	});
+}
+
+read_result delta_memory::do_try_read_buffer(std::uint64_t physical_address, void* buffer,
+                                             std::size_t size) const noexcept
+{
+	auto output = static_cast<std::uint8_t*>(buffer);
+
+	std::size_t bytes_read = 0;
+	std::size_t uninitialized = 0;
+	bool io_error = false;
+
+	split(physical_address, size, [&](const delta_page_run* run, std::uint64_t address, std::size_t length,
+	                                  std::size_t offset) {
+		if (run == nullptr) {
+			std::memset(output + offset, 0, length);
+		} else if (run->source == delta_page_source::zero) {
+			std::memset(output + offset, 0, length);
+			bytes_read += length;
+		} else if (run->source == delta_page_source::base) {
+			const auto result = base_->try_read_buffer(address, output + offset, length);
+			bytes_read += result.bytes_read;
+
+			if (result.status == read_status::io_error) {
+				io_error = true;
+			} else {
+				uninitialized += length - result.bytes_read;
+			}
+		} else {
+			const std::uint64_t run_offset = address - run->first_page * delta_core_writer::page_size;
+			const std::size_t read = static_cast<std::size_t>(
+			  file_->try_read(data_offset_ + run->first_delta_page * delta_core_writer::page_size + run_offset,
+			                  output + offset, length));
+
+			std::memset(output + offset + read, 0, length - read);
+			bytes_read += read;
+			io_error = io_error or read < length;
+		}
+	});
+
+	if (io_error) {
+		return read_result{ read_status::io_error, bytes_read };
+	}
+
+	return read_result{ make_read_status(size, bytes_read, uninitialized), bytes_read };
+}
+
+delta_core::delta_core(std::string const& path, std::shared_ptr<const vmghost::physical_memory> base)
+{
+	if (not base) {
+		throw std::runtime_error("A delta core needs its base memory.");
+	}
+
+	auto file = std::make_shared<core_file>(path);
+
+	delta_header header;
+
+	if (file->try_read(0, &header, sizeof(header)) != sizeof(header) or
+	    std::memcmp(header.magic, delta_magic, sizeof(delta_magic)) != 0) {
+		throw std::runtime_error("Not a delta core.");
+	}
+
+	if (header.version != delta_format_version or header.page_size != delta_core_writer::page_size) {
+		throw std::runtime_error("Unsupported delta core version.");
+	}
+
+	// The tables must be in the file, which also bounds the allocations they size.
+	const std::uint64_t file_size = file->size();
+
+	auto fits = [file_size](std::uint64_t offset, std::uint64_t count, std::uint64_t element_size) {
+		return offset <= file_size and (count == 0 or (file_size - offset) / count >= element_size);
+	};
+
+	if (not fits(header.base_path_offset, header.base_path_size, 1) or
+	    header.cpu_record_size < sizeof(cpu_record_header) or
+	    not fits(header.cpu_offset, header.cpu_count, header.cpu_record_size) or
+	    not fits(header.data_offset, header.data_pages, delta_core_writer::page_size) or
+	    not fits(header.run_offset, header.run_count, sizeof(delta_page_run))) {
+		throw std::runtime_error("Corrupted delta core: a table is outside of the file.");
+	}
+
+	descriptor_ = header.descriptor;
+
+	base_path_.resize(header.base_path_size);
+	file->read(header.base_path_offset, &base_path_[0], base_path_.size());
+
+	cpus_.resize(header.cpu_count);
+
+	std::vector<std::uint8_t> record(header.cpu_record_size);
+
+	for (std::uint64_t i = 0; i < header.cpu_count; ++i) {
+		file->read(header.cpu_offset + i * record.size(), record.data(), record.size());
+		cpus_[i] = read_cpu_record(record.data(), record.size());
+	}
+
+	std::vector<delta_page_run> runs(header.run_count);
+	file->read(header.run_offset, runs.data(), runs.size() * sizeof(delta_page_run));
+
+	// Reads look runs up with a binary search: they must be sorted and disjoint, and within the address space.
+	constexpr std::uint64_t max_pages = (~0ull) / delta_core_writer::page_size;
+	std::uint64_t end_page = 0;
+
+	for (auto const& run : runs) {
+		const bool valid =
+		    run.page_count != 0 and run.first_page >= end_page and run.page_count <= max_pages - run.first_page and
+		    (run.source == delta_page_source::base or run.source == delta_page_source::zero or
+		     (run.source == delta_page_source::delta and run.first_delta_page <= header.data_pages and
+		      run.page_count <= header.data_pages - run.first_delta_page));
+
+		if (not valid) {
+			throw std::runtime_error("Corrupted delta core: invalid page run.");
+		}
+
+		end_page = run.first_page + run.page_count;
+	}
+
+	memory_ = std::make_shared<delta_memory>(std::move(file), header.data_offset, std::move(runs), std::move(base));
+}
+}
+} // namespace reven::vmghost
@@ -0,0 +1,196 @@
+#include <descriptor_table.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace reven {
+namespace vmghost {
+
+constexpr std::uint8_t segment_descriptor::present;
+constexpr std::uint8_t segment_descriptor::long_mode;
+constexpr std::uint8_t segment_descriptor::default_big;
+constexpr std::uint8_t segment_descriptor::granularity;
+constexpr std::uint8_t segment_descriptor::available;
+
+namespace {
+
+//! Limits are 16 bits wide: a table is at most 64 KiB.
+constexpr std::size_t max_table_size = 0x10000;
+
+std::uint64_t load_qword(const std::uint8_t* data)
+{
+	std::uint64_t value;
+	std::memcpy(&value, data, sizeof(value));
+	return value;
+}
+
+descriptor_kind system_kind(std::uint8_t type, bool long_mode)
+{
+	if (long_mode) {
+		switch (type) {
+			case 0x2: return descriptor_kind::ldt;
+			case 0x9:
+			case 0xb: return descriptor_kind::tss;
+			case 0xc: return descriptor_kind::call_gate;
+			case 0xe: return descriptor_kind::interrupt_gate;
+			case 0xf: return descriptor_kind::trap_gate;
+			default: return descriptor_kind::reserved;
+		}
+	}
+
+	switch (type) {
+		case 0x1:
+		case 0x3:
+		case 0x9:
+		case 0xb: return descriptor_kind::tss;
+		case 0x2: return descriptor_kind::ldt;
+		case 0x4:
+		case 0xc: return descriptor_kind::call_gate;
+		case 0x5: return descriptor_kind::task_gate;
+		case 0x6:
+		case 0xe: return descriptor_kind::interrupt_gate;
+		case 0x7:
+		case 0xf: return descriptor_kind::trap_gate;
+		default: return descriptor_kind::reserved;
+	}
+}
+
+bool is_gate(descriptor_kind kind)
+{
+	return kind == descriptor_kind::call_gate or kind == descriptor_kind::task_gate or
+	       kind == descriptor_kind::interrupt_gate or kind == descriptor_kind::trap_gate;
+}
+
+//! Decodes the descriptor at @c data. @c upper is the next 8 bytes of a 16-byte descriptor, if any.
+segment_descriptor decode(std::uint64_t low, const std::uint64_t* upper, bool long_mode)
+{
+	segment_descriptor descriptor{};
+
+	const auto high = static_cast<std::uint32_t>(low >> 32);
+
+	descriptor.type = (high >> 8) & 0xf;
+	descriptor.dpl = (high >> 13) & 0x3;
+	descriptor.flags = (high >> 15) & 1 ? segment_descriptor::present : 0;
+
+	if (low == 0) {
+		descriptor.kind = descriptor_kind::null;
+		return descriptor;
+	}
+
+	if ((high >> 12) & 1) {
+		descriptor.kind = descriptor.type & 0x8 ? descriptor_kind::code : descriptor_kind::data;
+	} else {
+		descriptor.kind = system_kind(descriptor.type, long_mode);
+	}
+
+	if (is_gate(descriptor.kind)) {
+		descriptor.selector = static_cast<std::uint16_t>(low >> 16);
+		descriptor.base = (low & 0xffff) | (high & 0xffff0000u);
+		descriptor.ist = long_mode ? high & 0x7 : high & 0x1f;
+
+		if (upper != nullptr) {
+			descriptor.base |= (*upper & 0xffffffffull) << 32;
+		}
+
+		return descriptor;
+	}
+
+	descriptor.base = ((low >> 16) & 0xffffff) | (high & 0xff000000u);
+	descriptor.limit = (low & 0xffff) | (high & 0xf0000);
+
+	if ((high >> 20) & 1) {
+		descriptor.flags |= segment_descriptor::available;
+	}
+	if ((high >> 21) & 1) {
+		descriptor.flags |= segment_descriptor::long_mode;
+	}
+	if ((high >> 22) & 1) {
+		descriptor.flags |= segment_descriptor::default_big;
+	}
+	if ((high >> 23) & 1) {
+		descriptor.flags |= segment_descriptor::granularity;
+		descriptor.limit = (descriptor.limit << 12) | 0xfff;
+	}
+
+	if (upper != nullptr and descriptor.kind != descriptor_kind::code and descriptor.kind != descriptor_kind::data) {
+		descriptor.base |= (*upper & 0xffffffffull) << 32;
+	}
+
+	return descriptor;
+}
+
+std::vector<segment_descriptor> read_table(const virtual_memory& memory, std::uint64_t base, std::uint32_t limit,
+                                           descriptor_table_type type, bool long_mode)
+{
+	std::vector<std::uint8_t> table(std::min<std::size_t>(std::size_t(limit) + 1, max_table_size));
+	memory.read_buffer(base, table.data(), table.size());
+
+	return decode_descriptors(table.data(), table.size(), type, long_mode);
+}
+
+} // anonymous namespace
+
+std::vector<segment_descriptor> decode_descriptors(const void* table, std::size_t size, descriptor_table_type type,
+                                                   bool long_mode)
+{
+	const auto data = static_cast<const std::uint8_t*>(table);
+	const std::size_t count = size / 8;
+
+	std::vector<segment_descriptor> descriptors;
+
+	if (type == descriptor_table_type::interrupts and long_mode) {
+		descriptors.reserve(count / 2);
+
+		for (std::size_t i = 0; i + 1 < count; i += 2) {
+			const auto upper = load_qword(data + (i + 1) * 8);
+			descriptors.push_back(decode(load_qword(data + i * 8), &upper, true));
+		}
+
+		return descriptors;
+	}
+
+	descriptors.reserve(count);
+
+	for (std::size_t i = 0; i < count; ++i) {
+		const auto low = load_qword(data + i * 8);
+		const bool is_system = low != 0 and not((low >> 44) & 1);
+
+		if (long_mode and is_system and i + 1 < count) {
+			const auto upper = load_qword(data + (i + 1) * 8);
+			descriptors.push_back(decode(low, &upper, true));
+
+			segment_descriptor upper_half{};
+			upper_half.kind = descriptor_kind::upper_half;
+			descriptors.push_back(upper_half);
+			++i;
+		} else {
+			descriptors.push_back(decode(low, nullptr, long_mode));
+		}
+	}
+
+	return descriptors;
+}
+
+std::vector<segment_descriptor> read_gdt(const virtual_memory& memory, const cpu_virtualbox& cpu)
+{
+	return read_table(memory, cpu.gdtr_base(), cpu.gdtr_limit(), descriptor_table_type::segments,
+	                  cpu.is_long_mode_enabled());
+}
+
+std::vector<segment_descriptor> read_idt(const virtual_memory& memory, const cpu_virtualbox& cpu)
+{
+	return read_table(memory, cpu.idtr_base(), cpu.idtr_limit(), descriptor_table_type::interrupts,
+	                  cpu.is_long_mode_enabled());
+}
+
+std::vector<segment_descriptor> read_ldt(const virtual_memory& memory, const cpu_virtualbox& cpu)
+{
+	if ((cpu.ldtr() & ~0x7) == 0) {
+		return {};
+	}
+
+	return read_table(memory, cpu.ldtr_base(), cpu.ldtr_limit(), descriptor_table_type::segments,
+	                  cpu.is_long_mode_enabled());
+}
+}
+} // namespace reven::vmghost
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <core_file.h>
+
+#include "output_file.h"
+
+namespace reven {
+namespace vmghost {
+
+//! Whether the @c size bytes at @c data, with @c size not 0, are all zeros.
+inline bool is_zero(const std::uint8_t* data, std::size_t size)
+{
+	return data[0] == 0 and std::memcmp(data, data + 1, size - 1) == 0;
+}
+
+//!
+//! Copies ranges of core files to positions of an @c output_file, from file to file (@c copy_file_range) when the
+//!   file systems allow it, through a buffer otherwise.
+//!
+//! The copies are positional writes that bypass the buffer of the output file: flush it first when copying past its
+//!   end, then account for the appended bytes with @c output_file::appended().
+//!
+class file_copier {
+public:
+	explicit file_copier(output_file& output) : output_(output) {}
+
+	//! Copies @c size bytes at @c offset of @c source to @c output_offset.
+	void copy(core_file const& source, std::uint64_t offset, std::uint64_t output_offset, std::uint64_t size)
+	{
+		while (size > 0 and copy_file_range_) {
+			loff_t input = static_cast<loff_t>(offset);
+			loff_t output = static_cast<loff_t>(output_offset);
+
+			const ssize_t result = ::copy_file_range(source.fd(), &input, output_.fd(), &output, size, 0);
+
+			if (result < 0) {
+				if (errno == EINTR) {
+					continue;
+				}
+
+				if (errno == EXDEV or errno == ENOSYS or errno == EINVAL or errno == EOPNOTSUPP) {
+					copy_file_range_ = false;
+					break;
+				}
+
+				throw std::runtime_error(std::string("Can't copy the core file: ") + std::strerror(errno));
+			}
+
+			if (result == 0) {
+				throw std::runtime_error("Unexpected end of core file.");
+			}
+
+			offset += static_cast<std::uint64_t>(result);
+			output_offset += static_cast<std::uint64_t>(result);
+			size -= static_cast<std::uint64_t>(result);
+		}
+
+		block_.resize(block_size);
+
+		while (size > 0) {
+			const std::size_t length = static_cast<std::size_t>(std::min<std::uint64_t>(size, block_.size()));
+			source.read(offset, block_.data(), length);
+			output_.write_at(output_offset, block_.data(), length);
+
+			offset += length;
+			output_offset += length;
+			size -= length;
+		}
+	}
+
+private:
+	static constexpr std::size_t block_size = 1 << 20;
+
+	output_file& output_;
+	//! Cleared once the file systems refused a copy, so that the next copies go through the buffer at once.
+	bool copy_file_range_{true};
+	std::vector<std::uint8_t> block_;
+};
+}
+} // namespace reven::vmghost
@@ -0,0 +1,357 @@
+#include <guest_strings.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+#include <page_iterator.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace reven {
+namespace vmghost {
+
+namespace {
+
+//! Size of the first block of a single string read: most strings are shorter.
+constexpr std::size_t first_block_size = 0x100;
+constexpr std::size_t block_size = 0x1000;
+
+//! Size of the slices scanned in parallel by find_strings.
+constexpr std::uint64_t slice_size = 0x400000;
+
+//!
+//! Reads a string of @c CharType, calling @c read(address, buffer, size) for each block. @c read returns the
+//!   number of bytes it read.
+//!
+template <typename CharType, typename Reader>
+std::basic_string<CharType> read_nul_terminated(std::uint64_t address, std::size_t max_length, Reader&& read)
+{
+	std::basic_string<CharType> result;
+	std::vector<CharType> block(std::min(max_length, first_block_size));
+
+	while (result.size() < max_length) {
+		const std::size_t length = std::min(block.size(), max_length - result.size());
+		const std::size_t read_length = read(address, block.data(), length * sizeof(CharType)) / sizeof(CharType);
+		const auto end = block.begin() + read_length;
+		const auto nul = std::find(block.begin(), end, CharType(0));
+
+		result.append(block.begin(), nul);
+
+		if (nul != end or read_length < length) {
+			break;
+		}
+
+		address += length * sizeof(CharType);
+		block.resize(std::min(max_length - result.size(), block_size));
+	}
+
+	return result;
+}
+
+std::size_t read_virtual(const virtual_memory& memory, std::uint64_t address, void* buffer, std::size_t size)
+{
+	return memory.try_read_buffer(address, buffer, size);
+}
+
+std::size_t read_physical(const physical_memory& memory, std::uint64_t address, void* buffer, std::size_t size)
+{
+	const auto result = memory.try_read_buffer(address, buffer, size);
+
+	// Bytes that are not backed read as zeros, which end the string anyway.
+	return result.status == read_status::io_error ? 0 : size;
+}
+
+bool is_printable(std::uint8_t c)
+{
+	return (c >= 0x20 and c < 0x7f) or c == '\t';
+}
+
+//! Whether a character of @c encoding starts at @c data.
+bool is_character(const std::uint8_t* data, string_encoding encoding)
+{
+	return encoding == string_encoding::ascii ? is_printable(data[0]) : is_printable(data[0]) and data[1] == 0;
+}
+
+std::size_t character_size(string_encoding encoding)
+{
+	return encoding == string_encoding::ascii ? 1 : 2;
+}
+
+//! Bit i is set if a character of @c encoding starts at data[i], for the 16 bytes at @c data.
+std::uint32_t character_mask(const std::uint8_t* data, string_encoding encoding)
+{
+#ifdef __SSE2__
+	const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+	const __m128i printable = _mm_or_si128(
+	  _mm_and_si128(_mm_cmpgt_epi8(bytes, _mm_set1_epi8(0x1f)), _mm_cmplt_epi8(bytes, _mm_set1_epi8(0x7f))),
+	  _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\t')));
+	const std::uint32_t printable_mask = static_cast<std::uint32_t>(_mm_movemask_epi8(printable));
+
+	if (encoding == string_encoding::ascii) {
+		return printable_mask;
+	}
+
+	const std::uint32_t zero_mask =
+	  static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_setzero_si128())));
+
+	return printable_mask & (zero_mask >> 1) & 0x5555;
+#else
+	std::uint32_t mask = 0;
+
+	for (std::size_t i = 0; i < 16; i += character_size(encoding)) {
+		if (is_character(data + i, encoding)) {
+			mask |= 1u << i;
+		}
+	}
+
+	return mask;
+#endif
+}
+
+//!
+//! Scans the contiguous backed runs of a memory for strings of one encoding.
+//!
+class string_scanner {
+public:
+	string_scanner(std::vector<page_span> const& runs, string_encoding encoding, std::size_t min_length)
+		: runs_(runs), encoding_(encoding), step_(character_size(encoding)), min_length_(min_length)
+	{
+	}
+
+	//! Reports the strings starting in [begin, end) of run @c run.
+	void scan(std::size_t run, std::uint64_t begin, std::uint64_t end, std::vector<string_match>& matches) const
+	{
+		const page_span& span = runs_[run];
+		std::uint64_t offset = begin;
+
+		// A string running into the slice belongs to the slice it starts in.
+		if (continues_before(run, begin)) {
+			offset = find(span, offset, end, false);
+		}
+
+		while (offset < end) {
+			offset = find(span, offset, end, true);
+
+			if (offset >= end) {
+				break;
+			}
+
+			const std::uint64_t string_end = find(span, offset, span.size, false);
+			std::uint64_t length = (string_end - offset) / step_;
+
+			if (string_end + step_ > span.size) {
+				length += length_in_next_runs(run);
+			}
+
+			if (length >= min_length_) {
+				matches.push_back(string_match{ span.physical_address + offset, length, encoding_ });
+			}
+
+			offset = string_end;
+		}
+	}
+
+private:
+	//! Offset of the first position from @c offset where a character starts (@c character) or doesn't start,
+	//!   @c end if none. Positions are multiples of the character size.
+	std::uint64_t find(page_span const& span, std::uint64_t offset, std::uint64_t end, bool character) const
+	{
+		const std::uint32_t all = step_ == 1 ? 0xffff : 0x5555;
+
+		while (offset + 16 <= span.size and offset < end) {
+			std::uint32_t mask = character_mask(span.data + offset, encoding_);
+
+			if (not character) {
+				mask = ~mask & all;
+			}
+
+			if (mask != 0) {
+				return std::min<std::uint64_t>(offset + __builtin_ctz(mask), end);
+			}
+
+			offset += 16;
+		}
+
+		while (offset + step_ <= span.size and offset < end) {
+			if (is_character(span.data + offset, encoding_) == character) {
+				return offset;
+			}
+
+			offset += step_;
+		}
+
+		return std::min<std::uint64_t>(offset, end);
+	}
+
+	bool is_adjacent(std::size_t run, std::size_t next) const
+	{
+		return runs_[run].physical_address + runs_[run].size == runs_[next].physical_address;
+	}
+
+	//! Whether a character ends right before @c offset in run @c run, or in the physically adjacent runs before it.
+	bool continues_before(std::size_t run, std::uint64_t offset) const
+	{
+		if (offset >= step_) {
+			return is_character(runs_[run].data + offset - step_, encoding_);
+		}
+
+		if (offset == 0 and run > 0 and is_adjacent(run - 1, run) and runs_[run - 1].size >= step_) {
+			const page_span& previous = runs_[run - 1];
+			return is_character(previous.data + previous.size - step_, encoding_);
+		}
+
+		return false;
+	}
+
+	//! Number of characters at the start of the physically adjacent runs after run @c run.
+	std::uint64_t length_in_next_runs(std::size_t run) const
+	{
+		std::uint64_t length = 0;
+
+		for (std::size_t next = run + 1; next < runs_.size() and is_adjacent(next - 1, next); ++next) {
+			const std::uint64_t end = find(runs_[next], 0, runs_[next].size, false);
+			length += end / step_;
+
+			if (end + step_ <= runs_[next].size) {
+				break;
+			}
+		}
+
+		return length;
+	}
+
+	std::vector<page_span> const& runs_;
+	string_encoding encoding_;
+	std::size_t step_;
+	std::size_t min_length_;
+};
+
+struct slice {
+	std::size_t run;
+	std::uint64_t begin;
+	std::uint64_t end;
+};
+
+} // anonymous namespace
+
+std::string read_string(const virtual_memory& memory, std::uint64_t virtual_address, std::size_t max_length)
+{
+	return read_nul_terminated<char>(virtual_address, max_length, [&](std::uint64_t address, void* buffer,
+	                                                                  std::size_t size) {
+		return read_virtual(memory, address, buffer, size);
+	});
+}
+
+std::string read_string(const physical_memory& memory, std::uint64_t physical_address, std::size_t max_length)
+{
+	return read_nul_terminated<char>(physical_address, max_length, [&](std::uint64_t address, void* buffer,
+	                                                                   std::size_t size) {
+		return read_physical(memory, address, buffer, size);
+	});
+}
+
+std::u16string read_utf16_string(const virtual_memory& memory, std::uint64_t virtual_address,
+                                 std::size_t max_length)
+{
+	return read_nul_terminated<char16_t>(virtual_address, max_length, [&](std::uint64_t address, void* buffer,
+	                                                                      std::size_t size) {
+		return read_virtual(memory, address, buffer, size);
+	});
+}
+
+std::u16string read_utf16_string(const physical_memory& memory, std::uint64_t physical_address,
+                                 std::size_t max_length)
+{
+	return read_nul_terminated<char16_t>(physical_address, max_length, [&](std::uint64_t address, void* buffer,
+	                                                                       std::size_t size) {
+		return read_physical(memory, address, buffer, size);
+	});
+}
+
+std::vector<string_match> find_strings(const MemoryVirtualBox& memory, strings_options const& options)
+{
+	const page_range range(memory, 0);
+	const auto& runs = range.runs();
+
+	std::vector<string_scanner> scanners;
+
+	if (options.ascii) {
+		scanners.emplace_back(runs, string_encoding::ascii, std::max<std::size_t>(1, options.min_length));
+	}
+	if (options.utf16) {
+		scanners.emplace_back(runs, string_encoding::utf16, std::max<std::size_t>(1, options.min_length));
+	}
+
+	std::vector<slice> slices;
+
+	for (std::size_t run = 0; run < runs.size(); ++run) {
+		for (std::uint64_t begin = 0; begin < runs[run].size; begin += slice_size) {
+			slices.push_back(slice{ run, begin, std::min<std::uint64_t>(begin + slice_size, runs[run].size) });
+		}
+	}
+
+	std::size_t threads = options.threads;
+
+	if (threads == 0) {
+		threads = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	threads = std::max<std::size_t>(1, std::min(threads, slices.size()));
+
+	std::vector<std::vector<string_match>> slice_matches(slices.size());
+	std::atomic<std::size_t> next_slice{0};
+	std::exception_ptr error;
+	std::mutex error_mutex;
+
+	auto work = [&]() {
+		try {
+			for (std::size_t i = next_slice++; i < slices.size(); i = next_slice++) {
+				for (const auto& scanner : scanners) {
+					scanner.scan(slices[i].run, slices[i].begin, slices[i].end, slice_matches[i]);
+				}
+			}
+		} catch (...) {
+			std::lock_guard<std::mutex> lock(error_mutex);
+
+			if (not error) {
+				error = std::current_exception();
+			}
+		}
+	};
+
+	std::vector<std::thread> workers;
+
+	for (std::size_t i = 1; i < threads; ++i) {
+		workers.emplace_back(work);
+	}
+
+	work();
+
+	for (auto& worker : workers) {
+		worker.join();
+	}
+
+	if (error) {
+		std::rethrow_exception(error);
+	}
+
+	std::vector<string_match> matches;
+
+	for (auto& slice_match : slice_matches) {
+		// Each slice finds its ASCII strings, then its UTF-16 strings.
+		std::sort(slice_match.begin(), slice_match.end(), [](string_match const& lhs, string_match const& rhs) {
+			return lhs.physical_address < rhs.physical_address;
+		});
+		matches.insert(matches.end(), slice_match.begin(), slice_match.end());
+	}
+
+	return matches;
+}
+}
+} // namespace reven::vmghost
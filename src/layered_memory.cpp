@@ -0,0 +1,193 @@
+#include <layered_memory.h>
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <map>
+#include <stdexcept>
+#include <string>
+
+namespace reven {
+namespace vmghost {
+
+constexpr layered_memory::layer_id layered_memory::no_layer;
+
+std::vector<memory_range> memory_coverage(const MemoryVirtualBox& memory)
+{
+	const physical_memory_map map(memory);
+	std::vector<memory_range> coverage;
+
+	for (const auto& region : map.regions()) {
+		coverage.push_back(memory_range{ region.begin, region.end });
+	}
+
+	return coverage;
+}
+
+std::vector<memory_range> memory_coverage(const overlay_memory& memory)
+{
+	std::vector<memory_range> coverage;
+
+	for (const auto page : memory.dirty_pages()) {
+		const std::uint64_t begin = page * overlay_memory::page_size;
+
+		if (not coverage.empty() and coverage.back().end == begin) {
+			coverage.back().end += overlay_memory::page_size;
+		} else {
+			coverage.push_back(memory_range{ begin, begin + overlay_memory::page_size });
+		}
+	}
+
+	return coverage;
+}
+
+std::vector<memory_range> memory_coverage(const raw_image_memory& memory)
+{
+	return { memory_range{ 0, memory.size() } };
+}
+
+layered_memory::layer_id layered_memory::add_layer(std::shared_ptr<const physical_memory> layer,
+                                                   std::vector<memory_range> coverage)
+{
+	if (not layer) {
+		throw std::runtime_error("A layer needs a memory.");
+	}
+
+	layers_.push_back(layer_entry{ std::move(layer), std::move(coverage) });
+	build_runs();
+
+	return layers_.size() - 1;
+}
+
+void layered_memory::set_coverage(layer_id layer, std::vector<memory_range> coverage)
+{
+	layers_.at(layer).coverage = std::move(coverage);
+	build_runs();
+}
+
+void layered_memory::build_runs()
+{
+	// Paint the ranges of each layer from the bottom up, keyed by begin address. Each entry runs to the next one.
+	std::map<std::uint64_t, layer_id> painted{ { 0, no_layer } };
+
+	for (layer_id layer = 0; layer < layers_.size(); ++layer) {
+		for (const auto& range : layers_[layer].coverage) {
+			if (range.begin >= range.end) {
+				continue;
+			}
+
+			// The layer under the end of the range resumes after it.
+			auto after = std::prev(painted.upper_bound(range.end));
+			const layer_id resumed = after->second;
+
+			painted.erase(painted.lower_bound(range.begin), painted.upper_bound(range.end));
+			painted[range.begin] = layer;
+			painted.emplace(range.end, resumed);
+		}
+	}
+
+	runs_.clear();
+
+	for (const auto& entry : painted) {
+		if (runs_.empty() or runs_.back().layer != entry.second) {
+			runs_.push_back(run{ entry.first, entry.second });
+		}
+	}
+}
+
+bool layered_memory::layer_at(std::uint64_t physical_address, layer_id& layer) const
+{
+	auto found = std::upper_bound(runs_.begin(), runs_.end(), physical_address,
+	                              [](std::uint64_t address, run const& entry) { return address < entry.begin; });
+
+	layer = std::prev(found)->layer;
+	return layer != no_layer;
+}
+
+template <typename Visitor>
+void layered_memory::split(std::uint64_t physical_address, std::size_t size, Visitor&& visitor) const
+{
+	auto current = std::prev(std::upper_bound(
+	  runs_.begin(), runs_.end(), physical_address,
+	  [](std::uint64_t address, run const& entry) { return address < entry.begin; }));
+
+	std::size_t done = 0;
+
+	while (done < size) {
+		const std::uint64_t address = physical_address + done;
+		auto next = std::next(current);
+
+		std::size_t length = size - done;
+
+		if (next != runs_.end()) {
+			length = static_cast<std::size_t>(std::min<std::uint64_t>(length, next->begin - address));
+		}
+
+		visitor(current->layer, address, length, done);
+
+		done += length;
+		current = next;
+	}
+}
+
+bool layered_memory::do_read(std::uint64_t physical_address, std::uint8_t& data) const
+{
+	layer_id layer;
+
+	if (not layer_at(physical_address, layer)) {
+		return false;
+	}
+
+	return layers_[layer].memory->read(physical_address, data);
+}
+
+void layered_memory::do_read_buffer(std::uint64_t physical_address, void* buffer, std::size_t size) const
+{
+	auto output = static_cast<std::uint8_t*>(buffer);
+
+	split(physical_address, size, [&](layer_id layer, std::uint64_t address, std::size_t length, std::size_t offset) {
+		if (layer == no_layer) {
+			std::memset(output + offset, 0, length);
+			return;
+		}
+
+		// A run may cover adjacent chunks of the layer, which read_buffer doesn't read across: try_read_buffer does.
+		if (layers_[layer].memory->try_read_buffer(address, output + offset, length).status == read_status::io_error) {
+			throw std::runtime_error("Can't read the memory of layer " + std::to_string(layer) + ".");
+		}
+	});
+}
+
+read_result layered_memory::do_try_read_buffer(std::uint64_t physical_address, void* buffer,
+                                               std::size_t size) const noexcept
+{
+	auto output = static_cast<std::uint8_t*>(buffer);
+
+	std::size_t bytes_read = 0;
+	std::size_t uninitialized = 0;
+	bool io_error = false;
+
+	split(physical_address, size, [&](layer_id layer, std::uint64_t address, std::size_t length, std::size_t offset) {
+		if (layer == no_layer) {
+			std::memset(output + offset, 0, length);
+			return;
+		}
+
+		const auto result = layers_[layer].memory->try_read_buffer(address, output + offset, length);
+		bytes_read += result.bytes_read;
+
+		if (result.status == read_status::io_error) {
+			io_error = true;
+		} else if (result.status == read_status::uninitialized) {
+			uninitialized += length;
+		}
+	});
+
+	if (io_error) {
+		return read_result{ read_status::io_error, bytes_read };
+	}
+
+	return read_result{ make_read_status(size, bytes_read, uninitialized), bytes_read };
+}
+}
+} // namespace reven::vmghost
@@ -1,5 +1,8 @@
 #include <memory_chunk.h>
 
+#include <algorithm>
+#include <cstring>
+
 using reven::vmghost::MemoryChunk;
 
 void MemoryChunk::read(std::uint64_t physical_address, void* data, std::uint64_t size) const {
@@ -18,10 +21,42 @@ void MemoryChunk::read(std::uint64_t physical_address, void* data, std::uint64_t
 		size = size_in_file_ - (physical_address - physical_address_);
 	}
 
+	if (core_file_) {
+		core_file_->read(offset_in_file_ + (physical_address - physical_address_), data, size);
+		return;
+	}
+
 	file_->seekg(offset_in_file_ + (physical_address - physical_address_));
 	file_->read(static_cast<char*>(data), size);
 }
 
+reven::vmghost::read_result MemoryChunk::try_read(std::uint64_t physical_address, void* data, std::uint64_t size) const noexcept
+{
+	const std::uint64_t offset = physical_address - physical_address_;
+	const std::uint64_t to_read = offset < size_in_file_ ? std::min(size, size_in_file_ - offset) : 0;
+
+	std::uint64_t bytes_read = 0;
+
+	if (to_read > 0) {
+		if (core_file_) {
+			bytes_read = core_file_->try_read(offset_in_file_ + offset, data, to_read);
+		} else {
+			file_->clear();
+			file_->seekg(offset_in_file_ + offset);
+			file_->read(static_cast<char*>(data), to_read);
+			bytes_read = file_->gcount();
+		}
+	}
+
+	std::memset(static_cast<std::uint8_t*>(data) + bytes_read, 0, size - bytes_read);
+
+	if (bytes_read < to_read) {
+		return read_result{ read_status::io_error, static_cast<std::size_t>(bytes_read) };
+	}
+
+	return read_result{ make_read_status(size, bytes_read, size - bytes_read), static_cast<std::size_t>(bytes_read) };
+}
+
 bool MemoryChunk::contains(std::uint64_t physical_address) const
 {
 	return (physical_address >= physical_address_) && (physical_address - physical_address_ < size_in_memory_);
@@ -0,0 +1,185 @@
+#include <memory_stats.h>
+
+#include "memory_stats_collector.h"
+
+namespace reven {
+namespace vmghost {
+
+constexpr std::size_t memory_stats::size_classes;
+constexpr std::size_t memory_stats::latency_buckets;
+
+std::size_t memory_stats::size_class(std::size_t size)
+{
+	if (size <= 1) {
+		return 0;
+	}
+
+	if (size <= 8) {
+		return 1;
+	}
+
+	if (size <= 64) {
+		return 2;
+	}
+
+	if (size <= 4096) {
+		return 3;
+	}
+
+	return size <= 65536 ? 4 : 5;
+}
+
+std::size_t memory_stats::latency_bucket(std::uint64_t ns)
+{
+	std::size_t bucket = 0;
+
+	while (ns > 1 and bucket + 1 < latency_buckets) {
+		ns >>= 1;
+		++bucket;
+	}
+
+	return bucket;
+}
+
+std::uint64_t memory_stats::total_reads() const
+{
+	std::uint64_t total = 0;
+
+	for (auto count : reads) {
+		total += count;
+	}
+
+	return total;
+}
+
+std::uint64_t memory_stats::total_read_bytes() const
+{
+	std::uint64_t total = 0;
+
+	for (auto count : read_bytes) {
+		total += count;
+	}
+
+	return total;
+}
+
+memory_stats& memory_stats::operator+=(memory_stats const& other)
+{
+	for (std::size_t i = 0; i < size_classes; ++i) {
+		reads[i] += other.reads[i];
+		read_bytes[i] += other.read_bytes[i];
+	}
+
+	chunk_lookups += other.chunk_lookups;
+	hole_reads += other.hole_reads;
+	zero_filled_bytes += other.zero_filled_bytes;
+	cross_chunk_reads += other.cross_chunk_reads;
+
+	for (std::size_t i = 0; i < latency_buckets; ++i) {
+		latency_ns[i] += other.latency_ns[i];
+	}
+
+	return *this;
+}
+
+bool memory_stats_enabled()
+{
+#ifdef RVNCOREVIRTUALBOX_MEMORY_STATS
+	return true;
+#else
+	return false;
+#endif
+}
+
+namespace {
+
+std::uint64_t next_collector_id()
+{
+	static std::atomic<std::uint64_t> next{1};
+	return next++;
+}
+
+} // anonymous namespace
+
+memory_stats_collector::memory_stats_collector() : id_(next_collector_id())
+{
+}
+
+memory_stats_collector::slot& memory_stats_collector::local()
+{
+	// The slot of the last collector the thread used.
+	thread_local std::uint64_t cached_id = 0;
+	thread_local slot* cached_slot = nullptr;
+
+	if (cached_id != id_) {
+		cached_slot = &find_or_create();
+		cached_id = id_;
+	}
+
+	return *cached_slot;
+}
+
+memory_stats_collector::slot& memory_stats_collector::find_or_create()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	auto& entry = slots_[std::this_thread::get_id()];
+
+	if (not entry) {
+		entry.reset(new slot);
+	}
+
+	return *entry;
+}
+
+memory_stats memory_stats_collector::total() const
+{
+	memory_stats stats;
+
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	for (auto const& entry : slots_) {
+		slot const& counters = *entry.second;
+
+		for (std::size_t i = 0; i < memory_stats::size_classes; ++i) {
+			stats.reads[i] += counters.reads[i].get();
+			stats.read_bytes[i] += counters.read_bytes[i].get();
+		}
+
+		stats.chunk_lookups += counters.chunk_lookups.get();
+		stats.hole_reads += counters.hole_reads.get();
+		stats.zero_filled_bytes += counters.zero_filled_bytes.get();
+		stats.cross_chunk_reads += counters.cross_chunk_reads.get();
+
+		for (std::size_t i = 0; i < memory_stats::latency_buckets; ++i) {
+			stats.latency_ns[i] += counters.latency_ns[i].get();
+		}
+	}
+
+	return stats;
+}
+
+void memory_stats_collector::reset()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	for (auto& entry : slots_) {
+		slot& counters = *entry.second;
+
+		for (std::size_t i = 0; i < memory_stats::size_classes; ++i) {
+			counters.reads[i].reset();
+			counters.read_bytes[i].reset();
+		}
+
+		counters.chunk_lookups.reset();
+		counters.hole_reads.reset();
+		counters.zero_filled_bytes.reset();
+		counters.cross_chunk_reads.reset();
+
+		for (auto& count : counters.latency_ns) {
+			count.reset();
+		}
+	}
+}
+}
+} // namespace reven::vmghost
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <memory_stats.h>
+
+//! Compiles @c statement only in builds with the @c MEMORY_STATS option.
+#ifdef RVNCOREVIRTUALBOX_MEMORY_STATS
+#define RVN_MEMORY_STATS(statement) statement
+#else
+#define RVN_MEMORY_STATS(statement)
+#endif
+
+namespace reven {
+namespace vmghost {
+
+//!
+//! Collects @c memory_stats with a set of counters per thread.
+//!
+//! A thread only ever writes its own counters, with plain relaxed loads and stores: no lock and no atomic
+//!   read-modify-write on the read path. @c total() sums the counters of all threads, which are read while they may
+//!   be updated, so a total taken during reads is approximate.
+//!
+class memory_stats_collector {
+public:
+	class counter {
+	public:
+		void add(std::uint64_t value)
+		{
+			value_.store(value_.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+		}
+
+		std::uint64_t get() const { return value_.load(std::memory_order_relaxed); }
+		void reset() { value_.store(0, std::memory_order_relaxed); }
+
+	private:
+		std::atomic<std::uint64_t> value_{0};
+	};
+
+	//! The counters of a thread, in their own allocation.
+	struct slot {
+		counter reads[memory_stats::size_classes];
+		counter read_bytes[memory_stats::size_classes];
+		counter chunk_lookups;
+		counter hole_reads;
+		counter zero_filled_bytes;
+		counter cross_chunk_reads;
+		counter latency_ns[memory_stats::latency_buckets];
+	};
+
+	//!
+	//! Records a read of @c size bytes on the current thread when destroyed, with its latency.
+	//!
+	class read_scope {
+	public:
+		read_scope(memory_stats_collector& collector, std::size_t size)
+			: slot_(collector.local()), size_(size), start_(std::chrono::steady_clock::now())
+		{
+		}
+
+		~read_scope()
+		{
+			const auto elapsed = std::chrono::steady_clock::now() - start_;
+			const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+
+			const std::size_t size_class = memory_stats::size_class(size_);
+			slot_.reads[size_class].add(1);
+			slot_.read_bytes[size_class].add(size_);
+			slot_.latency_ns[memory_stats::latency_bucket(static_cast<std::uint64_t>(ns))].add(1);
+		}
+
+		slot& counters() { return slot_; }
+
+	private:
+		slot& slot_;
+		std::size_t size_;
+		std::chrono::steady_clock::time_point start_;
+	};
+
+	memory_stats_collector();
+
+	memory_stats_collector(memory_stats_collector const&) = delete;
+	memory_stats_collector& operator=(memory_stats_collector const&) = delete;
+
+	//! The counters of the current thread, created on its first call.
+	slot& local();
+
+	memory_stats total() const;
+
+	//! Sets the counters of all threads to zero. Reads running meanwhile may be lost or partly counted.
+	void reset();
+
+private:
+	slot& find_or_create();
+
+	//! Unique among all collectors, so that the per-thread cache never confuses a collector with a dead one.
+	const std::uint64_t id_;
+
+	mutable std::mutex mutex_;
+	std::unordered_map<std::thread::id, std::unique_ptr<slot>> slots_;
+
+}; // class memory_stats_collector
+}
+} // namespace reven::vmghost
@@ -1,11 +1,47 @@
 #include <memory_virtualbox.h>
 
+#include <algorithm>
 #include <cstring>
 #include <cassert>
+#include <iterator>
+
+#include "memory_stats_collector.h"
 
 namespace reven {
 namespace vmghost {
 
+MemoryVirtualBox::stats_handle::stats_handle()
+{
+	RVN_MEMORY_STATS(collector_.reset(new memory_stats_collector()));
+}
+
+MemoryVirtualBox::stats_handle::stats_handle(stats_handle const&) : stats_handle()
+{
+}
+
+MemoryVirtualBox::stats_handle::stats_handle(stats_handle&& other) : collector_(std::move(other.collector_))
+{
+	// The memory moved from keeps counting on its own.
+	RVN_MEMORY_STATS(other.collector_.reset(new memory_stats_collector()));
+}
+
+MemoryVirtualBox::stats_handle::~stats_handle() = default;
+
+MemoryVirtualBox::stats_handle& MemoryVirtualBox::stats_handle::operator=(stats_handle const&)
+{
+	RVN_MEMORY_STATS(collector_.reset(new memory_stats_collector()));
+	return *this;
+}
+
+MemoryVirtualBox::stats_handle& MemoryVirtualBox::stats_handle::operator=(stats_handle&& other)
+{
+	collector_ = std::move(other.collector_);
+	RVN_MEMORY_STATS(other.collector_.reset(new memory_stats_collector()));
+	return *this;
+}
+
+MemoryVirtualBox::MemoryVirtualBox() = default;
+
 /**
  * @details It implements the trick proposed by Scott Meyers for efficient
  *      insert or update. The problem with a map is that the subscript
@@ -31,31 +67,101 @@ bool MemoryVirtualBox::do_read(std::uint64_t physical_address, std::uint8_t& out
 {
 	do_read_buffer(physical_address, &output, 1);
 
-	//! @todo May be bold, but considering that it never fails.
+	//! @todo May be bold, but considering that it never fails. Use try_read_buffer to know whether it is backed.
 	return true;
 }
 
 void MemoryVirtualBox::do_read_buffer(std::uint64_t physical_address, void* buffer, std::size_t size) const
 {
-	auto found_chunk = findChunk(physical_address);
-	if (found_chunk == chunks_.end()) {
-		std::memset(buffer, 0, size);
-		return;
-	}
+	RVN_MEMORY_STATS(memory_stats_collector::read_scope stats(*stats_.get(), size));
 
-	MemoryChunk const& chunk = found_chunk->second;
+	RVN_MEMORY_STATS(stats.counters().chunk_lookups.add(1));
+	const MemoryChunk* chunk = chunk_at(physical_address);
 
-	if (not chunk.contains(physical_address)) {
+	if (chunk == nullptr) {
+		RVN_MEMORY_STATS(stats.counters().hole_reads.add(1));
+		RVN_MEMORY_STATS(stats.counters().zero_filled_bytes.add(size));
 		std::memset(buffer, 0, size);
 		return;
 	}
 
-	if (not chunk.contains(physical_address + size - 1)) {
+	if (not chunk->contains(physical_address + size - 1)) {
+		RVN_MEMORY_STATS(stats.counters().cross_chunk_reads.add(1));
+		RVN_MEMORY_STATS(stats.counters().zero_filled_bytes.add(size));
 		std::memset(buffer, 0, size);
 		return;
 	}
 
-	chunk.read(physical_address, buffer, size);
+	chunk->read(physical_address, buffer, size);
+}
+
+//!
+//! Unlike @c do_read_buffer, the range may span several chunks and holes: each part is read or zero-filled on its own.
+//!
+read_result MemoryVirtualBox::do_try_read_buffer(std::uint64_t physical_address, void* buffer,
+                                                 std::size_t size) const noexcept
+{
+	RVN_MEMORY_STATS(memory_stats_collector::read_scope stats(*stats_.get(), size));
+	RVN_MEMORY_STATS(std::size_t parts = 0);
+
+	auto output = static_cast<std::uint8_t*>(buffer);
+
+	std::size_t done = 0;
+	std::size_t bytes_read = 0;
+	std::size_t uninitialized = 0;
+
+	while (done < size) {
+		RVN_MEMORY_STATS(++parts);
+
+		const std::uint64_t address = physical_address + done;
+		RVN_MEMORY_STATS(stats.counters().chunk_lookups.add(1));
+		const MemoryChunk* chunk = chunk_at(address);
+
+		std::size_t length = size - done;
+
+		if (chunk == nullptr) {
+			// Chunks are sorted by decreasing address: the next chunk is the one before the lower bound.
+			auto next_chunk = chunks_.lower_bound(address);
+
+			if (next_chunk != chunks_.begin()) {
+				length = std::min<std::uint64_t>(length, std::prev(next_chunk)->first - address);
+			}
+
+			std::memset(output + done, 0, length);
+		} else {
+			length = std::min<std::uint64_t>(length, chunk->physical_address() + chunk->size_in_memory() - address);
+
+			const read_result chunk_result = chunk->try_read(address, output + done, length);
+			bytes_read += chunk_result.bytes_read;
+
+			if (chunk_result.status == read_status::io_error) {
+				std::memset(output + done + length, 0, size - done - length);
+				return read_result{ read_status::io_error, bytes_read };
+			}
+
+			uninitialized += length - chunk_result.bytes_read;
+		}
+
+		done += length;
+	}
+
+	RVN_MEMORY_STATS(stats.counters().zero_filled_bytes.add(size - bytes_read));
+	RVN_MEMORY_STATS(if (bytes_read + uninitialized < size) stats.counters().hole_reads.add(1));
+	RVN_MEMORY_STATS(if (parts > 1) stats.counters().cross_chunk_reads.add(1));
+
+	return read_result{ make_read_status(size, bytes_read, uninitialized), bytes_read };
+}
+
+memory_stats MemoryVirtualBox::stats() const
+{
+	return stats_.get() ? stats_.get()->total() : memory_stats();
+}
+
+void MemoryVirtualBox::reset_stats()
+{
+	if (stats_.get()) {
+		stats_.get()->reset();
+	}
 }
 
 void MemoryVirtualBox::visit_chunks(std::function<void(const MemoryChunk&)> visitor) const
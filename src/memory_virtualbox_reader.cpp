@@ -0,0 +1,33 @@
+#include <memory_virtualbox_reader.h>
+
+#include <stdexcept>
+
+namespace reven {
+namespace vmghost {
+
+MemoryVirtualBoxReader::MemoryVirtualBoxReader(const MemoryVirtualBox& memory)
+{
+	memory.visit_chunks([this](const MemoryChunk& memory_chunk) {
+		const std::uint64_t backed_size = std::min(memory_chunk.size_in_file(), memory_chunk.size_in_memory());
+		const std::uint8_t* data = nullptr;
+
+		if (backed_size > 0) {
+			if (not memory_chunk.file()) {
+				throw std::runtime_error("Can't map a chunk that is not backed by a core file.");
+			}
+
+			if (memory_chunk.offset_in_file() + backed_size > memory_chunk.file()->size()) {
+				throw std::runtime_error("Memory chunk is beyond the end of the core file.");
+			}
+
+			data = memory_chunk.file()->data() + memory_chunk.offset_in_file();
+		}
+
+		chunks_.push_back(chunk{ memory_chunk.physical_address(), memory_chunk.size_in_memory(), backed_size, data });
+	});
+
+	// Chunks are visited in decreasing order.
+	std::reverse(chunks_.begin(), chunks_.end());
+}
+}
+} // namespace reven::vmghost
@@ -0,0 +1,177 @@
+#pragma once
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace reven {
+namespace vmghost {
+
+//!
+//! File written sequentially through a large buffer, with positional writes to patch what was already written
+//!   (e.g. a header whose content is known last).
+//!
+class output_file {
+public:
+	//! Creates or truncates @c path, or appends to it with @c append. Throws @c std::runtime_error if it can't be
+	//!   opened.
+	explicit output_file(std::string const& path, bool append = false, std::size_t buffer_size = 1 << 20)
+	{
+		fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | (append ? 0 : O_TRUNC) | O_CLOEXEC, 0644);
+
+		if (fd_ < 0) {
+			throw std::runtime_error("Can't create the file " + path + ": " + std::strerror(errno));
+		}
+
+		if (append) {
+			const off_t end = ::lseek(fd_, 0, SEEK_END);
+
+			if (end < 0) {
+				::close(fd_);
+				throw std::runtime_error("Can't open the file " + path + ": " + std::strerror(errno));
+			}
+
+			flushed_ = static_cast<std::uint64_t>(end);
+		}
+
+		buffer_.reserve(buffer_size);
+	}
+
+	output_file(output_file const&) = delete;
+	output_file& operator=(output_file const&) = delete;
+
+	//! Closes the file. Data still buffered is dropped if @c close() was not called.
+	~output_file()
+	{
+		if (fd_ >= 0) {
+			::close(fd_);
+		}
+	}
+
+	int fd() const { return fd_; }
+
+	//! Size of the data already written.
+	std::uint64_t flushed_offset() const { return flushed_; }
+
+	//! Offset of the next appended byte.
+	std::uint64_t offset() const { return flushed_ + buffer_.size(); }
+
+	void append(const void* data, std::size_t size)
+	{
+		auto input = static_cast<const std::uint8_t*>(data);
+
+		// Large appends skip the buffer.
+		if (size >= buffer_.capacity()) {
+			flush();
+			write_at(flushed_, input, size);
+			flushed_ += size;
+			return;
+		}
+
+		while (size > 0) {
+			if (buffer_.size() == buffer_.capacity()) {
+				flush();
+			}
+
+			const std::size_t length = std::min(size, buffer_.capacity() - buffer_.size());
+			buffer_.insert(buffer_.end(), input, input + length);
+
+			input += length;
+			size -= length;
+		}
+	}
+
+	template <typename DataType> void append(DataType const& data) { append(&data, sizeof(data)); }
+
+	//! The @c size bytes at @c offset if they are still buffered, null otherwise.
+	const std::uint8_t* buffered_data(std::uint64_t offset, std::size_t size) const
+	{
+		if (offset < flushed_ or offset + size > flushed_ + buffer_.size()) {
+			return nullptr;
+		}
+
+		return buffer_.data() + (offset - flushed_);
+	}
+
+	//! Appends zeros up to the next multiple of @c alignment.
+	void align(std::uint64_t alignment)
+	{
+		static const std::uint8_t zeros[64] = {};
+
+		while (offset() % alignment != 0) {
+			append(zeros, static_cast<std::size_t>(std::min<std::uint64_t>(sizeof(zeros),
+			                                                                alignment - offset() % alignment)));
+		}
+	}
+
+	//! Writes the buffered data.
+	void flush()
+	{
+		write_at(flushed_, buffer_.data(), buffer_.size());
+		flushed_ += buffer_.size();
+		buffer_.clear();
+	}
+
+	//! Accounts for @c size bytes appended directly through @c fd(), after a @c flush().
+	void appended(std::uint64_t size) { flushed_ += size; }
+
+	//! Moves the end of the file to @c offset without writing the bytes in between, which read as zeros.
+	void skip_to(std::uint64_t offset)
+	{
+		flush();
+
+		if (::ftruncate(fd_, offset) != 0) {
+			throw std::runtime_error(std::string("Can't resize the file: ") + std::strerror(errno));
+		}
+
+		flushed_ = offset;
+	}
+
+	//! Writes at @c offset, which must be below the flushed data.
+	void write_at(std::uint64_t offset, const void* data, std::size_t size)
+	{
+		auto input = static_cast<const char*>(data);
+
+		while (size > 0) {
+			const ssize_t written = ::pwrite(fd_, input, size, static_cast<off_t>(offset));
+
+			if (written < 0) {
+				if (errno == EINTR) {
+					continue;
+				}
+
+				throw std::runtime_error(std::string("Can't write the file: ") + std::strerror(errno));
+			}
+
+			input += written;
+			offset += static_cast<std::uint64_t>(written);
+			size -= static_cast<std::size_t>(written);
+		}
+	}
+
+	//! Flushes and closes the file.
+	void close()
+	{
+		flush();
+
+		if (::close(fd_) != 0) {
+			fd_ = -1;
+			throw std::runtime_error(std::string("Can't close the file: ") + std::strerror(errno));
+		}
+
+		fd_ = -1;
+	}
+
+private:
+	int fd_{-1};
+	std::uint64_t flushed_{0};
+	std::vector<std::uint8_t> buffer_;
+};
+}
+} // namespace reven::vmghost
@@ -0,0 +1,274 @@
+#include <overlay_memory.h>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace reven {
+namespace vmghost {
+
+constexpr std::size_t overlay_memory::page_size;
+
+//!
+//! Pool of pages allocated by slabs, and recycled through a free list.
+//!
+class overlay_memory::page_arena {
+public:
+	std::uint8_t* allocate()
+	{
+		if (free_.empty()) {
+			slabs_.emplace_back(new std::uint8_t[slab_pages * page_size]);
+
+			for (std::size_t i = slab_pages; i > 0; --i) {
+				free_.push_back(slabs_.back().get() + (i - 1) * page_size);
+			}
+		}
+
+		auto data = free_.back();
+		free_.pop_back();
+		return data;
+	}
+
+	void release(std::uint8_t* data) { free_.push_back(data); }
+
+	void clear()
+	{
+		free_.clear();
+		slabs_.clear();
+	}
+
+private:
+	static constexpr std::size_t slab_pages = 64;
+
+	std::vector<std::unique_ptr<std::uint8_t[]>> slabs_;
+	std::vector<std::uint8_t*> free_;
+};
+
+constexpr std::size_t overlay_memory::page_arena::slab_pages;
+
+overlay_memory::overlay_memory(std::shared_ptr<const physical_memory> base)
+  : base_(std::move(base)), arena_(new page_arena)
+{
+	if (not base_) {
+		throw std::runtime_error("An overlay needs a base memory.");
+	}
+}
+
+overlay_memory::~overlay_memory() = default;
+
+const std::uint8_t* overlay_memory::dirty_page(std::uint64_t page) const
+{
+	if (not is_dirty(page)) {
+		return nullptr;
+	}
+
+	return pages_.find(page)->second.data;
+}
+
+std::vector<std::uint64_t> overlay_memory::dirty_pages() const
+{
+	std::vector<std::uint64_t> result;
+	result.reserve(pages_.size());
+
+	for (std::size_t word = 0; word < dirty_bits_.size(); ++word) {
+		for (std::uint64_t bits = dirty_bits_[word]; bits != 0; bits &= bits - 1) {
+			result.push_back(word * 64 + static_cast<std::uint64_t>(__builtin_ctzll(bits)));
+		}
+	}
+
+	return result;
+}
+
+void overlay_memory::set_dirty(std::uint64_t page, bool dirty)
+{
+	const std::size_t word = static_cast<std::size_t>(page / 64);
+
+	if (word >= dirty_bits_.size()) {
+		dirty_bits_.resize(word + 1, 0);
+	}
+
+	if (dirty) {
+		dirty_bits_[word] |= 1ull << (page % 64);
+	} else {
+		dirty_bits_[word] &= ~(1ull << (page % 64));
+	}
+}
+
+void overlay_memory::write_buffer(std::uint64_t physical_address, const void* buffer, std::size_t size)
+{
+	auto input = static_cast<const std::uint8_t*>(buffer);
+
+	while (size > 0) {
+		const std::uint64_t page_number = physical_address / page_size;
+		const std::size_t offset = static_cast<std::size_t>(physical_address % page_size);
+		const std::size_t length = std::min(size, page_size - offset);
+
+		auto found = pages_.find(page_number);
+
+		if (found == pages_.end()) {
+			auto data = arena_->allocate();
+
+			// Unlike read_buffer, try_read_buffer zero-fills uninitialized chunk tails and pages across chunks.
+			if (base_->try_read_buffer(page_number * page_size, data, page_size).status == read_status::io_error) {
+				arena_->release(data);
+				throw std::runtime_error("Can't read the base memory.");
+			}
+
+			if (not checkpoints_.empty()) {
+				undo_log_.push_back(undo_entry{ page_number, nullptr, 0 });
+			}
+
+			found = pages_.emplace(page_number, page{ data, checkpoints_.size() }).first;
+			set_dirty(page_number, true);
+		} else if (found->second.saved_depth < checkpoints_.size()) {
+			auto saved = arena_->allocate();
+			std::memcpy(saved, found->second.data, page_size);
+
+			undo_log_.push_back(undo_entry{ page_number, saved, found->second.saved_depth });
+			found->second.saved_depth = checkpoints_.size();
+		}
+
+		std::memcpy(found->second.data + offset, input, length);
+
+		physical_address += length;
+		input += length;
+		size -= length;
+	}
+}
+
+overlay_memory::checkpoint_id overlay_memory::checkpoint()
+{
+	checkpoints_.push_back(checkpoint_mark{ next_checkpoint_, undo_log_.size() });
+	return next_checkpoint_++;
+}
+
+void overlay_memory::rollback(checkpoint_id checkpoint)
+{
+	const auto mark = std::lower_bound(checkpoints_.begin(), checkpoints_.end(), checkpoint,
+	                                   [](checkpoint_mark const& mark, checkpoint_id id) { return mark.id < id; });
+
+	if (mark == checkpoints_.end() or mark->id != checkpoint) {
+		throw std::runtime_error("Unknown checkpoint.");
+	}
+
+	const std::size_t log_size = mark->log_size;
+
+	while (undo_log_.size() > log_size) {
+		const undo_entry& entry = undo_log_.back();
+		auto found = pages_.find(entry.page);
+
+		arena_->release(found->second.data);
+
+		if (entry.data == nullptr) {
+			pages_.erase(found);
+			set_dirty(entry.page, false);
+		} else {
+			found->second.data = entry.data;
+			found->second.saved_depth = entry.saved_depth;
+		}
+
+		undo_log_.pop_back();
+	}
+
+	checkpoints_.erase(mark, checkpoints_.end());
+}
+
+void overlay_memory::reset()
+{
+	pages_.clear();
+	dirty_bits_.clear();
+	undo_log_.clear();
+	checkpoints_.clear();
+	arena_->clear();
+}
+
+template <typename CleanVisitor, typename DirtyVisitor>
+void overlay_memory::split(std::uint64_t physical_address, std::size_t size, CleanVisitor&& clean,
+                           DirtyVisitor&& dirty) const
+{
+	std::size_t done = 0;
+	std::size_t clean_begin = 0;
+	bool in_clean_run = false;
+
+	while (done < size) {
+		const std::uint64_t address = physical_address + done;
+		const std::uint64_t page_number = address / page_size;
+		const std::size_t offset = static_cast<std::size_t>(address % page_size);
+		const std::size_t length = std::min(size - done, page_size - offset);
+
+		if (is_dirty(page_number)) {
+			if (in_clean_run) {
+				clean(physical_address + clean_begin, done - clean_begin, clean_begin);
+				in_clean_run = false;
+			}
+
+			dirty(pages_.find(page_number)->second.data + offset, length, done);
+		} else if (not in_clean_run) {
+			clean_begin = done;
+			in_clean_run = true;
+		}
+
+		done += length;
+	}
+
+	if (in_clean_run) {
+		clean(physical_address + clean_begin, size - clean_begin, clean_begin);
+	}
+}
+
+bool overlay_memory::do_read(std::uint64_t physical_address, std::uint8_t& data) const
+{
+	if (is_dirty(physical_address / page_size)) {
+		data = pages_.find(physical_address / page_size)->second.data[physical_address % page_size];
+		return true;
+	}
+
+	return base_->read(physical_address, data);
+}
+
+void overlay_memory::do_read_buffer(std::uint64_t physical_address, void* buffer, std::size_t size) const
+{
+	auto output = static_cast<std::uint8_t*>(buffer);
+
+	split(physical_address, size,
+	      [&](std::uint64_t address, std::size_t length, std::size_t offset) {
+		      base_->read_buffer(address, output + offset, length);
+	      },
+	      [&](const std::uint8_t* data, std::size_t length, std::size_t offset) {
+		      std::memcpy(output + offset, data, length);
+	      });
+}
+
+read_result overlay_memory::do_try_read_buffer(std::uint64_t physical_address, void* buffer,
+                                               std::size_t size) const noexcept
+{
+	auto output = static_cast<std::uint8_t*>(buffer);
+
+	std::size_t bytes_read = 0;
+	std::size_t uninitialized = 0;
+	bool io_error = false;
+
+	split(physical_address, size,
+	      [&](std::uint64_t address, std::size_t length, std::size_t offset) {
+		      const auto result = base_->try_read_buffer(address, output + offset, length);
+		      bytes_read += result.bytes_read;
+
+		      if (result.status == read_status::io_error) {
+			      io_error = true;
+		      } else if (result.status == read_status::uninitialized) {
+			      uninitialized += length;
+		      }
+	      },
+	      [&](const std::uint8_t* data, std::size_t length, std::size_t offset) {
+		      std::memcpy(output + offset, data, length);
+		      bytes_read += length;
+	      });
+
+	if (io_error) {
+		return read_result{ read_status::io_error, bytes_read };
+	}
+
+	return read_result{ make_read_status(size, bytes_read, uninitialized), bytes_read };
+}
+}
+} // namespace reven::vmghost
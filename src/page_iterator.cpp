@@ -0,0 +1,68 @@
+#include <page_iterator.h>
+
+#include <stdexcept>
+
+namespace reven {
+namespace vmghost {
+
+page_range::page_range(const MemoryVirtualBox& memory, std::size_t page_size) : page_size_(page_size)
+{
+	memory.visit_chunks([this](const MemoryChunk& chunk) {
+		const std::uint64_t backed_size = std::min(chunk.size_in_file(), chunk.size_in_memory());
+
+		if (backed_size == 0) {
+			return;
+		}
+
+		if (not chunk.file()) {
+			throw std::runtime_error("Can't map a chunk that is not backed by a core file.");
+		}
+
+		if (chunk.offset_in_file() + backed_size > chunk.file()->size()) {
+			throw std::runtime_error("Memory chunk is beyond the end of the core file.");
+		}
+
+		runs_.push_back(page_span{ chunk.physical_address(), chunk.file()->data() + chunk.offset_in_file(),
+		                           static_cast<std::size_t>(backed_size) });
+	});
+
+	// Chunks are visited in decreasing order.
+	std::reverse(runs_.begin(), runs_.end());
+
+	first_page_.reserve(runs_.size() + 1);
+	first_page_.push_back(0);
+
+	for (auto const& run : runs_) {
+		std::uint64_t pages = 1;
+
+		if (page_size_) {
+			const std::uint64_t first = run.physical_address / page_size_;
+			const std::uint64_t last = (run.physical_address + run.size - 1) / page_size_;
+			pages = last - first + 1;
+		}
+
+		first_page_.push_back(first_page_.back() + pages);
+	}
+}
+
+page_range::iterator page_range::at(std::uint64_t page) const
+{
+	if (page >= page_count()) {
+		return end();
+	}
+
+	// Last run whose first page is not after the requested one.
+	const std::size_t run = std::upper_bound(first_page_.begin(), first_page_.end(), page) - first_page_.begin() - 1;
+	const std::uint64_t index_in_run = page - first_page_[run];
+
+	std::uint64_t offset = 0;
+
+	if (index_in_run > 0) {
+		const std::uint64_t run_address = runs_[run].physical_address;
+		offset = (run_address / page_size_ + index_in_run) * page_size_ - run_address;
+	}
+
+	return iterator(this, run, offset);
+}
+}
+} // namespace reven::vmghost
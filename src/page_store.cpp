@@ -0,0 +1,698 @@
+#include <page_store.h>
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#include "cpu_record.h"
+#include "file_copy.h"
+#include "output_file.h"
+#include "thread_pool.h"
+
+namespace reven {
+namespace vmghost {
+
+namespace {
+
+constexpr char index_magic[8] = { 'R', 'V', 'N', 'P', 'S', 'I', 'D', 'X' };
+constexpr char core_magic[8] = { 'R', 'V', 'N', 'P', 'S', 'C', 'O', 'R' };
+constexpr std::uint32_t store_format_version = 1;
+
+//! Pages read and hashed per batch, split across the threads.
+constexpr std::size_t batch_pages = 4096;
+
+//!
+//! Start of the index file, followed by @c entry_count entries sorted by hash then id.
+//!
+struct index_header {
+	char magic[8];
+	std::uint32_t version;
+	std::uint32_t page_size;
+	//! The index covers the pages [0, page_count) of the pack.
+	std::uint64_t page_count;
+	std::uint64_t entry_count;
+};
+
+//!
+//! Start of a stored core file, followed by the CPU records, the regions and the page ids.
+//!
+struct core_header {
+	char magic[8];
+	std::uint32_t version;
+	std::uint32_t page_size;
+	vbox::DBGFCOREDESCRIPTOR descriptor;
+	std::uint64_t cpu_count;
+	std::uint64_t cpu_record_size;
+	std::uint64_t region_count;
+	std::uint64_t page_count;
+};
+
+static_assert(sizeof(stored_memory::region) == 24, "Invalid stored_memory::region size");
+
+// XXH64 of a page, with a seed of 0.
+
+constexpr std::uint64_t prime1 = 0x9e3779b185ebca87ULL;
+constexpr std::uint64_t prime2 = 0xc2b2ae3d27d4eb4fULL;
+constexpr std::uint64_t prime3 = 0x165667b19e3779f9ULL;
+constexpr std::uint64_t prime4 = 0x85ebca77c2b2ae63ULL;
+
+inline std::uint64_t rotate_left(std::uint64_t value, unsigned bits)
+{
+	return (value << bits) | (value >> (64 - bits));
+}
+
+inline std::uint64_t hash_round(std::uint64_t accumulator, std::uint64_t input)
+{
+	return rotate_left(accumulator + input * prime2, 31) * prime1;
+}
+
+inline std::uint64_t hash_merge(std::uint64_t accumulator, std::uint64_t lane)
+{
+	return (accumulator ^ hash_round(0, lane)) * prime1 + prime4;
+}
+
+std::uint64_t hash_page(const std::uint8_t* data)
+{
+	std::uint64_t lanes[4] = { prime1 + prime2, prime2, 0, 0 - prime1 };
+
+	for (std::size_t offset = 0; offset < page_store::page_size; offset += sizeof(lanes)) {
+		std::uint64_t input[4];
+		std::memcpy(input, data + offset, sizeof(input));
+
+		for (unsigned i = 0; i < 4; ++i) {
+			lanes[i] = hash_round(lanes[i], input[i]);
+		}
+	}
+
+	std::uint64_t hash = rotate_left(lanes[0], 1) + rotate_left(lanes[1], 7) + rotate_left(lanes[2], 12) +
+	                     rotate_left(lanes[3], 18);
+
+	for (unsigned i = 0; i < 4; ++i) {
+		hash = hash_merge(hash, lanes[i]);
+	}
+
+	hash += page_store::page_size;
+
+	hash ^= hash >> 33;
+	hash *= prime2;
+	hash ^= hash >> 29;
+	hash *= prime3;
+	hash ^= hash >> 32;
+
+	return hash;
+}
+
+void make_directory(std::string const& path)
+{
+	if (::mkdir(path.c_str(), 0755) != 0 and errno != EEXIST) {
+		throw std::runtime_error("Can't create the directory " + path + ": " + std::strerror(errno));
+	}
+}
+
+bool file_exists(std::string const& path)
+{
+	struct stat st;
+	return ::stat(path.c_str(), &st) == 0;
+}
+
+void rename_file(std::string const& from, std::string const& to)
+{
+	if (std::rename(from.c_str(), to.c_str()) != 0) {
+		throw std::runtime_error("Can't rename " + from + ": " + std::strerror(errno));
+	}
+}
+
+//! The page ranges covering @c ranges, sorted and merged.
+std::vector<memory_range> page_ranges(std::vector<memory_range> ranges)
+{
+	for (auto& range : ranges) {
+		range.begin = range.begin / page_store::page_size * page_store::page_size;
+		range.end = (range.end + page_store::page_size - 1) / page_store::page_size * page_store::page_size;
+	}
+
+	std::sort(ranges.begin(), ranges.end(),
+	          [](memory_range const& a, memory_range const& b) { return a.begin < b.begin; });
+
+	std::vector<memory_range> merged;
+
+	for (auto const& range : ranges) {
+		if (range.begin == range.end) {
+			continue;
+		}
+
+		if (not merged.empty() and range.begin <= merged.back().end) {
+			merged.back().end = std::max(merged.back().end, range.end);
+		} else {
+			merged.push_back(range);
+		}
+	}
+
+	return merged;
+}
+
+} // anonymous namespace
+
+constexpr std::size_t page_store::page_size;
+constexpr page_id page_store::zero_page;
+
+stored_memory::stored_memory(std::shared_ptr<core_file> pack, std::vector<region> regions,
+                             std::vector<page_id> pages)
+  : pack_(std::move(pack)), regions_(std::move(regions)), pages_(std::move(pages))
+{
+}
+
+bool stored_memory::page_at(std::uint64_t page, page_id& id) const
+{
+	// The first region ending after the page.
+	auto region = std::upper_bound(regions_.begin(), regions_.end(), page,
+	                               [](std::uint64_t number, struct region const& entry) {
+		                               return number < entry.first_page + entry.page_count;
+	                               });
+
+	if (region == regions_.end() or page < region->first_page) {
+		return false;
+	}
+
+	id = pages_[region->first_index + (page - region->first_page)];
+	return true;
+}
+
+bool stored_memory::do_read(std::uint64_t physical_address, std::uint8_t& data) const
+{
+	page_id id;
+	const bool mapped = page_at(physical_address / page_store::page_size, id);
+
+	do_read_buffer(physical_address, &data, 1);
+	return mapped;
+}
+
+void stored_memory::do_read_buffer(std::uint64_t physical_address, void* buffer, std::size_t size) const
+{
+	auto output = static_cast<std::uint8_t*>(buffer);
+
+	while (size > 0) {
+		const std::uint64_t offset = physical_address % page_store::page_size;
+		const std::size_t length = static_cast<std::size_t>(std::min<std::uint64_t>(size, page_store::page_size - offset));
+
+		page_id id;
+
+		if (not page_at(physical_address / page_store::page_size, id) or id == page_store::zero_page) {
+			std::memset(output, 0, length);
+		} else {
+			pack_->read(std::uint64_t(id) * page_store::page_size + offset, output, length);
+		}
+
+		physical_address += length;
+		output += length;
+		size -= length;
+	}
+}
+
+read_result stored_memory::do_try_read_buffer(std::uint64_t physical_address, void* buffer,
+                                              std::size_t size) const noexcept
+{
+	auto output = static_cast<std::uint8_t*>(buffer);
+
+	std::size_t bytes_read = 0;
+	bool io_error = false;
+
+	for (std::size_t done = 0; done < size;) {
+		const std::uint64_t address = physical_address + done;
+		const std::uint64_t offset = address % page_store::page_size;
+		const std::size_t length =
+		  static_cast<std::size_t>(std::min<std::uint64_t>(size - done, page_store::page_size - offset));
+
+		page_id id;
+
+		if (not page_at(address / page_store::page_size, id)) {
+			std::memset(output + done, 0, length);
+		} else if (id == page_store::zero_page) {
+			std::memset(output + done, 0, length);
+			bytes_read += length;
+		} else {
+			const std::size_t read = static_cast<std::size_t>(
+			  pack_->try_read(std::uint64_t(id) * page_store::page_size + offset, output + done, length));
+
+			std::memset(output + done + read, 0, length - read);
+			bytes_read += read;
+			io_error = io_error or read < length;
+		}
+
+		done += length;
+	}
+
+	if (io_error) {
+		return read_result{ read_status::io_error, bytes_read };
+	}
+
+	return read_result{ make_read_status(size, bytes_read, 0), bytes_read };
+}
+
+page_store::page_store(std::string const& directory, bool read_only) : directory_(directory)
+{
+	const std::string pack_path = directory_ + "/pages.pack";
+
+	if (read_only) {
+		if (not file_exists(pack_path)) {
+			throw std::runtime_error("No page store in " + directory_);
+		}
+
+		pack_reader_ = std::make_shared<core_file>(pack_path);
+		page_count_ = pack_reader_->size() / page_size;
+	} else {
+		make_directory(directory_);
+		make_directory(directory_ + "/cores");
+
+		pack_.reset(new output_file(pack_path, true));
+
+		// A page torn by an interrupted write is dropped.
+		page_count_ = pack_->offset() / page_size;
+
+		if (pack_->offset() % page_size != 0) {
+			pack_->skip_to(page_count_ * page_size);
+		}
+
+		pack_reader_ = std::make_shared<core_file>(pack_path);
+	}
+
+	map_index();
+
+	// Pages written after the index are indexed again.
+	std::vector<std::uint8_t> page(page_size);
+
+	for (std::uint64_t id = indexed_pages_; id < page_count_; ++id) {
+		pack_reader_->read(id * page_size, page.data(), page_size);
+		pending_.emplace(hash_page(page.data()), static_cast<page_id>(id));
+	}
+}
+
+page_store::~page_store()
+{
+	if (read_only()) {
+		return;
+	}
+
+	try {
+		flush();
+	} catch (...) {
+	}
+}
+
+void page_store::map_index()
+{
+	const std::string path = directory_ + "/pages.index";
+
+	index_file_.reset();
+	index_ = nullptr;
+	index_size_ = 0;
+	indexed_pages_ = 0;
+
+	if (not file_exists(path)) {
+		return;
+	}
+
+	auto file = std::make_shared<core_file>(path);
+	const std::uint8_t* data = file->data();
+
+	index_header header;
+
+	if (file->size() < sizeof(header)) {
+		throw std::runtime_error("Invalid page store index.");
+	}
+
+	std::memcpy(&header, data, sizeof(header));
+
+	if (std::memcmp(header.magic, index_magic, sizeof(index_magic)) != 0 or header.version != store_format_version or
+	    header.page_size != page_size or header.page_count > page_count_ or
+	    file->size() != sizeof(header) + header.entry_count * sizeof(index_entry)) {
+		throw std::runtime_error("Invalid page store index.");
+	}
+
+	index_file_ = std::move(file);
+	index_ = reinterpret_cast<const index_entry*>(data + sizeof(header));
+	index_size_ = header.entry_count;
+	indexed_pages_ = header.page_count;
+}
+
+void page_store::flush()
+{
+	if (read_only()) {
+		throw std::runtime_error("The page store is read-only.");
+	}
+
+	pack_->flush();
+
+	if (pending_.empty() and indexed_pages_ == page_count_) {
+		return;
+	}
+
+	std::vector<index_entry> added;
+	added.reserve(pending_.size());
+
+	for (auto const& entry : pending_) {
+		added.push_back(index_entry{ entry.first, entry.second, 0 });
+	}
+
+	const auto by_hash = [](index_entry const& a, index_entry const& b) {
+		return a.hash < b.hash or (a.hash == b.hash and a.id < b.id);
+	};
+
+	std::sort(added.begin(), added.end(), by_hash);
+
+	std::vector<index_entry> entries(index_size_ + added.size());
+	std::merge(index_, index_ + index_size_, added.begin(), added.end(), entries.begin(), by_hash);
+
+	index_header header{};
+	std::memcpy(header.magic, index_magic, sizeof(index_magic));
+	header.version = store_format_version;
+	header.page_size = page_size;
+	header.page_count = page_count_;
+	header.entry_count = entries.size();
+
+	// The new index replaces the old one at once, so that a reader never sees a partial index.
+	const std::string path = directory_ + "/pages.index";
+
+	output_file file(path + ".tmp");
+	file.append(header);
+	file.append(entries.data(), entries.size() * sizeof(index_entry));
+	file.close();
+
+	rename_file(path + ".tmp", path);
+
+	map_index();
+	pending_.clear();
+}
+
+bool page_store::has_content(page_id id, const std::uint8_t* page) const
+{
+	const std::uint64_t offset = std::uint64_t(id) * page_size;
+
+	if (pack_) {
+		if (const std::uint8_t* buffered = pack_->buffered_data(offset, page_size)) {
+			return std::memcmp(buffered, page, page_size) == 0;
+		}
+	}
+
+	std::uint8_t stored[page_size];
+	pack_reader_->read(offset, stored, page_size);
+
+	return std::memcmp(stored, page, page_size) == 0;
+}
+
+bool page_store::find_page(const std::uint8_t* page, page_id& id) const
+{
+	return find_page(page, hash_page(page), id);
+}
+
+bool page_store::find_page(const std::uint8_t* page, std::uint64_t hash, page_id& id) const
+{
+	const auto pending = pending_.equal_range(hash);
+
+	for (auto entry = pending.first; entry != pending.second; ++entry) {
+		if (has_content(entry->second, page)) {
+			id = entry->second;
+			return true;
+		}
+	}
+
+	auto entry = std::lower_bound(index_, index_ + index_size_, hash,
+	                              [](index_entry const& a, std::uint64_t value) { return a.hash < value; });
+
+	for (; entry != index_ + index_size_ and entry->hash == hash; ++entry) {
+		if (has_content(entry->id, page)) {
+			id = entry->id;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+std::string page_store::core_path(std::string const& name) const
+{
+	if (name.empty() or name[0] == '.' or name.find('/') != std::string::npos) {
+		throw std::runtime_error("Invalid core name.");
+	}
+
+	return directory_ + "/cores/" + name + ".core";
+}
+
+page_store_stats page_store::ingest(core_virtualbox const& core, std::string const& name, std::size_t threads)
+{
+	std::vector<memory_range> ranges;
+	const physical_memory_map map(*core.physical_memory());
+
+	for (auto const& region : map.regions()) {
+		ranges.push_back(memory_range{ region.begin, region.end });
+	}
+
+	const std::size_t cpu_count = static_cast<std::size_t>(core.cpu_end() - core.cpu_begin());
+
+	return ingest(name, core.descriptor(), cpu_count ? &*core.cpu_begin() : nullptr, cpu_count,
+	              *core.physical_memory(), ranges, threads);
+}
+
+page_store_stats page_store::ingest(std::string const& name, vbox::DBGFCOREDESCRIPTOR const& descriptor,
+                                    const cpu_virtualbox* cpus, std::size_t cpu_count, const physical_memory& memory,
+                                    std::vector<memory_range> const& ranges, std::size_t threads)
+{
+	if (read_only()) {
+		throw std::runtime_error("The page store is read-only.");
+	}
+
+	const std::string path = core_path(name);
+
+	for (std::size_t i = 1; i < cpu_count; ++i) {
+		if (cpus[i].version() != cpus[0].version()) {
+			throw std::runtime_error("All CPUs must have the same version.");
+		}
+	}
+
+	if (threads == 0) {
+		threads = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	page_store_stats stats;
+
+	std::vector<stored_memory::region> regions;
+	std::vector<page_id> pages;
+
+	std::vector<std::uint8_t> batch(batch_pages * page_size);
+	std::vector<std::uint64_t> hashes(batch_pages);
+	std::vector<std::uint8_t> zeros(batch_pages);
+
+	// The calling thread hashes its share of each batch along with a pool kept for the whole ingest.
+	std::unique_ptr<thread_pool> pool;
+
+	if (threads > 1) {
+		pool.reset(new thread_pool(threads - 1));
+	}
+
+	for (auto const& range : page_ranges(ranges)) {
+		const std::uint64_t first_page = range.begin / page_size;
+		const std::uint64_t end_page = range.end / page_size;
+
+		regions.push_back(stored_memory::region{ first_page, end_page - first_page, pages.size() });
+
+		for (std::uint64_t page = first_page; page < end_page; page += batch_pages) {
+			const std::size_t count = static_cast<std::size_t>(std::min<std::uint64_t>(batch_pages, end_page - page));
+			const std::size_t workers_count = std::min(threads, count);
+
+			std::exception_ptr error;
+			std::mutex mutex;
+			std::condition_variable finished;
+			std::size_t running = workers_count - 1;
+
+			// Each thread reads and hashes its share of the batch. Bytes that are not backed read as zeros.
+			auto work = [&](std::size_t first, std::size_t last) {
+				try {
+					std::uint8_t* data = batch.data() + first * page_size;
+
+					if (memory.try_read_buffer((page + first) * page_size, data, (last - first) * page_size).status ==
+					    read_status::io_error) {
+						throw std::runtime_error("Can't read the memory to store.");
+					}
+
+					for (std::size_t i = first; i < last; ++i, data += page_size) {
+						zeros[i] = is_zero(data, page_size);
+						hashes[i] = zeros[i] ? 0 : hash_page(data);
+					}
+				} catch (...) {
+					std::lock_guard<std::mutex> lock(mutex);
+
+					if (not error) {
+						error = std::current_exception();
+					}
+				}
+			};
+
+			for (std::size_t i = 1; i < workers_count; ++i) {
+				pool->post([&, i]() {
+					work(count * i / workers_count, count * (i + 1) / workers_count);
+
+					// Notified under the lock, so that the batch can't end and destroy the condition before.
+					std::lock_guard<std::mutex> lock(mutex);
+					--running;
+					finished.notify_one();
+				});
+			}
+
+			work(0, count / workers_count);
+
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				finished.wait(lock, [&running]() { return running == 0; });
+			}
+
+			if (error) {
+				std::rethrow_exception(error);
+			}
+
+			// Pages are looked up in order, so that a page repeated within the batch is stored once.
+			for (std::size_t i = 0; i < count; ++i) {
+				const std::uint8_t* data = batch.data() + i * page_size;
+				page_id id;
+
+				++stats.pages;
+
+				if (zeros[i]) {
+					id = zero_page;
+					++stats.zero_pages;
+				} else if (find_page(data, hashes[i], id)) {
+					++stats.shared_pages;
+				} else {
+					if (page_count_ >= zero_page) {
+						throw std::runtime_error("The page store is full.");
+					}
+
+					id = static_cast<page_id>(page_count_++);
+					pack_->append(data, page_size);
+					pending_.emplace(hashes[i], id);
+
+					// A page partly flushed when the buffer filled up in its middle is flushed whole, so that the
+					//   lookups can compare it without flushing.
+					const std::uint64_t offset = std::uint64_t(id) * page_size;
+
+					if (not pack_->buffered_data(offset, page_size) and offset + page_size > pack_->flushed_offset()) {
+						pack_->flush();
+					}
+					++stats.new_pages;
+				}
+
+				pages.push_back(id);
+			}
+		}
+	}
+
+	// The pages must be readable before the core refers to them.
+	pack_->flush();
+
+	core_header header{};
+	std::memcpy(header.magic, core_magic, sizeof(core_magic));
+	header.version = store_format_version;
+	header.page_size = page_size;
+	header.descriptor = descriptor;
+	header.cpu_count = cpu_count;
+	header.cpu_record_size = cpu_count ? cpu_record_size(cpus[0].version()) : 0;
+	header.region_count = regions.size();
+	header.page_count = pages.size();
+
+	output_file file(path + ".tmp");
+	file.append(header);
+
+	for (std::size_t i = 0; i < cpu_count; ++i) {
+		write_cpu_record(file, cpus[i]);
+	}
+
+	file.append(regions.data(), regions.size() * sizeof(stored_memory::region));
+	file.append(pages.data(), pages.size() * sizeof(page_id));
+	file.close();
+
+	rename_file(path + ".tmp", path);
+
+	return stats;
+}
+
+stored_core page_store::open(std::string const& name) const
+{
+	const std::string path = core_path(name);
+
+	if (not file_exists(path)) {
+		throw std::runtime_error("No core " + name + " in the page store.");
+	}
+
+	core_file file(path);
+	core_header header;
+
+	if (file.try_read(0, &header, sizeof(header)) != sizeof(header) or
+	    std::memcmp(header.magic, core_magic, sizeof(core_magic)) != 0 or
+	    header.version != store_format_version or header.page_size != page_size) {
+		throw std::runtime_error("Invalid stored core.");
+	}
+
+	// The tables must be in the file, which also bounds the allocations they size.
+	const std::uint64_t file_size = file.size();
+
+	auto fits = [file_size](std::uint64_t offset, std::uint64_t count, std::uint64_t element_size) {
+		return offset <= file_size and (count == 0 or (file_size - offset) / count >= element_size);
+	};
+
+	const std::uint64_t region_offset = sizeof(header) + header.cpu_count * header.cpu_record_size;
+	const std::uint64_t page_offset = region_offset + header.region_count * sizeof(stored_memory::region);
+
+	if ((header.cpu_count != 0 and header.cpu_record_size < sizeof(cpu_record_header)) or
+	    not fits(sizeof(header), header.cpu_count, header.cpu_record_size) or
+	    not fits(region_offset, header.region_count, sizeof(stored_memory::region)) or
+	    not fits(page_offset, header.page_count, sizeof(page_id))) {
+		throw std::runtime_error("Corrupted stored core: a table is outside of the file.");
+	}
+
+	std::vector<cpu_virtualbox, aligned_allocator<cpu_virtualbox>> cpus(header.cpu_count);
+	std::vector<std::uint8_t> record(header.cpu_record_size);
+
+	for (std::uint64_t i = 0; i < header.cpu_count; ++i) {
+		file.read(sizeof(header) + i * record.size(), record.data(), record.size());
+		cpus[i] = read_cpu_record(record.data(), record.size());
+	}
+
+	std::vector<stored_memory::region> regions(header.region_count);
+	file.read(region_offset, regions.data(), regions.size() * sizeof(stored_memory::region));
+
+	std::vector<page_id> pages(header.page_count);
+	file.read(page_offset, pages.data(), pages.size() * sizeof(page_id));
+
+	// Reads look regions up with a binary search: they must be sorted and disjoint, and within the address space.
+	constexpr std::uint64_t max_pages = (~0ull) / page_size;
+	std::uint64_t end_page = 0;
+
+	for (auto const& region : regions) {
+		const bool valid = region.page_count != 0 and region.first_page >= end_page and
+		                   region.page_count <= max_pages - region.first_page and
+		                   region.first_index <= pages.size() and region.page_count <= pages.size() - region.first_index;
+
+		if (not valid) {
+			throw std::runtime_error("Corrupted stored core: invalid region.");
+		}
+
+		end_page = region.first_page + region.page_count;
+	}
+
+	for (page_id id : pages) {
+		if (id != zero_page and id >= page_count_) {
+			throw std::runtime_error("Corrupted stored core: invalid page id.");
+		}
+	}
+
+	auto memory = std::make_shared<stored_memory>(pack_reader_, std::move(regions), std::move(pages));
+	return stored_core(header.descriptor, std::move(cpus), std::move(memory));
+}
+}
+} // namespace reven::vmghost
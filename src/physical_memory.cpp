@@ -1,14 +1,56 @@
 #include <physical_memory.h>
 #include "physical_memory_impl.h"
+#include "thread_pool.h"
+
+#include <cstring>
+#include <memory>
 
 namespace reven {
 namespace vmghost {
 
+namespace {
+
+//! Number of threads serving @c physical_memory::read_async. Reads are I/O bound, so this is not tied to the number
+//!   of cores.
+constexpr std::size_t async_read_threads = 16;
+
+thread_pool& async_read_pool()
+{
+	static thread_pool pool(async_read_threads);
+	return pool;
+}
+
+} // anonymous namespace
+
 bool physical_memory::read(std::uint64_t physical_address, std::uint8_t& data) const
 {
 	return do_read(physical_address, data);
 }
 
+std::future<void> physical_memory::do_read_async(std::uint64_t physical_address, void* buffer, std::size_t size) const
+{
+	auto task = std::make_shared<std::packaged_task<void()>>([this, physical_address, buffer, size]() {
+		do_read_buffer(physical_address, buffer, size);
+	});
+
+	auto result = task->get_future();
+	async_read_pool().post([task]() { (*task)(); });
+
+	return result;
+}
+
+read_result physical_memory::do_try_read_buffer(std::uint64_t physical_address, void* buffer,
+                                                std::size_t size) const noexcept
+{
+	try {
+		do_read_buffer(physical_address, buffer, size);
+		return read_result{ read_status::backed, size };
+	} catch (...) {
+		std::memset(buffer, 0, size);
+		return read_result{ read_status::io_error, 0 };
+	}
+}
+
 template bool physical_memory::read<std::uint16_t>(AddressType const&, std::uint16_t&) const;
 template bool physical_memory::read<std::uint32_t>(AddressType const&, std::uint32_t&) const;
 template bool physical_memory::read<std::uint64_t>(AddressType const&, std::uint64_t&) const;
@@ -0,0 +1,153 @@
+#include <physical_memory_map.h>
+
+#include <algorithm>
+
+namespace reven {
+namespace vmghost {
+
+physical_memory_map::physical_memory_map(const MemoryVirtualBox& memory)
+{
+	memory.visit_chunks([this](const MemoryChunk& chunk) {
+		if (chunk.size_in_memory() == 0) {
+			return;
+		}
+
+		const std::uint64_t begin = chunk.physical_address();
+		regions_.push_back(memory_region{ begin, begin + chunk.size_in_memory(),
+		                                  begin + std::min(chunk.size_in_file(), chunk.size_in_memory()) });
+	});
+
+	// Chunks are visited in decreasing order.
+	std::reverse(regions_.begin(), regions_.end());
+
+	backed_before_.reserve(regions_.size() + 1);
+	backed_before_.push_back(0);
+
+	for (auto const& region : regions_) {
+		backed_before_.push_back(backed_before_.back() + (region.backed_end - region.begin));
+	}
+}
+
+std::size_t physical_memory_map::first_ending_after(std::uint64_t address) const
+{
+	return std::upper_bound(regions_.begin(), regions_.end(), address,
+	                        [](std::uint64_t value, const memory_region& region) { return value < region.end; })
+	       - regions_.begin();
+}
+
+std::vector<memory_region> physical_memory_map::overlapping(std::uint64_t begin, std::uint64_t end) const
+{
+	std::vector<memory_region> result;
+
+	for (std::size_t i = first_ending_after(begin); i < regions_.size() and regions_[i].begin < end; ++i) {
+		result.push_back(regions_[i]);
+	}
+
+	return result;
+}
+
+bool physical_memory_map::next_backed(std::uint64_t address, std::uint64_t& backed_address) const
+{
+	for (std::size_t i = first_ending_after(address); i < regions_.size(); ++i) {
+		const memory_region& region = regions_[i];
+		const std::uint64_t candidate = std::max(address, region.begin);
+
+		if (candidate < region.backed_end) {
+			backed_address = candidate;
+			return true;
+		}
+
+		// Only the uninitialized tail of this region is left: the answer is in a later region.
+	}
+
+	return false;
+}
+
+std::uint64_t physical_memory_map::backed_bytes(std::uint64_t begin, std::uint64_t end) const
+{
+	if (begin >= end) {
+		return 0;
+	}
+
+	// Backed bytes strictly below an address.
+	auto backed_below = [this](std::uint64_t address) {
+		const std::size_t i = first_ending_after(address);
+
+		if (i == regions_.size() or address <= regions_[i].begin) {
+			return backed_before_[i];
+		}
+
+		return backed_before_[i] + (std::min(address, regions_[i].backed_end) - regions_[i].begin);
+	};
+
+	return backed_below(end) - backed_below(begin);
+}
+
+bool physical_memory_map::backed_address_at(std::uint64_t backed_offset, std::uint64_t& address) const
+{
+	if (backed_offset >= backed_bytes()) {
+		return false;
+	}
+
+	// Last region with at most backed_offset backed bytes before it, skipping empty ones.
+	const std::size_t i = std::upper_bound(backed_before_.begin(), backed_before_.end(), backed_offset)
+	                      - backed_before_.begin() - 1;
+
+	address = regions_[i].begin + (backed_offset - backed_before_[i]);
+	return true;
+}
+
+std::vector<memory_range> physical_memory_map::holes(std::uint64_t begin, std::uint64_t end) const
+{
+	std::vector<memory_range> result;
+	std::uint64_t cursor = begin;
+
+	for (std::size_t i = first_ending_after(begin); i < regions_.size() and regions_[i].begin < end; ++i) {
+		if (regions_[i].begin > cursor) {
+			result.push_back(memory_range{ cursor, regions_[i].begin });
+		}
+
+		cursor = std::max(cursor, regions_[i].end);
+	}
+
+	if (cursor < end) {
+		result.push_back(memory_range{ cursor, end });
+	}
+
+	return result;
+}
+
+std::vector<memory_range> physical_memory_map::partition(std::size_t parts, std::uint64_t alignment) const
+{
+	std::vector<memory_range> result;
+
+	if (regions_.empty() or parts == 0) {
+		return result;
+	}
+
+	const std::uint64_t total = backed_bytes();
+	const std::uint64_t last = regions_.back().end;
+
+	std::uint64_t begin = regions_.front().begin;
+
+	for (std::size_t i = 1; i < parts; ++i) {
+		std::uint64_t boundary;
+
+		if (not backed_address_at(total / parts * i + total % parts * i / parts, boundary)) {
+			break;
+		}
+
+		boundary &= ~(alignment - 1);
+
+		if (boundary > begin) {
+			result.push_back(memory_range{ begin, boundary });
+			begin = boundary;
+		}
+	}
+
+	result.push_back(memory_range{ begin, last });
+
+	return result;
+}
+}
+} // namespace reven::vmghost
@@ -0,0 +1,217 @@
+#include <pointer_chase.h>
+
+#include <memory_virtualbox.h>
+
+#include <array>
+#include <stdexcept>
+
+namespace reven {
+namespace vmghost {
+
+namespace {
+
+//!
+//! Direct-mapped cache of 4 KiB page translations.
+//!
+//! Nodes of a list are often allocated from the same pages, so the page table walks are mostly avoided.
+//!
+class translation_cache {
+public:
+	explicit translation_cache(const virtual_memory& memory) : memory_(memory)
+	{
+		for (auto& entry : entries_) {
+			entry.virtual_page = invalid_page;
+		}
+	}
+
+	bool translate(std::uint64_t virtual_address, std::uint64_t& physical_address)
+	{
+		const std::uint64_t virtual_page = virtual_address & ~page_mask;
+		auto& entry = entries_[(virtual_page >> 12) % entries_.size()];
+
+		if (entry.virtual_page != virtual_page) {
+			std::uint64_t physical_page;
+
+			if (not memory_.translate(virtual_page, physical_page)) {
+				return false;
+			}
+
+			entry.virtual_page = virtual_page;
+			entry.physical_page = physical_page;
+		}
+
+		physical_address = entry.physical_page | (virtual_address & page_mask);
+		return true;
+	}
+
+private:
+	static constexpr std::uint64_t page_mask = 0xfff;
+	static constexpr std::uint64_t invalid_page = ~0ull;
+
+	struct entry {
+		std::uint64_t virtual_page;
+		std::uint64_t physical_page;
+	};
+
+	const virtual_memory& memory_;
+	std::array<entry, 256> entries_;
+};
+
+constexpr std::uint64_t translation_cache::page_mask;
+constexpr std::uint64_t translation_cache::invalid_page;
+
+//! A physically contiguous part of a record, inside a single chunk of a @c MemoryVirtualBox.
+struct record_part {
+	std::uint64_t physical_address;
+	std::size_t offset;
+	std::size_t size;
+	//! The chunk of the part, null in a hole or for other memories.
+	const MemoryChunk* chunk;
+};
+
+//!
+//! Splits the record at @c address in physically contiguous parts. Returns false if a page is not mapped.
+//!
+//! With @c chunks, parts are also split at chunk boundaries: a @c read_buffer across adjacent chunks reads zeros.
+//!
+bool translate_record(translation_cache& cache, const MemoryVirtualBox* chunks, std::uint64_t address,
+                      std::size_t size, std::vector<record_part>& parts)
+{
+	parts.clear();
+
+	std::size_t offset = 0;
+
+	while (offset < size) {
+		std::uint64_t physical_address;
+
+		if (not cache.translate(address + offset, physical_address)) {
+			return false;
+		}
+
+		std::size_t part_size = std::min<std::size_t>(size - offset, 0x1000 - ((address + offset) & 0xfff));
+		const MemoryChunk* chunk = chunks ? chunks->chunk_at(physical_address) : nullptr;
+
+		if (chunk != nullptr) {
+			part_size = static_cast<std::size_t>(std::min<std::uint64_t>(
+			    part_size, chunk->physical_address() + chunk->size_in_memory() - physical_address));
+		}
+
+		if (not parts.empty() and parts.back().physical_address + parts.back().size == physical_address and
+		    parts.back().chunk == chunk) {
+			parts.back().size += part_size;
+		} else {
+			parts.push_back(record_part{ physical_address, offset, part_size, chunk });
+		}
+
+		offset += part_size;
+	}
+
+	return true;
+}
+
+//! Reads @c size bytes at @c offset in the record made of @c parts.
+void read_field(const physical_memory& memory, std::vector<record_part> const& parts, std::size_t offset, void* field,
+                std::size_t size)
+{
+	auto output = static_cast<std::uint8_t*>(field);
+
+	for (auto const& part : parts) {
+		if (size == 0) {
+			break;
+		}
+
+		if (offset >= part.offset + part.size) {
+			continue;
+		}
+
+		const std::size_t part_offset = offset - part.offset;
+		const std::size_t field_size = std::min(size, part.size - part_offset);
+		memory.read_buffer(part.physical_address + part_offset, output, field_size);
+
+		output += field_size;
+		offset += field_size;
+		size -= field_size;
+	}
+}
+
+} // anonymous namespace
+
+pointer_chase_result chase_pointers(const virtual_memory& memory, std::uint64_t start,
+                                    pointer_chase_options const& options)
+{
+	read_queue queue(memory.physical(), options.queue);
+	return chase_pointers(memory, queue, start, options);
+}
+
+pointer_chase_result chase_pointers(const virtual_memory& memory, read_queue& queue, std::uint64_t start,
+                                    pointer_chase_options const& options)
+{
+	if (options.record_size == 0 or options.next_offset + options.pointer_size > options.record_size) {
+		throw std::runtime_error("The next pointer must be inside the record.");
+	}
+
+	if (options.pointer_size != 4 and options.pointer_size != 8) {
+		throw std::runtime_error("Invalid pointer size.");
+	}
+
+	pointer_chase_result result;
+	result.record_size = options.record_size;
+	result.stop = pointer_chase_stop::limit;
+
+	translation_cache cache(memory);
+	const auto chunks = dynamic_cast<const MemoryVirtualBox*>(&memory.physical());
+	std::vector<record_part> parts;
+
+	const std::uint64_t link_adjustment = options.intrusive_links ? options.next_offset : 0;
+	const std::uint64_t first = start - link_adjustment;
+	std::uint64_t address = first;
+
+	while (result.addresses.size() < options.limit) {
+		if (not translate_record(cache, chunks, address, options.record_size, parts)) {
+			if (result.addresses.empty()) {
+				throw std::runtime_error("Virtual address is not mapped.");
+			}
+
+			result.stop = pointer_chase_stop::unmapped;
+			break;
+		}
+
+		const std::size_t index = result.addresses.size();
+		result.addresses.push_back(address);
+
+		if (result.records.size() < (index + 1) * options.record_size) {
+			// Queued reads target the buffer: drain them before it moves.
+			queue.wait_all();
+			result.records.resize(std::max<std::size_t>(64, 2 * (index + 1)) * options.record_size);
+		}
+
+		std::uint8_t* record = result.records.data() + index * options.record_size;
+
+		for (auto const& part : parts) {
+			queue.submit(part.physical_address, record + part.offset, part.size);
+		}
+
+		// Read the next pointer now, the rest of the record is still in flight.
+		std::uint64_t next = 0;
+		read_field(memory.physical(), parts, options.next_offset, &next, options.pointer_size);
+
+		if (next == 0) {
+			result.stop = pointer_chase_stop::null_pointer;
+			break;
+		}
+
+		address = next - link_adjustment;
+
+		if (address == first or (options.stop_address != 0 and next == options.stop_address)) {
+			result.stop = pointer_chase_stop::loop;
+			break;
+		}
+	}
+
+	queue.wait_all();
+	result.records.resize(result.addresses.size() * options.record_size);
+
+	return result;
+}
+}
+} // namespace reven::vmghost
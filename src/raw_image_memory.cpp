@@ -0,0 +1,181 @@
+#include <raw_image_memory.h>
+
+#include "file_copy.h"
+#include "output_file.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <vector>
+
+namespace reven {
+namespace vmghost {
+
+raw_image_memory::raw_image_memory(std::string const& path)
+  : file_(std::make_shared<core_file>(path)), size_(file_->size())
+{
+}
+
+std::size_t raw_image_memory::backed_size(std::uint64_t physical_address, std::size_t size) const
+{
+	if (physical_address >= size_) {
+		return 0;
+	}
+
+	return static_cast<std::size_t>(std::min<std::uint64_t>(size, size_ - physical_address));
+}
+
+bool raw_image_memory::do_read(std::uint64_t physical_address, std::uint8_t& data) const
+{
+	if (physical_address >= size_) {
+		return false;
+	}
+
+	file_->read(physical_address, &data, 1);
+	return true;
+}
+
+void raw_image_memory::do_read_buffer(std::uint64_t physical_address, void* buffer, std::size_t size) const
+{
+	const std::size_t backed = backed_size(physical_address, size);
+
+	file_->read(physical_address, buffer, backed);
+	std::memset(static_cast<std::uint8_t*>(buffer) + backed, 0, size - backed);
+}
+
+read_result raw_image_memory::do_try_read_buffer(std::uint64_t physical_address, void* buffer,
+                                                 std::size_t size) const noexcept
+{
+	auto output = static_cast<std::uint8_t*>(buffer);
+
+	const std::size_t backed = backed_size(physical_address, size);
+	const std::size_t bytes_read = static_cast<std::size_t>(file_->try_read(physical_address, output, backed));
+
+	std::memset(output + bytes_read, 0, size - bytes_read);
+
+	if (bytes_read < backed) {
+		// A short read of a file whose size we know is an I/O error, or a file truncated since it was opened.
+		return read_result{ read_status::io_error, bytes_read };
+	}
+
+	return read_result{ make_read_status(size, bytes_read, 0), bytes_read };
+}
+
+namespace {
+
+constexpr std::uint64_t image_page_size = 0x1000;
+
+//!
+//! Calls @c visitor(begin, end) for each range of [begin, end) of @c file that holds data, according to
+//!   @c SEEK_DATA and @c SEEK_HOLE. The whole range is data if the file system can't tell.
+//!
+template <typename Visitor> void visit_data(core_file const& file, std::uint64_t begin, std::uint64_t end,
+                                            Visitor&& visitor)
+{
+	while (begin < end) {
+		const off_t data = ::lseek(file.fd(), static_cast<off_t>(begin), SEEK_DATA);
+
+		if (data < 0) {
+			if (errno == ENXIO) {
+				// Only a hole until the end of the file.
+				return;
+			}
+
+			visitor(begin, end);
+			return;
+		}
+
+		if (static_cast<std::uint64_t>(data) >= end) {
+			return;
+		}
+
+		off_t hole = ::lseek(file.fd(), data, SEEK_HOLE);
+
+		if (hole < 0) {
+			hole = static_cast<off_t>(end);
+		}
+
+		const std::uint64_t data_end = std::min(end, static_cast<std::uint64_t>(hole));
+		visitor(static_cast<std::uint64_t>(data), data_end);
+
+		begin = data_end;
+	}
+}
+
+} // anonymous namespace
+
+raw_image_stats write_raw_image(MemoryVirtualBox const& memory, std::string const& path,
+                                raw_image_options const& options)
+{
+	raw_image_stats stats;
+
+	memory.visit_chunks([&stats](MemoryChunk const& chunk) {
+		if (not chunk.file()) {
+			throw std::runtime_error("A memory chunk is not backed by a core file.");
+		}
+
+		stats.image_size = std::max(stats.image_size, chunk.physical_address() + chunk.size_in_memory());
+	});
+
+	output_file image(path, false, 0);
+
+	// Everything not written from now on is a hole.
+	image.skip_to(stats.image_size);
+
+	file_copier copier(image);
+
+	memory.visit_chunks([&](MemoryChunk const& chunk) {
+		core_file const& file = *chunk.file();
+
+		const std::uint64_t backed = std::min(chunk.size_in_file(), chunk.size_in_memory());
+		const std::uint64_t file_begin = chunk.offset_in_file();
+		const std::uint64_t file_end = std::min(file_begin + backed, file.size());
+
+		// Physical address of the byte at file offset 0.
+		const std::uint64_t shift = chunk.physical_address() - file_begin;
+
+		visit_data(file, file_begin, file_end, [&](std::uint64_t begin, std::uint64_t end) {
+			if (not options.skip_zero_pages) {
+				copier.copy(file, begin, begin + shift, end - begin);
+				stats.copied_bytes += end - begin;
+				return;
+			}
+
+			const std::uint8_t* data = file.data();
+
+			// Copy the runs of pages of the image that are not all zeros.
+			std::uint64_t run_begin = begin;
+
+			for (std::uint64_t offset = begin; offset < end;) {
+				const std::uint64_t page_end =
+				    std::min(end, (offset + shift) / image_page_size * image_page_size + image_page_size - shift);
+				const std::size_t length = static_cast<std::size_t>(page_end - offset);
+
+				if (is_zero(data + offset, length)) {
+					if (run_begin < offset) {
+						copier.copy(file, run_begin, run_begin + shift, offset - run_begin);
+						stats.copied_bytes += offset - run_begin;
+					}
+
+					run_begin = page_end;
+					stats.zero_pages += length == image_page_size;
+				}
+
+				offset = page_end;
+			}
+
+			if (run_begin < end) {
+				copier.copy(file, run_begin, run_begin + shift, end - run_begin);
+				stats.copied_bytes += end - run_begin;
+			}
+		});
+	});
+
+	image.close();
+
+	return stats;
+}
+}
+} // namespace reven::vmghost
@@ -0,0 +1,619 @@
+#include <read_queue.h>
+#include <memory_virtualbox.h>
+
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+#ifdef RVNCOREVIRTUALBOX_HAVE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#endif
+
+namespace reven {
+namespace vmghost {
+
+class read_queue::backend {
+public:
+	virtual ~backend() = default;
+
+	virtual token submit(std::uint64_t physical_address, void* buffer, std::size_t size) = 0;
+	virtual bool is_done(token read) = 0;
+	virtual void wait(token read) = 0;
+	virtual void wait_all() = 0;
+	virtual std::size_t in_flight() const = 0;
+	virtual bool uses_io_uring() const = 0;
+};
+
+namespace {
+
+//! Largest thread pool used by default: beyond that, threads cost more than the latency they hide.
+constexpr std::size_t max_default_threads = 64;
+
+//!
+//! Runs every read as a @c read_buffer call on a pool of threads.
+//!
+class thread_pool_backend : public read_queue::backend {
+public:
+	thread_pool_backend(const physical_memory& memory, read_queue_options const& options)
+		: memory_(memory)
+		, depth_(std::max<std::size_t>(options.depth, 1))
+		, pool_(options.threads ? options.threads : std::min(depth_, max_default_threads))
+	{
+	}
+
+	~thread_pool_backend() override
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		done_.wait(lock, [this]() { return pending_.empty(); });
+	}
+
+	read_queue::token submit(std::uint64_t physical_address, void* buffer, std::size_t size) override
+	{
+		read_queue::token read;
+
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			done_.wait(lock, [this]() { return pending_.size() < depth_; });
+
+			read = next_token_++;
+			pending_.insert(read);
+		}
+
+		pool_.post([this, read, physical_address, buffer, size]() {
+			std::exception_ptr error;
+
+			try {
+				memory_.read_buffer(physical_address, buffer, size);
+			} catch (...) {
+				error = std::current_exception();
+			}
+
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				pending_.erase(read);
+
+				if (error) {
+					errors_[read] = error;
+				}
+			}
+			done_.notify_all();
+		});
+
+		return read;
+	}
+
+	bool is_done(read_queue::token read) override
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		return pending_.count(read) == 0;
+	}
+
+	void wait(read_queue::token read) override
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		done_.wait(lock, [this, read]() { return pending_.count(read) == 0; });
+
+		auto error = errors_.find(read);
+
+		if (error != errors_.end()) {
+			auto exception = error->second;
+			errors_.erase(error);
+			std::rethrow_exception(exception);
+		}
+	}
+
+	void wait_all() override
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		done_.wait(lock, [this]() { return pending_.empty(); });
+
+		if (not errors_.empty()) {
+			auto exception = errors_.begin()->second;
+			errors_.clear();
+			std::rethrow_exception(exception);
+		}
+	}
+
+	std::size_t in_flight() const override
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		return pending_.size();
+	}
+
+	bool uses_io_uring() const override { return false; }
+
+private:
+	const physical_memory& memory_;
+	const std::size_t depth_;
+
+	mutable std::mutex mutex_;
+	std::condition_variable done_;
+	read_queue::token next_token_{0};
+	std::set<read_queue::token> pending_;
+	std::unordered_map<read_queue::token, std::exception_ptr> errors_;
+
+	// Last member: its destruction joins the workers while the members above are still alive.
+	thread_pool pool_;
+};
+
+#ifdef RVNCOREVIRTUALBOX_HAVE_IO_URING
+
+//! Largest size of a single io_uring read request; bigger reads are resubmitted as short reads.
+constexpr std::size_t max_uring_read = 1u << 30;
+
+//! Largest submission ring we ask the kernel for.
+constexpr std::size_t max_uring_entries = 4096;
+
+//! Number of queued requests after which they are submitted to the kernel without waiting for a @c wait().
+constexpr unsigned uring_submit_batch = 32;
+
+//!
+//! Minimal io_uring ring, set up with raw system calls so that liburing is not required.
+//!
+class uring {
+public:
+	//! Returns false if the kernel does not support io_uring (or forbids it).
+	bool setup(unsigned entries)
+	{
+		io_uring_params params;
+		std::memset(&params, 0, sizeof(params));
+
+		fd_ = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+
+		if (fd_ < 0 or not supports_read()) {
+			return false;
+		}
+
+		sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(std::uint32_t);
+		cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+		if (params.features & IORING_FEAT_SINGLE_MMAP) {
+			sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+		}
+
+		sq_ring_ = ::mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_,
+		                  IORING_OFF_SQ_RING);
+
+		if (sq_ring_ == MAP_FAILED) {
+			sq_ring_ = nullptr;
+			return false;
+		}
+
+		if (params.features & IORING_FEAT_SINGLE_MMAP) {
+			cq_ring_ = sq_ring_;
+		} else {
+			cq_ring_ = ::mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_,
+			                  IORING_OFF_CQ_RING);
+
+			if (cq_ring_ == MAP_FAILED) {
+				cq_ring_ = nullptr;
+				return false;
+			}
+		}
+
+		sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+		void* sqes = ::mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_,
+		                    IORING_OFF_SQES);
+
+		if (sqes == MAP_FAILED) {
+			return false;
+		}
+
+		sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+		auto sq = static_cast<std::uint8_t*>(sq_ring_);
+		sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+		sq_mask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+		sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+
+		auto cq = static_cast<std::uint8_t*>(cq_ring_);
+		cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+		cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+		cq_mask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+		cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+		entries_ = params.sq_entries;
+
+		return true;
+	}
+
+	~uring()
+	{
+		if (sqes_) {
+			::munmap(sqes_, sqes_size_);
+		}
+
+		if (cq_ring_ and cq_ring_ != sq_ring_) {
+			::munmap(cq_ring_, cq_ring_size_);
+		}
+
+		if (sq_ring_) {
+			::munmap(sq_ring_, sq_ring_size_);
+		}
+
+		if (fd_ >= 0) {
+			::close(fd_);
+		}
+	}
+
+	unsigned entries() const { return entries_; }
+
+	//! Queues a read request. The caller guarantees that the submission ring is not full.
+	void push_read(int fd, std::uint64_t offset, void* buffer, std::uint32_t size, std::uint64_t user_data)
+	{
+		const unsigned tail = *sq_tail_;
+		const unsigned index = tail & sq_mask_;
+
+		io_uring_sqe& sqe = sqes_[index];
+		std::memset(&sqe, 0, sizeof(sqe));
+		sqe.opcode = IORING_OP_READ;
+		sqe.fd = fd;
+		sqe.off = offset;
+		sqe.addr = reinterpret_cast<std::uint64_t>(buffer);
+		sqe.len = size;
+		sqe.user_data = user_data;
+
+		sq_array_[index] = index;
+		__atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+
+		++unsubmitted_;
+	}
+
+	unsigned unsubmitted() const { return unsubmitted_; }
+
+	//! Submits the queued requests and, if @c wait is set, waits for at least one completion.
+	void enter(bool wait)
+	{
+		for (;;) {
+			long result = ::syscall(__NR_io_uring_enter, fd_, unsubmitted_, wait ? 1 : 0,
+			                        wait ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+
+			if (result < 0) {
+				if (errno == EINTR) {
+					continue;
+				}
+
+				throw std::runtime_error(std::string("io_uring_enter failed: ") + std::strerror(errno));
+			}
+
+			unsubmitted_ -= static_cast<unsigned>(result);
+			return;
+		}
+	}
+
+	//! Calls @c handler(user_data, result) for every available completion.
+	template <typename Handler> void reap(Handler&& handler)
+	{
+		unsigned head = *cq_head_;
+		const unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+
+		while (head != tail) {
+			const io_uring_cqe& cqe = cqes_[head & cq_mask_];
+			handler(cqe.user_data, cqe.res);
+			++head;
+		}
+
+		__atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+	}
+
+private:
+	//!
+	//! Whether the ring supports @c IORING_OP_READ. Kernels 5.1 to 5.5 set up rings but fail these reads with
+	//!   @c EINVAL; they also lack @c IORING_REGISTER_PROBE, which came with the opcode.
+	//!
+	bool supports_read() const
+	{
+		const unsigned ops = IORING_OP_READ + 1;
+		std::vector<std::uint8_t> buffer(sizeof(io_uring_probe) + ops * sizeof(io_uring_probe_op), 0);
+		auto probe = reinterpret_cast<io_uring_probe*>(buffer.data());
+
+		if (::syscall(__NR_io_uring_register, fd_, IORING_REGISTER_PROBE, probe, ops) < 0) {
+			return false;
+		}
+
+		return probe->last_op >= IORING_OP_READ and (probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED);
+	}
+
+	int fd_{-1};
+	unsigned entries_{0};
+	unsigned unsubmitted_{0};
+
+	void* sq_ring_{nullptr};
+	void* cq_ring_{nullptr};
+	std::size_t sq_ring_size_{0};
+	std::size_t cq_ring_size_{0};
+	io_uring_sqe* sqes_{nullptr};
+	std::size_t sqes_size_{0};
+
+	unsigned* sq_tail_{nullptr};
+	unsigned sq_mask_{0};
+	unsigned* sq_array_{nullptr};
+
+	unsigned* cq_head_{nullptr};
+	unsigned* cq_tail_{nullptr};
+	unsigned cq_mask_{0};
+	io_uring_cqe* cqes_{nullptr};
+};
+
+//!
+//! Turns reads of a @c MemoryVirtualBox into io_uring reads of its core files.
+//!
+class io_uring_backend : public read_queue::backend {
+public:
+	static std::unique_ptr<read_queue::backend> create(const MemoryVirtualBox& memory,
+	                                                   read_queue_options const& options)
+	{
+		bool file_backed = true;
+
+		memory.visit_chunks([&file_backed](const MemoryChunk& chunk) { file_backed &= bool(chunk.file()); });
+
+		if (not file_backed) {
+			return nullptr;
+		}
+
+		std::unique_ptr<io_uring_backend> backend(new io_uring_backend(memory));
+
+		unsigned entries = 1;
+		while (entries < std::min(std::max<std::size_t>(options.depth, 1), max_uring_entries)) {
+			entries <<= 1;
+		}
+
+		if (not backend->ring_.setup(entries)) {
+			return nullptr;
+		}
+
+		backend->slots_.resize(backend->ring_.entries());
+
+		for (std::size_t i = backend->slots_.size(); i > 0; --i) {
+			backend->free_slots_.push_back(i - 1);
+		}
+
+		return backend;
+	}
+
+	~io_uring_backend() override
+	{
+		try {
+			std::lock_guard<std::mutex> lock(mutex_);
+			complete_all();
+		} catch (...) {
+			// Nothing sensible to do: the reads are abandoned.
+		}
+	}
+
+	read_queue::token submit(std::uint64_t physical_address, void* buffer, std::size_t size) override
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+
+		const read_queue::token read = next_token_++;
+
+		// Same semantics as MemoryVirtualBox::do_read_buffer, see MemoryChunk::read.
+		if (size == 0) {
+			return read;
+		}
+
+		const MemoryChunk* chunk = memory_.chunk_at(physical_address);
+
+		if (chunk == nullptr or not chunk->contains(physical_address + size - 1)) {
+			std::memset(buffer, 0, size);
+			return read;
+		}
+
+		const std::uint64_t offset_in_chunk = physical_address - chunk->physical_address();
+
+		if (offset_in_chunk >= chunk->size_in_file()) {
+			return read;
+		}
+
+		while (free_slots_.empty()) {
+			ring_.enter(true);
+			reap();
+		}
+
+		const std::size_t index = free_slots_.back();
+		free_slots_.pop_back();
+
+		slot& request = slots_[index];
+		request.read = read;
+		request.fd = chunk->file()->fd();
+		request.offset = chunk->offset_in_file() + offset_in_chunk;
+		request.buffer = static_cast<std::uint8_t*>(buffer);
+		request.remaining = std::min<std::uint64_t>(size, chunk->size_in_file() - offset_in_chunk);
+
+		push(index);
+		pending_.insert(read);
+
+		if (ring_.unsubmitted() >= uring_submit_batch) {
+			ring_.enter(false);
+		}
+
+		return read;
+	}
+
+	bool is_done(read_queue::token read) override
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+
+		if (ring_.unsubmitted() > 0) {
+			ring_.enter(false);
+		}
+
+		reap();
+
+		return pending_.count(read) == 0;
+	}
+
+	void wait(read_queue::token read) override
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+
+		if (ring_.unsubmitted() > 0) {
+			ring_.enter(false);
+		}
+
+		reap();
+
+		while (pending_.count(read)) {
+			ring_.enter(true);
+			reap();
+		}
+
+		auto error = errors_.find(read);
+
+		if (error != errors_.end()) {
+			auto exception = error->second;
+			errors_.erase(error);
+			std::rethrow_exception(exception);
+		}
+	}
+
+	void wait_all() override
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+
+		complete_all();
+
+		if (not errors_.empty()) {
+			auto exception = errors_.begin()->second;
+			errors_.clear();
+			std::rethrow_exception(exception);
+		}
+	}
+
+	std::size_t in_flight() const override
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		return pending_.size();
+	}
+
+	bool uses_io_uring() const override { return true; }
+
+private:
+	struct slot {
+		read_queue::token read;
+		int fd;
+		std::uint64_t offset;
+		std::uint8_t* buffer;
+		std::uint64_t remaining;
+		std::uint32_t submitted;
+	};
+
+	explicit io_uring_backend(const MemoryVirtualBox& memory) : memory_(memory) {}
+
+	void push(std::size_t index)
+	{
+		slot& request = slots_[index];
+		request.submitted = static_cast<std::uint32_t>(std::min<std::uint64_t>(request.remaining, max_uring_read));
+		ring_.push_read(request.fd, request.offset, request.buffer, request.submitted, index);
+	}
+
+	void complete_all()
+	{
+		while (not pending_.empty()) {
+			ring_.enter(true);
+			reap();
+		}
+	}
+
+	void reap()
+	{
+		ring_.reap([this](std::uint64_t index, std::int32_t result) {
+			slot& request = slots_[index];
+
+			if (result > 0 and static_cast<std::uint32_t>(result) < request.remaining) {
+				// Short read: queue the rest of the request.
+				request.offset += result;
+				request.buffer += result;
+				request.remaining -= result;
+				push(index);
+				return;
+			}
+
+			if (result < 0) {
+				errors_[request.read] = std::make_exception_ptr(
+					std::runtime_error(std::string("Can't read the core file: ") + std::strerror(-result)));
+			} else if (result == 0) {
+				errors_[request.read] = std::make_exception_ptr(std::runtime_error("Unexpected end of core file."));
+			}
+
+			pending_.erase(request.read);
+			free_slots_.push_back(index);
+		});
+	}
+
+	const MemoryVirtualBox& memory_;
+	uring ring_;
+
+	mutable std::mutex mutex_;
+	read_queue::token next_token_{0};
+	std::vector<slot> slots_;
+	std::vector<std::size_t> free_slots_;
+	std::set<read_queue::token> pending_;
+	std::unordered_map<read_queue::token, std::exception_ptr> errors_;
+};
+
+#endif // RVNCOREVIRTUALBOX_HAVE_IO_URING
+
+} // anonymous namespace
+
+read_queue::read_queue(const physical_memory& memory, read_queue_options options)
+{
+#ifdef RVNCOREVIRTUALBOX_HAVE_IO_URING
+	auto memory_virtualbox = dynamic_cast<const MemoryVirtualBox*>(&memory);
+
+	if (options.use_io_uring and memory_virtualbox) {
+		backend_ = io_uring_backend::create(*memory_virtualbox, options);
+	}
+#endif
+
+	if (not backend_) {
+		backend_.reset(new thread_pool_backend(memory, options));
+	}
+}
+
+read_queue::~read_queue() = default;
+
+read_queue::token read_queue::submit(std::uint64_t physical_address, void* buffer, std::size_t size)
+{
+	return backend_->submit(physical_address, buffer, size);
+}
+
+bool read_queue::is_done(token read)
+{
+	return backend_->is_done(read);
+}
+
+void read_queue::wait(token read)
+{
+	backend_->wait(read);
+}
+
+void read_queue::wait_all()
+{
+	backend_->wait_all();
+}
+
+std::size_t read_queue::in_flight() const
+{
+	return backend_->in_flight();
+}
+
+bool read_queue::uses_io_uring() const
+{
+	return backend_->uses_io_uring();
+}
+}
+} // namespace reven::vmghost
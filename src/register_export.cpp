@@ -0,0 +1,111 @@
+#include <register_export.h>
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <iterator>
+#include <mutex>
+#include <thread>
+
+namespace reven {
+namespace vmghost {
+
+namespace {
+
+//! Fills the rows [first_row, first_row + cpu count) of @c columns with the registers of @c core.
+void export_core(const core_virtualbox& core, std::size_t first_row, register_columns& columns)
+{
+	const std::size_t rows = columns.rows();
+	const std::size_t column_count = columns.registers.size();
+	std::vector<std::uint64_t> row(column_count);
+
+	std::size_t index = first_row;
+
+	for (auto cpu = core.cpu_begin(); cpu != core.cpu_end(); ++cpu, ++index) {
+		cpu->get_many(columns.registers.data(), column_count, row.data());
+
+		for (std::size_t column = 0; column < column_count; ++column) {
+			columns.values[column * rows + index] = row[column];
+		}
+	}
+}
+
+register_columns make_columns(const std::vector<const core_virtualbox*>& cores, std::vector<register_id> registers)
+{
+	register_columns columns;
+	columns.registers = std::move(registers);
+	columns.core_rows.reserve(cores.size() + 1);
+
+	std::size_t rows = 0;
+
+	for (const auto* core : cores) {
+		columns.core_rows.push_back(rows);
+		rows += static_cast<std::size_t>(std::distance(core->cpu_begin(), core->cpu_end()));
+	}
+
+	columns.core_rows.push_back(rows);
+	columns.values.resize(rows * columns.registers.size());
+
+	return columns;
+}
+
+} // anonymous namespace
+
+register_columns export_registers(const core_virtualbox& core, std::vector<register_id> registers)
+{
+	auto columns = make_columns({ &core }, std::move(registers));
+	export_core(core, 0, columns);
+	return columns;
+}
+
+register_columns export_registers(const std::vector<const core_virtualbox*>& cores,
+                                  std::vector<register_id> registers, std::size_t threads)
+{
+	auto columns = make_columns(cores, std::move(registers));
+
+	if (threads == 0) {
+		threads = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	threads = std::max<std::size_t>(1, std::min(threads, cores.size()));
+
+	// Cores have different CPU counts: threads take the next core until there is none left. Each core writes its
+	// own rows, so no synchronization is needed on the values.
+	std::atomic<std::size_t> next_core{0};
+	std::exception_ptr error;
+	std::mutex error_mutex;
+
+	auto work = [&]() {
+		try {
+			for (std::size_t i = next_core++; i < cores.size(); i = next_core++) {
+				export_core(*cores[i], columns.core_rows[i], columns);
+			}
+		} catch (...) {
+			std::lock_guard<std::mutex> lock(error_mutex);
+
+			if (not error) {
+				error = std::current_exception();
+			}
+		}
+	};
+
+	std::vector<std::thread> workers;
+
+	for (std::size_t i = 1; i < threads; ++i) {
+		workers.emplace_back(work);
+	}
+
+	work();
+
+	for (auto& worker : workers) {
+		worker.join();
+	}
+
+	if (error) {
+		std::rethrow_exception(error);
+	}
+
+	return columns;
+}
+}
+} // namespace reven::vmghost
@@ -0,0 +1,67 @@
+#include <register_id.h>
+
+#include <cstring>
+#include <stdexcept>
+
+namespace reven {
+namespace vmghost {
+
+namespace {
+
+const std::uint8_t* register_bytes(const cpu_virtualbox& cpu, const register_info& info)
+{
+	if (cpu.version() < info.since_version) {
+		throw std::runtime_error(std::string("Attempt to access ") + info.name + " from an old version");
+	}
+
+	if (info.location == register_location::hot_state) {
+		return reinterpret_cast<const std::uint8_t*>(&cpu.hot_state()) + info.offset;
+	}
+
+	return reinterpret_cast<const std::uint8_t*>(&cpu.extended_state()) + info.offset;
+}
+
+std::uint64_t register_value(const cpu_virtualbox& cpu, const register_info& info)
+{
+	if (info.size > sizeof(std::uint64_t)) {
+		throw std::runtime_error(std::string("Register ") + info.name + " is wider than 64 bits");
+	}
+
+	std::uint64_t value = 0;
+	std::memcpy(&value, register_bytes(cpu, info), info.size);
+	return value;
+}
+
+} // anonymous namespace
+
+bool find_register(std::string const& name, register_id& id)
+{
+	for (const auto& info : register_table) {
+		if (name == info.name) {
+			id = info.id;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+std::uint64_t cpu_virtualbox::get(register_id id) const
+{
+	return register_value(*this, get_register_info(id));
+}
+
+void cpu_virtualbox::get_many(const register_id* ids, std::size_t count, std::uint64_t* out) const
+{
+	for (std::size_t i = 0; i < count; ++i) {
+		out[i] = register_value(*this, get_register_info(ids[i]));
+	}
+}
+
+void cpu_virtualbox::get_raw(register_id id, void* buffer) const
+{
+	const auto& info = get_register_info(id);
+	std::memcpy(buffer, register_bytes(*this, info), info.size);
+}
+}
+} // namespace reven::vmghost
@@ -0,0 +1,293 @@
+#include <streaming_reader.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+namespace reven {
+namespace vmghost {
+
+namespace {
+
+constexpr std::size_t page_size = 0x1000;
+
+//! Alignment required by O_DIRECT on buffers, offsets and sizes. A page is enough for every common block device.
+constexpr std::size_t direct_alignment = 0x1000;
+
+std::uint64_t align_down(std::uint64_t value, std::uint64_t alignment)
+{
+	return value & ~(alignment - 1);
+}
+
+std::uint64_t align_up(std::uint64_t value, std::uint64_t alignment)
+{
+	return align_down(value + alignment - 1, alignment);
+}
+
+struct free_deleter {
+	void operator()(std::uint8_t* pointer) const { ::free(pointer); }
+};
+
+typedef std::unique_ptr<std::uint8_t, free_deleter> aligned_buffer;
+
+aligned_buffer allocate_aligned(std::size_t size)
+{
+	void* pointer = nullptr;
+
+	if (::posix_memalign(&pointer, direct_alignment, size) != 0) {
+		throw std::bad_alloc();
+	}
+
+	return aligned_buffer(static_cast<std::uint8_t*>(pointer));
+}
+
+//!
+//! A descriptor on a core file dedicated to streaming, with @c O_DIRECT when the file system supports it.
+//!
+class stream_fd {
+public:
+	stream_fd(std::string const& path, bool direct)
+	{
+		if (direct) {
+			fd_ = ::open(path.c_str(), O_RDONLY | O_CLOEXEC | O_DIRECT);
+			direct_ = fd_ >= 0;
+		}
+
+		if (fd_ < 0) {
+			fd_ = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		}
+
+		if (fd_ < 0) {
+			throw std::runtime_error("Can't open the core file.");
+		}
+
+		if (not direct_) {
+			::posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+		}
+	}
+
+	stream_fd(stream_fd const&) = delete;
+	stream_fd& operator=(stream_fd const&) = delete;
+
+	~stream_fd() { ::close(fd_); }
+
+	//! Reads @c size bytes at @c offset into @c buffer and returns where they start in it. @c buffer must be aligned
+	//!   on @c direct_alignment and hold at least <tt>size + 2 * direct_alignment</tt> bytes.
+	const std::uint8_t* read(std::uint64_t offset, std::size_t size, std::uint8_t* buffer)
+	{
+		const std::uint64_t aligned_offset = align_down(offset, direct_alignment);
+		const std::uint64_t head = offset - aligned_offset;
+		const std::uint64_t wanted = head + size;
+		const std::uint64_t aligned_size = align_up(wanted, direct_alignment);
+
+		std::uint64_t done = 0;
+
+		while (done < wanted) {
+			ssize_t result = ::pread(fd_, buffer + done, aligned_size - done, aligned_offset + done);
+
+			if (result < 0) {
+				if (errno == EINTR) {
+					continue;
+				}
+
+				if (errno == EINVAL and direct_) {
+					// Some file systems accept O_DIRECT at open time but not the alignment we use.
+					disable_direct();
+					continue;
+				}
+
+				throw std::runtime_error(std::string("Can't read the core file: ") + std::strerror(errno));
+			}
+
+			if (result == 0) {
+				throw std::runtime_error("Unexpected end of core file.");
+			}
+
+			done += result;
+		}
+
+		return buffer + head;
+	}
+
+	//! Drops a delivered range from the page cache, when it went through it.
+	void release(std::uint64_t offset, std::size_t size)
+	{
+		if (not direct_) {
+			::posix_fadvise(fd_, offset, size, POSIX_FADV_DONTNEED);
+		}
+	}
+
+private:
+	void disable_direct()
+	{
+		int flags = ::fcntl(fd_, F_GETFL);
+
+		if (flags < 0 or ::fcntl(fd_, F_SETFL, flags & ~O_DIRECT) < 0) {
+			throw std::runtime_error(std::string("Can't disable O_DIRECT: ") + std::strerror(errno));
+		}
+
+		direct_ = false;
+	}
+
+	int fd_{-1};
+	std::atomic<bool> direct_{false};
+};
+
+} // anonymous namespace
+
+streaming_reader::streaming_reader(const MemoryVirtualBox& memory, streaming_options options)
+	: options_(options)
+{
+	options_.batch_size = std::max<std::size_t>(align_up(options_.batch_size, page_size), page_size);
+
+	memory.visit_chunks([this](const MemoryChunk& chunk) {
+		if (not chunk.file()) {
+			throw std::runtime_error("Can't stream a chunk that is not backed by a core file.");
+		}
+
+		chunks_.push_back(chunk);
+	});
+
+	std::sort(chunks_.begin(), chunks_.end(), [](const MemoryChunk& lhs, const MemoryChunk& rhs) {
+		return lhs.physical_address() < rhs.physical_address();
+	});
+
+	for (const auto& chunk : chunks_) {
+		const std::uint64_t backed_size = std::min(chunk.size_in_file(), chunk.size_in_memory());
+
+		for (std::uint64_t offset = 0; offset < backed_size; offset += options_.batch_size) {
+			batches_.push_back(batch{ chunk.file().get(),
+			                          chunk.offset_in_file() + offset,
+			                          chunk.physical_address() + offset,
+			                          static_cast<std::size_t>(std::min<std::uint64_t>(backed_size - offset,
+			                                                                           options_.batch_size)) });
+		}
+	}
+}
+
+std::uint64_t streaming_reader::size() const
+{
+	std::uint64_t total = 0;
+
+	for (const auto& batch : batches_) {
+		total += batch.size;
+	}
+
+	return total;
+}
+
+void streaming_reader::run(batch_visitor visitor) const
+{
+	if (batches_.empty()) {
+		return;
+	}
+
+	std::map<const core_file*, std::unique_ptr<stream_fd>> descriptors;
+
+	for (const auto& batch : batches_) {
+		auto& descriptor = descriptors[batch.file];
+
+		if (not descriptor) {
+			descriptor.reset(new stream_fd(batch.file->path(), options_.direct_io));
+		}
+	}
+
+	// Both threads look the descriptors up: only through const accesses, which don't race.
+	const auto& streams = descriptors;
+
+	const std::size_t buffer_size = options_.batch_size + 2 * direct_alignment;
+	aligned_buffer buffers[2] = { allocate_aligned(buffer_size), allocate_aligned(buffer_size) };
+
+	// Two slots: the producer thread fills slot (i % 2) while the caller consumes the other one.
+	const std::uint8_t* slot_data[2] = { nullptr, nullptr };
+	bool slot_ready[2] = { false, false };
+	bool stop = false;
+	std::exception_ptr producer_error;
+
+	std::mutex mutex;
+	std::condition_variable changed;
+
+	std::thread producer([&]() {
+		try {
+			for (std::size_t i = 0; i < batches_.size(); ++i) {
+				const std::size_t slot = i % 2;
+
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+					changed.wait(lock, [&]() { return stop or not slot_ready[slot]; });
+
+					if (stop) {
+						return;
+					}
+				}
+
+				const auto& batch = batches_[i];
+				const std::uint8_t* data = streams.at(batch.file)->read(batch.offset_in_file, batch.size,
+				                                                       buffers[slot].get());
+
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					slot_data[slot] = data;
+					slot_ready[slot] = true;
+				}
+				changed.notify_all();
+			}
+		} catch (...) {
+			std::lock_guard<std::mutex> lock(mutex);
+			producer_error = std::current_exception();
+			changed.notify_all();
+		}
+	});
+
+	auto finish = [&]() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stop = true;
+		}
+		changed.notify_all();
+		producer.join();
+	};
+
+	try {
+		for (std::size_t i = 0; i < batches_.size(); ++i) {
+			const std::size_t slot = i % 2;
+
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				changed.wait(lock, [&]() { return producer_error or slot_ready[slot]; });
+
+				if (not slot_ready[slot]) {
+					std::rethrow_exception(producer_error);
+				}
+			}
+
+			const auto& batch = batches_[i];
+			visitor(batch.physical_address, slot_data[slot], batch.size);
+			streams.at(batch.file)->release(batch.offset_in_file, batch.size);
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				slot_ready[slot] = false;
+			}
+			changed.notify_all();
+		}
+	} catch (...) {
+		finish();
+		throw;
+	}
+
+	finish();
+}
+}
+} // namespace reven::vmghost
@@ -0,0 +1,310 @@
+#include <synthetic_core.h>
+
+#include <core_writer.h>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace reven {
+namespace vmghost {
+
+namespace {
+
+constexpr std::uint64_t entries_per_table = 512;
+
+//! Present and writable.
+constexpr std::uint64_t table_entry_flags = 0x3;
+
+//! Number of pages shared by the duplicate pages.
+constexpr std::uint64_t shared_page_count = 16;
+
+std::uint64_t pages_of(std::uint64_t size)
+{
+	return (size + synthetic_memory::page_size - 1) / synthetic_memory::page_size;
+}
+
+std::uint64_t ceil_div(std::uint64_t value, std::uint64_t divisor)
+{
+	return (value + divisor - 1) / divisor;
+}
+
+std::uint64_t splitmix(std::uint64_t& state)
+{
+	std::uint64_t value = (state += 0x9e3779b97f4a7c15ULL);
+	value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+	return value ^ (value >> 31);
+}
+
+void fill_random(std::uint8_t* data, std::uint64_t state)
+{
+	for (std::size_t offset = 0; offset < synthetic_memory::page_size; offset += sizeof(std::uint64_t)) {
+		const std::uint64_t value = splitmix(state);
+		std::memcpy(data + offset, &value, sizeof(value));
+	}
+}
+
+} // anonymous namespace
+
+constexpr std::size_t synthetic_memory::page_size;
+
+synthetic_memory::synthetic_memory(synthetic_core_options const& options) : options_(options)
+{
+	if (options.version != vbox::DBGFCORE_FMT_VERSION_COMPAT and options.version != vbox::DBGFCORE_FMT_VERSIONv5 and
+	    options.version != vbox::DBGFCORE_FMT_VERSIONv6) {
+		throw std::invalid_argument("Unsupported core version.");
+	}
+
+	if (options.segment_count == 0 or options.cpu_count == 0 or options.mapped_size == 0) {
+		throw std::invalid_argument("A core needs segments, CPUs and mapped memory.");
+	}
+
+	if (options.zero_page_ratio < 0 or options.duplicate_page_ratio < 0 or
+	    options.zero_page_ratio + options.duplicate_page_ratio > 1) {
+		throw std::invalid_argument("Invalid page ratios.");
+	}
+
+	const std::uint64_t virtual_base = options.virtual_base;
+
+	if (virtual_base % (entries_per_table * entries_per_table * entries_per_table * page_size) != 0 or
+	    (virtual_base >> 47 != 0 and virtual_base >> 47 != 0x1ffff)) {
+		throw std::invalid_argument("The virtual base must be canonical and aligned on 512 GiB.");
+	}
+
+	mapped_pages_ = pages_of(options.mapped_size);
+	pt_count_ = ceil_div(mapped_pages_, entries_per_table);
+	pd_count_ = ceil_div(pt_count_, entries_per_table);
+	pdpt_count_ = ceil_div(pd_count_, entries_per_table);
+
+	if (((virtual_base >> 39) & 0x1ff) + pdpt_count_ > entries_per_table) {
+		throw std::invalid_argument("The mapped range doesn't fit in the address space.");
+	}
+
+	tables_end_page_ = table_first_page_ + 1 + pdpt_count_ + pd_count_ + pt_count_;
+
+	const std::uint64_t pages = pages_of(options.memory_size);
+
+	if (pages < options.segment_count or pages <= tables_end_page_) {
+		throw std::invalid_argument("The memory is too small for the segments and page tables.");
+	}
+
+	const std::uint64_t gap = pages_of(options.gap_size) * page_size;
+	std::uint64_t address = 0;
+
+	for (std::size_t i = 0; i < options.segment_count; ++i) {
+		const std::uint64_t first = pages * i / options.segment_count;
+		const std::uint64_t last = pages * (i + 1) / options.segment_count;
+
+		segments_.push_back(memory_range{ address, address + (last - first) * page_size });
+		first_page_.push_back(first);
+
+		address = segments_.back().end + gap;
+	}
+
+	first_page_.push_back(pages);
+}
+
+std::uint64_t synthetic_memory::backed_page_address(std::uint64_t page) const
+{
+	// The last segment starting at or before the page.
+	const auto next = std::upper_bound(first_page_.begin(), first_page_.end() - 1, page);
+	const std::size_t segment = static_cast<std::size_t>(next - first_page_.begin()) - 1;
+
+	return segments_[segment].begin + (page - first_page_[segment]) * page_size;
+}
+
+std::uint64_t synthetic_memory::translate(std::uint64_t virtual_address) const
+{
+	const std::uint64_t page = (virtual_address - options_.virtual_base) / page_size;
+
+	// Data pages are page 0, then the pages after the tables.
+	const std::uint64_t data_pages = first_page_.back() - (tables_end_page_ - table_first_page_);
+	const std::uint64_t data_page = page % data_pages;
+	const std::uint64_t backed_page = data_page == 0 ? 0 : tables_end_page_ + data_page - 1;
+
+	return backed_page_address(backed_page) + virtual_address % page_size;
+}
+
+void synthetic_memory::fill_page(std::uint64_t page, std::uint8_t* data) const
+{
+	if (page >= table_first_page_ and page < tables_end_page_) {
+		std::uint64_t entries[entries_per_table] = {};
+
+		// Index of the table among the PDPTs, PDs or PTs, and the number of tables of that level.
+		std::uint64_t table = page - table_first_page_;
+
+		if (table == 0) {
+			const std::uint64_t first = (options_.virtual_base >> 39) & 0x1ff;
+
+			for (std::uint64_t i = 0; i < pdpt_count_; ++i) {
+				entries[first + i] = backed_page_address(table_first_page_ + 1 + i) | table_entry_flags;
+			}
+		} else {
+			const std::uint64_t counts[3] = { pdpt_count_, pd_count_, pt_count_ };
+			std::uint64_t level = 0;
+			std::uint64_t level_first_page = table_first_page_ + 1;
+
+			for (table -= 1; table >= counts[level]; ++level) {
+				table -= counts[level];
+				level_first_page += counts[level];
+			}
+
+			for (std::uint64_t i = 0; i < entries_per_table; ++i) {
+				const std::uint64_t child = table * entries_per_table + i;
+
+				if (level < 2) {
+					if (child < counts[level + 1]) {
+						entries[i] = backed_page_address(level_first_page + counts[level] + child) | table_entry_flags;
+					}
+				} else if (child < mapped_pages_) {
+					entries[i] = translate(options_.virtual_base + child * page_size) | table_entry_flags;
+				}
+			}
+		}
+
+		std::memcpy(data, entries, page_size);
+		return;
+	}
+
+	std::uint64_t state = options_.seed ^ (page * 0xd6e8feb86659fd93ULL);
+	const double draw = static_cast<double>(splitmix(state) >> 11) / static_cast<double>(1ULL << 53);
+
+	if (draw < options_.zero_page_ratio) {
+		std::memset(data, 0, page_size);
+	} else if (draw < options_.zero_page_ratio + options_.duplicate_page_ratio) {
+		fill_random(data, ~options_.seed + splitmix(state) % shared_page_count);
+	} else {
+		fill_random(data, state);
+	}
+}
+
+read_result synthetic_memory::do_try_read_buffer(std::uint64_t physical_address, void* buffer,
+                                                 std::size_t size) const noexcept
+{
+	auto output = static_cast<std::uint8_t*>(buffer);
+	std::uint8_t page[page_size];
+	std::size_t bytes_read = 0;
+
+	// The first segment ending after the address.
+	auto segment = std::upper_bound(segments_.begin(), segments_.end(), physical_address,
+	                                 [](std::uint64_t address, memory_range const& range) { return address < range.end; });
+
+	for (std::size_t done = 0; done < size;) {
+		const std::uint64_t address = physical_address + done;
+		std::size_t length = size - done;
+
+		if (segment == segments_.end() or address < segment->begin) {
+			if (segment != segments_.end()) {
+				length = static_cast<std::size_t>(std::min<std::uint64_t>(length, segment->begin - address));
+			}
+
+			std::memset(output + done, 0, length);
+		} else {
+			const std::uint64_t offset = address % page_size;
+			length = static_cast<std::size_t>(std::min<std::uint64_t>(length, page_size - offset));
+
+			const std::uint64_t backed_page =
+			    first_page_[segment - segments_.begin()] + (address - segment->begin) / page_size;
+
+			if (length == page_size) {
+				fill_page(backed_page, output + done);
+			} else {
+				fill_page(backed_page, page);
+				std::memcpy(output + done, page + offset, length);
+			}
+
+			bytes_read += length;
+
+			if (address + length == segment->end) {
+				++segment;
+			}
+		}
+
+		done += length;
+	}
+
+	return read_result{ make_read_status(size, bytes_read, 0), bytes_read };
+}
+
+bool synthetic_memory::do_read(std::uint64_t physical_address, std::uint8_t& data) const
+{
+	return do_try_read_buffer(physical_address, &data, 1).status == read_status::backed;
+}
+
+void synthetic_memory::do_read_buffer(std::uint64_t physical_address, void* buffer, std::size_t size) const
+{
+	do_try_read_buffer(physical_address, buffer, size);
+}
+
+cpu_virtualbox synthetic_cpu(synthetic_memory const& memory, std::size_t index)
+{
+	auto const& options = memory.options();
+
+	vbox::DBGFCORECPU context;
+	std::memset(&context, 0, sizeof(context));
+
+	auto& base = context.base;
+
+	base.rax = index;
+	base.rbx = 0xbbbb0000 + index;
+	base.rcx = 0xcccc0000 + index;
+	base.rdx = 0xdddd0000 + index;
+	base.rip = options.virtual_base + (index * synthetic_memory::page_size) % options.mapped_size;
+	base.rsp = options.virtual_base + options.mapped_size - index * synthetic_memory::page_size % options.mapped_size - 8;
+	base.rflags = 0x202;
+
+	// Flat 64-bit kernel segments.
+	base.cs.uSel = 0x10;
+	base.cs.uAttr = 0xa09b;
+	base.ss.uSel = base.ds.uSel = base.es.uSel = 0x18;
+	base.ss.uAttr = base.ds.uAttr = base.es.uAttr = 0xc093;
+	base.fs.uAttr = base.gs.uAttr = 0x1c000;
+	base.ss.uLimit = base.ds.uLimit = base.es.uLimit = 0xffffffff;
+	base.tr.uSel = 0x40;
+	base.tr.uAttr = 0x8b;
+	base.tr.uLimit = 0x67;
+
+	// Paging, PAE and SSE enabled, in long mode.
+	base.cr0 = 0x80050033;
+	base.cr3 = memory.page_table_root();
+	base.cr4 = 0x6a0;
+	base.msrEFER = 0xd01;
+	base.msrPAT = 0x0007040600070406;
+	base.msrApicBase = index == 0 ? 0xfee00900 : 0xfee00800;
+
+	vbox::X86XSAVEAREA* ext = &context.v5.ext;
+
+	if (options.version == vbox::DBGFCORE_FMT_VERSIONv6) {
+		context.v6.msrTscAux = index;
+		ext = &context.v6.ext;
+	}
+
+	ext->x87.FCW = 0x37f;
+	ext->x87.MXCSR = 0x1f80;
+	ext->x87.MXCSR_MASK = 0xffff;
+
+	return cpu_virtualbox(options.version, context);
+}
+
+void write_synthetic_core(std::string const& path, synthetic_core_options const& options)
+{
+	const synthetic_memory memory(options);
+
+	core_writer writer(path);
+	writer.set_descriptor(vbox::DBGFCOREDESCRIPTOR{ vbox::DBGFCORE_MAGIC, options.version,
+	                                                sizeof(vbox::DBGFCOREDESCRIPTOR), 0, 0,
+	                                                static_cast<std::uint32_t>(options.cpu_count) });
+
+	for (std::size_t i = 0; i < options.cpu_count; ++i) {
+		writer.add_cpu(synthetic_cpu(memory, i));
+	}
+
+	for (auto const& segment : memory.segments()) {
+		writer.add_memory(memory, segment);
+	}
+
+	writer.finish();
+}
+}
+} // namespace reven::vmghost
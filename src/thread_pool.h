@@ -0,0 +1,88 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace reven {
+namespace vmghost {
+
+//!
+//! Fixed-size pool of worker threads executing posted tasks in FIFO order.
+//!
+//! The destructor runs the tasks still queued, then joins the workers.
+//!
+class thread_pool {
+public:
+	explicit thread_pool(std::size_t threads)
+	{
+		if (threads == 0) {
+			threads = 1;
+		}
+
+		for (std::size_t i = 0; i < threads; ++i) {
+			workers_.emplace_back([this]() { work(); });
+		}
+	}
+
+	thread_pool(thread_pool const&) = delete;
+	thread_pool& operator=(thread_pool const&) = delete;
+
+	~thread_pool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			stop_ = true;
+		}
+		changed_.notify_all();
+
+		for (auto& worker : workers_) {
+			worker.join();
+		}
+	}
+
+	std::size_t size() const { return workers_.size(); }
+
+	void post(std::function<void()> task)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			tasks_.push_back(std::move(task));
+		}
+		changed_.notify_one();
+	}
+
+private:
+	void work()
+	{
+		for (;;) {
+			std::function<void()> task;
+
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+				changed_.wait(lock, [this]() { return stop_ or not tasks_.empty(); });
+
+				if (tasks_.empty()) {
+					return;
+				}
+
+				task = std::move(tasks_.front());
+				tasks_.pop_front();
+			}
+
+			task();
+		}
+	}
+
+	std::vector<std::thread> workers_;
+	std::deque<std::function<void()>> tasks_;
+	std::mutex mutex_;
+	std::condition_variable changed_;
+	bool stop_{false};
+
+}; // class thread_pool
+}
+} // namespace reven::vmghost
@@ -0,0 +1,224 @@
+#include <virtual_memory.h>
+
+#include <cstring>
+#include <stdexcept>
+
+namespace reven {
+namespace vmghost {
+
+namespace {
+
+constexpr std::uint64_t entry_present = 1ull << 0;
+constexpr std::uint64_t entry_large_page = 1ull << 7;
+
+//! Physical address bits of a page table entry (MAXPHYADDR is at most 52).
+constexpr std::uint64_t entry_address_mask = 0x000ffffffffff000ull;
+
+bool is_canonical(std::uint64_t virtual_address, unsigned bits)
+{
+	const auto high = static_cast<std::int64_t>(virtual_address) >> (bits - 1);
+	return high == 0 or high == -1;
+}
+
+} // anonymous namespace
+
+paging_mode get_paging_mode(const cpu_virtualbox& cpu)
+{
+	if (not cpu.is_paging_enabled()) {
+		return paging_mode::none;
+	}
+
+	if (cpu.is_long_mode_enabled()) {
+		return cpu.is_la57_enabled() ? paging_mode::ia32e_la57 : paging_mode::ia32e;
+	}
+
+	return cpu.is_pae_enabled() ? paging_mode::pae : paging_mode::legacy;
+}
+
+virtual_memory::virtual_memory(const physical_memory& memory, const cpu_virtualbox& cpu)
+  : virtual_memory(memory, cpu.cr3(), get_paging_mode(cpu), cpu.is_pse_enabled())
+{
+}
+
+virtual_memory::virtual_memory(const physical_memory& memory, std::uint64_t cr3, paging_mode mode, bool pse)
+  : memory_(memory), cr3_(cr3), mode_(mode), pse_(pse)
+{
+}
+
+std::uint64_t virtual_memory::read_entry(std::uint64_t physical_address) const
+{
+	std::uint64_t entry = 0;
+	memory_.read_buffer(physical_address, &entry, mode_ == paging_mode::legacy ? 4 : 8);
+	return entry;
+}
+
+bool virtual_memory::translate(std::uint64_t virtual_address, std::uint64_t& physical_address,
+                               std::uint64_t& page_size) const
+{
+	switch (mode_) {
+		case paging_mode::none:
+			physical_address = virtual_address;
+			page_size = 0x1000;
+			return true;
+
+		case paging_mode::legacy: {
+			virtual_address &= 0xffffffffull;
+
+			const auto pde = read_entry((cr3_ & 0xfffff000ull) + ((virtual_address >> 22) << 2));
+
+			if (not(pde & entry_present)) {
+				return false;
+			}
+
+			if (pse_ and (pde & entry_large_page)) {
+				// PSE-36: bits 13-20 of the entry are bits 32-39 of the page address.
+				const std::uint64_t page = (pde & 0xffc00000ull) | ((pde & 0x1fe000ull) << 19);
+				physical_address = page | (virtual_address & 0x3fffff);
+				page_size = 0x400000;
+				return true;
+			}
+
+			const auto pte = read_entry((pde & 0xfffff000ull) + (((virtual_address >> 12) & 0x3ff) << 2));
+
+			if (not(pte & entry_present)) {
+				return false;
+			}
+
+			physical_address = (pte & 0xfffff000ull) | (virtual_address & 0xfff);
+			page_size = 0x1000;
+			return true;
+		}
+
+		case paging_mode::pae:
+		case paging_mode::ia32e:
+		case paging_mode::ia32e_la57:
+			break;
+	}
+
+	unsigned levels;
+	std::uint64_t table;
+
+	if (mode_ == paging_mode::pae) {
+		virtual_address &= 0xffffffffull;
+
+		const auto pdpte = read_entry((cr3_ & 0xffffffe0ull) + ((virtual_address >> 30) << 3));
+
+		if (not(pdpte & entry_present)) {
+			return false;
+		}
+
+		levels = 2;
+		table = pdpte & entry_address_mask;
+	} else {
+		levels = mode_ == paging_mode::ia32e_la57 ? 5 : 4;
+
+		if (not is_canonical(virtual_address, 12 + 9 * levels)) {
+			return false;
+		}
+
+		table = cr3_ & entry_address_mask;
+	}
+
+	for (unsigned level = levels; level > 0; --level) {
+		const unsigned shift = 12 + 9 * (level - 1);
+		const auto entry = read_entry(table + (((virtual_address >> shift) & 0x1ff) << 3));
+
+		if (not(entry & entry_present)) {
+			return false;
+		}
+
+		// 1 GiB and 2 MiB pages
+		if (level == 1 or (level <= 3 and (entry & entry_large_page))) {
+			page_size = 1ull << shift;
+			physical_address = (entry & entry_address_mask & ~(page_size - 1)) | (virtual_address & (page_size - 1));
+			return true;
+		}
+
+		table = entry & entry_address_mask;
+	}
+
+	return false;
+}
+
+std::size_t virtual_memory::physical_run(std::uint64_t virtual_address, std::size_t size,
+                                         std::uint64_t& physical_address) const
+{
+	std::uint64_t page_size;
+
+	if (not translate(virtual_address, physical_address, page_size)) {
+		return 0;
+	}
+
+	std::size_t run = static_cast<std::size_t>(
+	  std::min<std::uint64_t>(size, page_size - (virtual_address & (page_size - 1))));
+
+	// Extend the run while the next pages follow in physical memory.
+	while (run < size) {
+		std::uint64_t next_physical_address;
+
+		if (not translate(virtual_address + run, next_physical_address, page_size) or
+		    next_physical_address != physical_address + run) {
+			break;
+		}
+
+		run += static_cast<std::size_t>(std::min<std::uint64_t>(size - run, page_size));
+	}
+
+	return run;
+}
+
+void virtual_memory::read_buffer(std::uint64_t virtual_address, void* buffer, std::size_t size) const
+{
+	auto output = static_cast<std::uint8_t*>(buffer);
+
+	while (size > 0) {
+		std::uint64_t physical_address;
+		const std::size_t run = physical_run(virtual_address, size, physical_address);
+
+		if (run == 0) {
+			throw std::runtime_error("Virtual address is not mapped.");
+		}
+
+		// A run may span physically adjacent chunks, which read_buffer doesn't read across: try_read_buffer does.
+		if (memory_.try_read_buffer(physical_address, output, run).status == read_status::io_error) {
+			throw std::runtime_error("Can't read the physical memory.");
+		}
+
+		virtual_address += run;
+		output += run;
+		size -= run;
+	}
+}
+
+std::size_t virtual_memory::try_read_buffer(std::uint64_t virtual_address, void* buffer,
+                                            std::size_t size) const noexcept
+{
+	auto output = static_cast<std::uint8_t*>(buffer);
+	std::size_t bytes_read = 0;
+
+	try {
+		while (bytes_read < size) {
+			std::uint64_t physical_address;
+			const std::size_t run = physical_run(virtual_address + bytes_read, size - bytes_read, physical_address);
+
+			if (run == 0) {
+				break;
+			}
+
+			const auto result = memory_.try_read_buffer(physical_address, output + bytes_read, run);
+
+			if (result.status == read_status::io_error) {
+				break;
+			}
+
+			bytes_read += run;
+		}
+	} catch (...) {
+		// Page table reads may throw: stop at the page being translated.
+	}
+
+	std::memset(output + bytes_read, 0, size - bytes_read);
+	return bytes_read;
+}
+}
+} // namespace reven::vmghost
@@ -0,0 +1,245 @@
+#include <xsave.h>
+
+#include <cstring>
+#include <stdexcept>
+
+namespace reven {
+namespace vmghost {
+
+namespace {
+
+//! Offset of the first extended component: after the legacy region and the XSAVE header.
+constexpr std::size_t extended_region_offset = 512 + 64;
+
+struct component_layout {
+	//! Size in bytes, 0 if unknown.
+	std::size_t size;
+	//! Offset in the standard format, 0 if unknown. Fixed by CPUID leaf 0xd, identical on every CPU implementing it.
+	std::size_t standard_offset;
+	//! Whether the component is 64-byte aligned in the compacted format.
+	bool aligned;
+};
+
+//! Components 0 to 18. The legacy components 0 and 1 are not located through this table.
+constexpr component_layout layouts[] = {
+	{ 160, 0, false },    // x87
+	{ 256, 0, false },    // SSE
+	{ 256, 576, false },  // YMM_Hi128
+	{ 64, 960, false },   // BNDREGS
+	{ 64, 1024, false },  // BNDCSR
+	{ 64, 1088, false },  // Opmask
+	{ 512, 1152, false }, // ZMM_Hi256
+	{ 1024, 1664, false },// Hi16_ZMM
+	{ 128, 0, false },    // PT (supervisor)
+	{ 8, 2688, false },   // PKRU
+	{ 8, 0, false },      // PASID (supervisor)
+	{ 16, 0, false },     // CET_U (supervisor)
+	{ 24, 0, false },     // CET_S (supervisor)
+	{ 8, 0, false },      // HDC (supervisor)
+	{ 48, 0, false },     // UINTR (supervisor)
+	{ 0, 0, false },      // LBR (supervisor, variable size)
+	{ 8, 0, false },      // HWP (supervisor)
+	{ 64, 2752, true },   // XTILECFG
+	{ 8192, 2816, true }, // XTILEDATA
+};
+
+constexpr unsigned known_components = sizeof(layouts) / sizeof(*layouts);
+
+void check_index(std::uint8_t index, std::uint8_t count)
+{
+	if (index >= count) {
+		throw std::out_of_range("Invalid vector register index");
+	}
+}
+
+} // anonymous namespace
+
+std::size_t xsave_decoder::component_size(unsigned component)
+{
+	return component < known_components ? layouts[component].size : 0;
+}
+
+std::size_t xsave_decoder::standard_offset(unsigned component)
+{
+	return component < known_components ? layouts[component].standard_offset : 0;
+}
+
+const std::uint8_t* xsave_decoder::component_data(unsigned component) const
+{
+	if (component < xsave::ymm_hi128 or component >= 63) {
+		throw std::out_of_range("Not an extended XSAVE component");
+	}
+
+	if (not is_present(component)) {
+		return nullptr;
+	}
+
+	std::size_t offset = 0;
+
+	if (is_compacted()) {
+		if (not((xcomp_bv() >> component) & 1)) {
+			// Present but not stored: inconsistent header, consider it in its initial state.
+			return nullptr;
+		}
+
+		offset = extended_region_offset;
+
+		for (unsigned i = xsave::ymm_hi128; i < component; ++i) {
+			if (not((xcomp_bv() >> i) & 1)) {
+				continue;
+			}
+
+			if (component_size(i) == 0) {
+				throw std::runtime_error("Can't locate an XSAVE component stored after one of unknown size");
+			}
+
+			if (i < known_components and layouts[i].aligned) {
+				offset = (offset + 63) & ~std::size_t(63);
+			}
+
+			offset += component_size(i);
+		}
+
+		if (component < known_components and layouts[component].aligned) {
+			offset = (offset + 63) & ~std::size_t(63);
+		}
+	} else {
+		offset = standard_offset(component);
+	}
+
+	if (offset == 0 or component_size(component) == 0) {
+		throw std::runtime_error("Unknown XSAVE component layout");
+	}
+
+	if (offset + component_size(component) > sizeof(area_)) {
+		throw std::runtime_error("XSAVE component beyond the end of the XSAVE area");
+	}
+
+	return reinterpret_cast<const std::uint8_t*>(&area_) + offset;
+}
+
+vector128 xsave_decoder::xmm(std::uint8_t index) const
+{
+	check_index(index, 16);
+
+	vector128 result;
+	std::memcpy(result.bytes, area_.x87.aXMM[index].au8, sizeof(result.bytes));
+	return result;
+}
+
+vector256 xsave_decoder::ymm(std::uint8_t index) const
+{
+	check_index(index, 16);
+
+	vector256 result;
+	std::memcpy(result.bytes, area_.x87.aXMM[index].au8, 16);
+
+	const std::uint8_t* high = component_data(xsave::ymm_hi128);
+
+	if (high) {
+		std::memcpy(result.bytes + 16, high + index * 16, 16);
+	} else {
+		std::memset(result.bytes + 16, 0, 16);
+	}
+
+	return result;
+}
+
+vector512 xsave_decoder::zmm(std::uint8_t index) const
+{
+	check_index(index, 32);
+
+	vector512 result;
+
+	if (index >= 16) {
+		const std::uint8_t* data = component_data(xsave::hi16_zmm);
+
+		if (data) {
+			std::memcpy(result.bytes, data + (index - 16) * 64, 64);
+		} else {
+			std::memset(result.bytes, 0, 64);
+		}
+
+		return result;
+	}
+
+	const vector256 low = ymm(index);
+	std::memcpy(result.bytes, low.bytes, 32);
+
+	const std::uint8_t* high = component_data(xsave::zmm_hi256);
+
+	if (high) {
+		std::memcpy(result.bytes + 32, high + index * 32, 32);
+	} else {
+		std::memset(result.bytes + 32, 0, 32);
+	}
+
+	return result;
+}
+
+std::uint64_t xsave_decoder::opmask(std::uint8_t index) const
+{
+	check_index(index, 8);
+
+	const std::uint8_t* data = component_data(xsave::opmask);
+	std::uint64_t result = 0;
+
+	if (data) {
+		std::memcpy(&result, data + index * 8, 8);
+	}
+
+	return result;
+}
+
+void xsave_decoder::ymm_registers(vector256 (&registers)[16]) const
+{
+	const std::uint8_t* high = component_data(xsave::ymm_hi128);
+
+	for (std::uint8_t i = 0; i < 16; ++i) {
+		std::memcpy(registers[i].bytes, area_.x87.aXMM[i].au8, 16);
+
+		if (high) {
+			std::memcpy(registers[i].bytes + 16, high + i * 16, 16);
+		} else {
+			std::memset(registers[i].bytes + 16, 0, 16);
+		}
+	}
+}
+
+void xsave_decoder::zmm_registers(vector512 (&registers)[32]) const
+{
+	vector256 low[16];
+	ymm_registers(low);
+
+	const std::uint8_t* zmm_hi256 = component_data(xsave::zmm_hi256);
+	const std::uint8_t* hi16_zmm = component_data(xsave::hi16_zmm);
+
+	for (std::uint8_t i = 0; i < 16; ++i) {
+		std::memcpy(registers[i].bytes, low[i].bytes, 32);
+
+		if (zmm_hi256) {
+			std::memcpy(registers[i].bytes + 32, zmm_hi256 + i * 32, 32);
+		} else {
+			std::memset(registers[i].bytes + 32, 0, 32);
+		}
+	}
+
+	if (hi16_zmm) {
+		std::memcpy(&registers[16], hi16_zmm, 16 * 64);
+	} else {
+		std::memset(&registers[16], 0, 16 * 64);
+	}
+}
+
+void xsave_decoder::opmask_registers(std::uint64_t (&registers)[8]) const
+{
+	const std::uint8_t* data = component_data(xsave::opmask);
+
+	if (data) {
+		std::memcpy(registers, data, sizeof(registers));
+	} else {
+		std::memset(registers, 0, sizeof(registers));
+	}
+}
+}
+} // namespace reven::vmghost
@@ -0,0 +1,214 @@
+#include <cpu_view.h>
+#include <cpu_virtualbox.h>
+#include <register_id.h>
+
+#include <cstring>
+#include <stdexcept>
+
+#define BOOST_TEST_MODULE cpu_virtualbox
+#include <boost/test/unit_test.hpp>
+
+using namespace reven::vmghost;
+
+namespace {
+
+//! A context whose registers hold recognizable values.
+vbox::DBGFCORECPU make_context(std::uint32_t version)
+{
+	vbox::DBGFCORECPU context;
+	std::memset(&context, 0, sizeof(context));
+
+	context.base.rax = 0x1111;
+	context.base.rip = 0xfffff80012345678;
+	context.base.cr3 = 0x1aa000;
+	context.base.cs.uSel = 0x10;
+	context.base.cs.uAttr = 0xa09b;
+	context.base.msrLSTAR = 0xfffff80000001000;
+
+	vbox::X86XSAVEAREA* ext;
+
+	if (version == vbox::DBGFCORE_FMT_VERSIONv6) {
+		context.v6.msrTscAux = 0x2;
+		ext = &context.v6.ext;
+	} else {
+		ext = &context.v5.ext;
+	}
+
+	ext->x87.FSW = 0x4220;
+	ext->x87.MXCSR = 0x1f80;
+	ext->x87.aXMM[3].au32[2] = 0xdeadbeef;
+
+	return context;
+}
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_CASE(cpuView)
+{
+	for (std::uint32_t version : { vbox::DBGFCORE_FMT_VERSION_COMPAT, vbox::DBGFCORE_FMT_VERSIONv5,
+	                               vbox::DBGFCORE_FMT_VERSIONv6 }) {
+		cpu_virtualbox cpu(version, make_context(version));
+
+		const bool is_v6 = visit_cpu(cpu, [&](auto const& view) {
+			BOOST_CHECK_EQUAL(view.rax(), cpu.rax());
+			BOOST_CHECK_EQUAL(view.rip(), cpu.rip());
+			BOOST_CHECK_EQUAL(view.cr3(), cpu.cr3());
+			BOOST_CHECK_EQUAL(view.cs().uSel, cpu.cs());
+			BOOST_CHECK_EQUAL(view.msrLSTAR(), cpu.msrLSTAR());
+			BOOST_CHECK_EQUAL(view.fpu_status_word(), cpu.fpu_status_word());
+			BOOST_CHECK_EQUAL(view.mxcsr(), cpu.mxcsr());
+			BOOST_CHECK_EQUAL(view.partial_sse_register(3, 2), cpu.partial_sse_register(3, 2));
+
+			return std::decay<decltype(view)>::type::version == vbox::DBGFCORE_FMT_VERSIONv6;
+		});
+
+		BOOST_CHECK_EQUAL(is_v6, version == vbox::DBGFCORE_FMT_VERSIONv6);
+
+		if (is_v6) {
+			BOOST_CHECK_EQUAL(cpu_view_v6(cpu).msrTscAux(), cpu.msrTscAux());
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(lazyExtendedState)
+{
+	const auto version = vbox::DBGFCORE_FMT_VERSIONv6;
+	const auto context = make_context(version);
+
+	unsigned loads = 0;
+
+	cpu_virtualbox cpu;
+	cpu.set_version(version);
+	cpu.set_hot_state(cpu_virtualbox::make_hot_state(version, context), [&](vbox::X86XSAVEAREA& area) {
+		++loads;
+		area = context.v6.ext;
+	});
+
+	const cpu_virtualbox copy = cpu;
+
+	BOOST_CHECK_EQUAL(cpu.rip(), 0xfffff80012345678);
+	BOOST_CHECK_EQUAL(cpu.msrTscAux(), 0x2);
+	BOOST_CHECK_EQUAL(loads, 0);
+
+	BOOST_CHECK_EQUAL(cpu.mxcsr(), 0x1f80);
+	BOOST_CHECK_EQUAL(copy.fpu_status_word(), 0x4220);
+	BOOST_CHECK_EQUAL(loads, 1);
+
+	auto rebuilt = copy.context();
+	BOOST_CHECK_EQUAL(std::memcmp(&rebuilt, &context, sizeof(context)), 0);
+
+	BOOST_CHECK_EQUAL(reinterpret_cast<std::uintptr_t>(&cpu.hot_state()) % 64, 0);
+}
+
+BOOST_AUTO_TEST_CASE(xsaveComponents)
+{
+	for (bool compacted : { false, true }) {
+		const auto version = vbox::DBGFCORE_FMT_VERSIONv6;
+		auto context = make_context(version);
+		auto& area = context.v6.ext;
+		auto bytes = reinterpret_cast<std::uint8_t*>(&area);
+
+		// x87, SSE, YMM_Hi128, opmask, ZMM_Hi256 and Hi16_ZMM; not the MPX components 3 and 4.
+		area.Hdr.bmXState = 0xe7;
+
+		std::size_t ymm_hi128 = 576;
+		std::size_t opmask = 1088;
+		std::size_t zmm_hi256 = 1152;
+		std::size_t hi16_zmm = 1664;
+
+		if (compacted) {
+			area.Hdr.bmXComp = xsave::compacted_format | 0xe7;
+			opmask = ymm_hi128 + 256;
+			zmm_hi256 = opmask + 64;
+			hi16_zmm = zmm_hi256 + 512;
+		}
+
+		bytes[ymm_hi128 + 3 * 16] = 0x33;
+		bytes[opmask + 5 * 8] = 0x55;
+		bytes[zmm_hi256 + 3 * 32 + 1] = 0x66;
+		bytes[hi16_zmm + 4 * 64 + 63] = 0x77;
+
+		cpu_virtualbox cpu(version, context);
+
+		BOOST_CHECK_EQUAL(cpu.xstate_bv(), 0xe7);
+
+		const vector256 ymm3 = cpu.ymm_register(3);
+		BOOST_CHECK_EQUAL(ymm3.bytes[8], 0xef);
+		BOOST_CHECK_EQUAL(ymm3.bytes[16], 0x33);
+
+		const vector512 zmm3 = cpu.zmm_register(3);
+		BOOST_CHECK_EQUAL(std::memcmp(zmm3.bytes, ymm3.bytes, 32), 0);
+		BOOST_CHECK_EQUAL(zmm3.bytes[33], 0x66);
+
+		BOOST_CHECK_EQUAL(cpu.zmm_register(20).bytes[63], 0x77);
+		BOOST_CHECK_EQUAL(cpu.opmask_register(5), 0x55);
+
+		vector512 zmm[32];
+		cpu.xsave().zmm_registers(zmm);
+		BOOST_CHECK_EQUAL(std::memcmp(&zmm[3], &zmm3, sizeof(zmm3)), 0);
+		BOOST_CHECK_EQUAL(zmm[20].bytes[63], 0x77);
+
+		// Components absent from XSTATE_BV are in their initial state.
+		context.v6.ext.Hdr.bmXState = 0x3;
+		cpu.set_context(context);
+		BOOST_CHECK_EQUAL(cpu.ymm_register(3).bytes[16], 0);
+		BOOST_CHECK_EQUAL(cpu.opmask_register(5), 0);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(setContextVersion)
+{
+	const auto context = make_context(vbox::DBGFCORE_FMT_VERSIONv6);
+
+	// Without a version, the layout of the context is unknown.
+	cpu_virtualbox cpu;
+	BOOST_CHECK_THROW(cpu.set_context(context), std::runtime_error);
+
+	cpu.set_context(vbox::DBGFCORE_FMT_VERSIONv6, context);
+	BOOST_CHECK_EQUAL(cpu.version(), vbox::DBGFCORE_FMT_VERSIONv6);
+	BOOST_CHECK_EQUAL(cpu.msrTscAux(), 0x2);
+	BOOST_CHECK_EQUAL(cpu.mxcsr(), context.v6.ext.x87.MXCSR);
+}
+
+BOOST_AUTO_TEST_CASE(registerId)
+{
+	for (std::uint32_t version : { vbox::DBGFCORE_FMT_VERSIONv5, vbox::DBGFCORE_FMT_VERSIONv6 }) {
+		cpu_virtualbox cpu(version, make_context(version));
+
+		BOOST_CHECK_EQUAL(cpu.get(register_id::rax), cpu.rax());
+		BOOST_CHECK_EQUAL(cpu.get(register_id::cs), cpu.cs());
+		BOOST_CHECK_EQUAL(cpu.get(register_id::cs_attr), 0xa09bu);
+		BOOST_CHECK_EQUAL(cpu.get(register_id::fpu_status_word), cpu.fpu_status_word());
+		BOOST_CHECK_EQUAL(cpu.get(register_id::mxcsr), cpu.mxcsr());
+		BOOST_CHECK_THROW(cpu.get(register_id::xmm3), std::runtime_error);
+
+		const register_id ids[] = { register_id::rip, register_id::cr3, register_id::msr_lstar };
+		std::uint64_t values[3];
+		cpu.get_many(ids, 3, values);
+		BOOST_CHECK_EQUAL(values[0], cpu.rip());
+		BOOST_CHECK_EQUAL(values[1], cpu.cr3());
+		BOOST_CHECK_EQUAL(values[2], cpu.msrLSTAR());
+
+		std::uint32_t xmm3[4];
+		cpu.get_raw(register_id::xmm3, xmm3);
+		BOOST_CHECK_EQUAL(xmm3[2], cpu.partial_sse_register(3, 2));
+
+		if (version == vbox::DBGFCORE_FMT_VERSIONv6) {
+			BOOST_CHECK_EQUAL(cpu.get(register_id::msr_tsc_aux), cpu.msrTscAux());
+		} else {
+			BOOST_CHECK_THROW(cpu.get(register_id::msr_tsc_aux), std::runtime_error);
+		}
+	}
+
+	// The abridged tag word is one byte, followed by a reserved byte.
+	auto context = make_context(vbox::DBGFCORE_FMT_VERSIONv6);
+	context.v6.ext.x87.FTW = 0xab12;
+	const cpu_virtualbox tagged(vbox::DBGFCORE_FMT_VERSIONv6, context);
+	BOOST_CHECK_EQUAL(tagged.get(register_id::fpu_abridged_tags), 0x12u);
+	BOOST_CHECK_EQUAL(tagged.get(register_id::fpu_abridged_tags), tagged.fpu_abridged_tags());
+
+	register_id id;
+	BOOST_CHECK(find_register("msr_lstar", id));
+	BOOST_CHECK(id == register_id::msr_lstar);
+	BOOST_CHECK(not find_register("eax", id));
+}
@@ -0,0 +1,1127 @@
+#include <access_trace.h>
+#include <core_writer.h>
+#include <delta_core.h>
+#include <guest_strings.h>
+#include <layered_memory.h>
+#include <memory_stats.h>
+#include <memory_virtualbox.h>
+#include <memory_virtualbox_reader.h>
+#include <overlay_memory.h>
+#include <page_iterator.h>
+#include <page_store.h>
+#include <physical_memory_map.h>
+#include <raw_image_memory.h>
+#include <read_queue.h>
+#include <streaming_reader.h>
+
+#include <elf.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <thread>
+#include <iostream>
+#include <vector>
+
+#define BOOST_TEST_MODULE MemoryVirtualBox
+#include <boost/test/unit_test.hpp>
+
+using reven::vmghost::MemoryChunk;
+using reven::vmghost::MemoryVirtualBox;
+
+namespace {
+
+std::uint8_t file_byte(std::uint64_t offset)
+{
+	return static_cast<std::uint8_t>(offset * 7 + (offset >> 8));
+}
+
+} // anonymous namespace
+
+//!
+//! A memory made of two chunks backed by a temporary file:
+//!   - [0x0, 0x4000) read from file offset 0x0, whose last page is not in the file;
+//!   - [0x10000, 0x12000) read from file offset 0x3000.
+//!
+struct TwoChunksFixture {
+	TwoChunksFixture()
+	{
+		char path[] = "/tmp/rvncorevirtualbox_testXXXXXX";
+		int fd = ::mkstemp(path);
+		BOOST_REQUIRE(fd >= 0);
+		::close(fd);
+		path_ = path;
+
+		std::vector<std::uint8_t> content(file_size);
+		for (std::uint64_t i = 0; i < file_size; ++i) {
+			content[i] = file_byte(i);
+		}
+
+		std::ofstream(path_, std::ios::binary).write(reinterpret_cast<const char*>(content.data()), content.size());
+
+		auto file = std::make_shared<reven::vmghost::core_file>(path_);
+		memory_.insert(MemoryChunk(file, 0x0, 0x3000, 0x0, 0x4000));
+		memory_.insert(MemoryChunk(file, 0x3000, 0x2000, 0x10000, 0x2000));
+	}
+
+	~TwoChunksFixture() { ::unlink(path_.c_str()); }
+
+	//! The byte expected at @c physical_address, for backed addresses.
+	static std::uint8_t expected(std::uint64_t physical_address)
+	{
+		return physical_address >= 0x10000 ? file_byte(physical_address - 0x10000 + 0x3000)
+		                                   : file_byte(physical_address);
+	}
+
+	static constexpr std::uint64_t file_size = 0x5000;
+
+	std::string path_;
+	MemoryVirtualBox memory_;
+};
+
+BOOST_FIXTURE_TEST_CASE(readBuffer, TwoChunksFixture)
+{
+	std::vector<std::uint8_t> buffer(0x100);
+
+	memory_.read_buffer(0x10080, buffer.data(), buffer.size());
+
+	for (std::size_t i = 0; i < buffer.size(); ++i) {
+		BOOST_CHECK_EQUAL(buffer[i], expected(0x10080 + i));
+	}
+}
+
+BOOST_FIXTURE_TEST_CASE(streamingReader, TwoChunksFixture)
+{
+	for (bool direct : { true, false }) {
+		reven::vmghost::streaming_options options;
+		options.batch_size = 0x1000;
+		options.direct_io = direct;
+
+		reven::vmghost::streaming_reader reader(memory_, options);
+
+		BOOST_CHECK_EQUAL(reader.size(), 0x5000);
+
+		std::vector<std::uint64_t> addresses;
+
+		reader.run([&](std::uint64_t physical_address, const std::uint8_t* data, std::size_t size) {
+			BOOST_CHECK_EQUAL(size, 0x1000);
+
+			for (std::size_t i = 0; i < size; ++i) {
+				BOOST_REQUIRE_EQUAL(data[i], expected(physical_address + i));
+			}
+
+			addresses.push_back(physical_address);
+		});
+
+		const std::vector<std::uint64_t> reference = { 0x0, 0x1000, 0x2000, 0x10000, 0x11000 };
+		BOOST_CHECK_EQUAL_COLLECTIONS(addresses.begin(), addresses.end(), reference.begin(), reference.end());
+	}
+}
+
+BOOST_FIXTURE_TEST_CASE(streamingReaderVisitorError, TwoChunksFixture)
+{
+	reven::vmghost::streaming_options options;
+	options.batch_size = 0x1000;
+
+	reven::vmghost::streaming_reader reader(memory_, options);
+
+	BOOST_CHECK_THROW(reader.run([](std::uint64_t, const std::uint8_t*, std::size_t) {
+		throw std::runtime_error("stop");
+	}), std::runtime_error);
+}
+
+BOOST_FIXTURE_TEST_CASE(readAsync, TwoChunksFixture)
+{
+	std::vector<std::uint8_t> buffer(0x200, 0xff);
+
+	auto first = memory_.read_async(0x1f00, buffer.data(), 0x100);
+	// Crosses the end of the second chunk: zero-filled, like read_buffer.
+	auto second = memory_.read_async(0x11f80, buffer.data() + 0x100, 0x100);
+
+	first.get();
+	second.get();
+
+	for (std::size_t i = 0; i < 0x100; ++i) {
+		BOOST_CHECK_EQUAL(buffer[i], expected(0x1f00 + i));
+		BOOST_CHECK_EQUAL(buffer[0x100 + i], 0);
+	}
+}
+
+BOOST_FIXTURE_TEST_CASE(readQueue, TwoChunksFixture)
+{
+	for (bool io_uring : { true, false }) {
+		reven::vmghost::read_queue_options options;
+		options.depth = 8;
+		options.use_io_uring = io_uring;
+
+		reven::vmghost::read_queue queue(memory_, options);
+
+		if (not io_uring) {
+			BOOST_CHECK(not queue.uses_io_uring());
+		}
+
+		// 64 reads of 0x80 bytes, more than the queue depth, alternating between both chunks.
+		std::vector<std::uint8_t> buffer(64 * 0x80);
+		std::vector<std::uint64_t> addresses;
+		std::vector<reven::vmghost::read_queue::token> tokens;
+
+		for (std::size_t i = 0; i < 64; ++i) {
+			addresses.push_back((i % 2 ? 0x10000 : 0x0) + i * 0x80);
+			tokens.push_back(queue.submit(addresses.back(), buffer.data() + i * 0x80, 0x80));
+		}
+
+		queue.wait(tokens.front());
+		BOOST_CHECK(queue.is_done(tokens.front()));
+
+		queue.wait_all();
+		BOOST_CHECK_EQUAL(queue.in_flight(), 0);
+
+		for (std::size_t i = 0; i < 64; ++i) {
+			for (std::size_t j = 0; j < 0x80; ++j) {
+				BOOST_REQUIRE_EQUAL(buffer[i * 0x80 + j], expected(addresses[i] + j));
+			}
+		}
+	}
+}
+
+BOOST_FIXTURE_TEST_CASE(pageRange, TwoChunksFixture)
+{
+	std::vector<std::uint64_t> addresses;
+
+	reven::vmghost::for_each_page(memory_, [&](const reven::vmghost::page_span& page) {
+		BOOST_CHECK_EQUAL(page.size, 0x1000);
+
+		for (std::size_t i = 0; i < page.size; ++i) {
+			BOOST_REQUIRE_EQUAL(page.data[i], expected(page.physical_address + i));
+		}
+
+		addresses.push_back(page.physical_address);
+	});
+
+	const std::vector<std::uint64_t> reference = { 0x0, 0x1000, 0x2000, 0x10000, 0x11000 };
+	BOOST_CHECK_EQUAL_COLLECTIONS(addresses.begin(), addresses.end(), reference.begin(), reference.end());
+
+	reven::vmghost::page_range runs(memory_, 0);
+	BOOST_CHECK_EQUAL(runs.page_count(), 2);
+	BOOST_CHECK_EQUAL(runs.begin()->size, 0x3000);
+	BOOST_CHECK_EQUAL(runs.at(1)->physical_address, 0x10000);
+
+	reven::vmghost::page_range pages(memory_, 0x800);
+	BOOST_CHECK_EQUAL(pages.page_count(), 10);
+	BOOST_CHECK_EQUAL(pages.at(7)->physical_address, 0x10800);
+	BOOST_CHECK(pages.at(10) == pages.end());
+}
+
+BOOST_FIXTURE_TEST_CASE(parallelForEachPage, TwoChunksFixture)
+{
+	std::atomic<std::uint64_t> bytes{0};
+	std::atomic<std::uint64_t> mismatches{0};
+
+	reven::vmghost::parallel_for_each_page(memory_, [&](const reven::vmghost::page_span& page) {
+		for (std::size_t i = 0; i < page.size; ++i) {
+			if (page.data[i] != expected(page.physical_address + i)) {
+				++mismatches;
+			}
+		}
+
+		bytes += page.size;
+	}, 3);
+
+	BOOST_CHECK_EQUAL(bytes.load(), 0x5000);
+	BOOST_CHECK_EQUAL(mismatches.load(), 0);
+}
+
+BOOST_FIXTURE_TEST_CASE(memoryVirtualBoxReader, TwoChunksFixture)
+{
+	reven::vmghost::MemoryVirtualBoxReader reader(memory_);
+
+	for (std::uint64_t address : { 0x0, 0x1ffc, 0x10000, 0x11ff8 }) {
+		std::uint64_t reference = 0;
+		std::uint64_t value = 1;
+
+		memory_.read<std::uint64_t>(address, reference);
+		BOOST_CHECK(reader.read<std::uint64_t>(address, value));
+		BOOST_CHECK_EQUAL(value, reference);
+	}
+
+	// Uninitialized tail, hole and read crossing the end of a chunk.
+	for (std::uint64_t address : { 0x3800, 0x8000, 0x11ffc }) {
+		std::uint64_t value = 1;
+
+		reader.read_buffer(address, &value, sizeof(value));
+		BOOST_CHECK_EQUAL(value, 0);
+	}
+}
+
+BOOST_FIXTURE_TEST_CASE(tryReadBuffer, TwoChunksFixture)
+{
+	using reven::vmghost::read_status;
+
+	struct TestCase {
+		std::uint64_t address_;
+		std::size_t size_;
+		read_status status_;
+		std::size_t bytes_read_;
+	};
+
+	const TestCase tests_suite[] = { { 0x100, 0x100, read_status::backed, 0x100 },
+		                             { 0x2f00, 0x200, read_status::partially_backed, 0x100 },
+		                             { 0x3000, 0x100, read_status::uninitialized, 0 },
+		                             { 0x8000, 0x100, read_status::hole, 0 },
+		                             // Uninitialized tail, hole, then the start of the second chunk.
+		                             { 0x3f00, 0xc200, read_status::partially_backed, 0x100 } };
+
+	for (auto const& test : tests_suite) {
+		std::vector<std::uint8_t> buffer(test.size_, 0xff);
+
+		auto result = memory_.try_read_buffer(test.address_, buffer.data(), buffer.size());
+
+		BOOST_CHECK(result.status == test.status_);
+		BOOST_CHECK_EQUAL(result.bytes_read, test.bytes_read_);
+
+		for (std::size_t i = 0; i < buffer.size(); ++i) {
+			const std::uint64_t address = test.address_ + i;
+			const bool backed = address < 0x3000 or (address >= 0x10000 and address < 0x12000);
+
+			BOOST_REQUIRE_EQUAL(buffer[i], backed ? expected(address) : 0);
+		}
+	}
+}
+
+BOOST_FIXTURE_TEST_CASE(physicalMemoryMap, TwoChunksFixture)
+{
+	reven::vmghost::physical_memory_map map(memory_);
+
+	BOOST_REQUIRE_EQUAL(map.regions().size(), 2);
+	BOOST_CHECK_EQUAL(map.regions()[0].backed_end, 0x3000);
+	BOOST_CHECK_EQUAL(map.backed_bytes(), 0x5000);
+	BOOST_CHECK_EQUAL(map.backed_bytes(0x2800, 0x10800), 0x1000);
+
+	BOOST_CHECK_EQUAL(map.overlapping(0x3fff, 0x10001).size(), 2);
+	BOOST_CHECK_EQUAL(map.overlapping(0x4000, 0x10000).size(), 0);
+
+	std::uint64_t address = 0;
+	BOOST_CHECK(map.next_backed(0x2fff, address));
+	BOOST_CHECK_EQUAL(address, 0x2fff);
+	BOOST_CHECK(map.next_backed(0x3000, address));
+	BOOST_CHECK_EQUAL(address, 0x10000);
+	BOOST_CHECK(not map.next_backed(0x12000, address));
+
+	BOOST_CHECK(map.backed_address_at(0x3000, address));
+	BOOST_CHECK_EQUAL(address, 0x10000);
+	BOOST_CHECK(not map.backed_address_at(0x5000, address));
+
+	auto holes = map.holes(0x0, 0x20000);
+	BOOST_REQUIRE_EQUAL(holes.size(), 2);
+	BOOST_CHECK_EQUAL(holes[0].begin, 0x4000);
+	BOOST_CHECK_EQUAL(holes[0].end, 0x10000);
+	BOOST_CHECK_EQUAL(holes[1].begin, 0x12000);
+
+	// 0x5000 backed bytes in 5 parts: one backed page each.
+	auto parts = map.partition(5);
+	BOOST_REQUIRE_EQUAL(parts.size(), 5);
+	BOOST_CHECK_EQUAL(parts[3].begin, 0x10000);
+	BOOST_CHECK_EQUAL(parts[4].end, 0x12000);
+
+	for (auto const& part : parts) {
+		BOOST_CHECK_EQUAL(map.backed_bytes(part.begin, part.end), 0x1000);
+	}
+}
+
+BOOST_FIXTURE_TEST_CASE(findStrings, TwoChunksFixture)
+{
+	// Physically adjacent to the second chunk: strings may continue from one into the other.
+	memory_.insert(MemoryChunk(memory_.chunk_at(0x10000)->file(), 0x0, 0x1000, 0x12000, 0x1000));
+
+	struct run {
+		std::uint64_t begin;
+		std::vector<std::uint8_t> bytes;
+	};
+
+	std::vector<run> runs = { { 0x0, {} }, { 0x10000, {} } };
+
+	for (std::uint64_t address = 0; address < 0x3000; ++address) {
+		runs[0].bytes.push_back(expected(address));
+	}
+	for (std::uint64_t address = 0x10000; address < 0x12000; ++address) {
+		runs[1].bytes.push_back(expected(address));
+	}
+	for (std::uint64_t offset = 0; offset < 0x1000; ++offset) {
+		runs[1].bytes.push_back(file_byte(offset));
+	}
+
+	auto printable = [](std::uint8_t c) { return (c >= 0x20 and c < 0x7f) or c == '\t'; };
+
+	std::vector<reven::vmghost::string_match> reference;
+
+	for (auto const& run : runs) {
+		for (std::size_t step : { 1, 2 }) {
+			std::size_t length = 0;
+
+			for (std::size_t offset = 0; offset + step <= run.bytes.size() + step; offset += step) {
+				const bool is_character = offset + step <= run.bytes.size() and printable(run.bytes[offset]) and
+				                          (step == 1 or run.bytes[offset + 1] == 0);
+
+				if (is_character) {
+					++length;
+					continue;
+				}
+
+				if (length >= 4) {
+					reference.push_back({ run.begin + offset - length * step, length,
+					                      step == 1 ? reven::vmghost::string_encoding::ascii
+					                                : reven::vmghost::string_encoding::utf16 });
+				}
+
+				length = 0;
+			}
+		}
+	}
+
+	std::sort(reference.begin(), reference.end(), [](auto const& lhs, auto const& rhs) {
+		return lhs.physical_address < rhs.physical_address;
+	});
+
+	reven::vmghost::strings_options options;
+	options.threads = 2;
+	const auto matches = reven::vmghost::find_strings(memory_, options);
+
+	BOOST_REQUIRE_EQUAL(matches.size(), reference.size());
+
+	for (std::size_t i = 0; i < matches.size(); ++i) {
+		BOOST_CHECK_EQUAL(matches[i].physical_address, reference[i].physical_address);
+		BOOST_CHECK_EQUAL(matches[i].length, reference[i].length);
+		BOOST_CHECK(matches[i].encoding == reference[i].encoding);
+	}
+
+	const auto& first = reference.front();
+	const auto string = reven::vmghost::read_string(memory_, first.physical_address);
+	BOOST_REQUIRE(string.size() >= first.length);
+	BOOST_CHECK_EQUAL(expected(first.physical_address + string.size()), 0);
+
+	for (std::size_t i = 0; i < string.size(); ++i) {
+		BOOST_CHECK_EQUAL(string[i], static_cast<char>(expected(first.physical_address + i)));
+	}
+}
+
+BOOST_FIXTURE_TEST_CASE(overlayMemory, TwoChunksFixture)
+{
+	reven::vmghost::overlay_memory overlay(
+	  std::shared_ptr<const reven::vmghost::physical_memory>(&memory_, [](const reven::vmghost::physical_memory*) {}));
+
+	// Crosses from page 1 to page 2.
+	const std::vector<std::uint8_t> data(0x20, 0xaa);
+	overlay.write_buffer(0x1ff0, data.data(), data.size());
+
+	BOOST_CHECK_EQUAL(overlay.dirty_page_count(), 2);
+	BOOST_CHECK((overlay.dirty_pages() == std::vector<std::uint64_t>{ 1, 2 }));
+
+	auto check = [&](std::uint64_t address, std::size_t size, std::uint64_t written_begin,
+	                 std::uint64_t written_end, std::uint8_t written) {
+		std::vector<std::uint8_t> buffer(size);
+		overlay.read_buffer(address, buffer.data(), size);
+
+		for (std::size_t i = 0; i < size; ++i) {
+			const std::uint64_t byte_address = address + i;
+			const bool is_written = byte_address >= written_begin and byte_address < written_end;
+			BOOST_REQUIRE_EQUAL(buffer[i], is_written ? written : expected(byte_address));
+		}
+	};
+
+	check(0x0, 0x3000, 0x1ff0, 0x2010, 0xaa);
+
+	const auto first = overlay.checkpoint();
+	overlay.write<std::uint64_t>(0x1ff8, 0xbbbbbbbbbbbbbbbb);
+	overlay.write<std::uint8_t>(0x10000, 0xcc);
+	BOOST_CHECK_EQUAL(overlay.dirty_page_count(), 3);
+
+	const auto second = overlay.checkpoint();
+	overlay.write<std::uint8_t>(0x10001, 0xdd);
+
+	std::uint8_t value;
+	overlay.read(0x10001, value);
+	BOOST_CHECK_EQUAL(value, 0xdd);
+
+	overlay.rollback(second);
+	overlay.read(0x10001, value);
+	BOOST_CHECK_EQUAL(value, expected(0x10001));
+	overlay.read(0x10000, value);
+	BOOST_CHECK_EQUAL(value, 0xcc);
+
+	overlay.rollback(first);
+	BOOST_CHECK_EQUAL(overlay.dirty_page_count(), 2);
+	BOOST_CHECK(not overlay.is_dirty(0x10));
+	check(0x0, 0x3000, 0x1ff0, 0x2010, 0xaa);
+	BOOST_CHECK_THROW(overlay.rollback(second), std::runtime_error);
+
+	// A dropped checkpoint doesn't alias the checkpoints taken after the rollback.
+	const auto third = overlay.checkpoint();
+	const auto fourth = overlay.checkpoint();
+	overlay.write<std::uint8_t>(0x10000, 0xee);
+	BOOST_CHECK_THROW(overlay.rollback(first), std::runtime_error);
+	BOOST_CHECK_THROW(overlay.rollback(second), std::runtime_error);
+	overlay.read(0x10000, value);
+	BOOST_CHECK_EQUAL(value, 0xee);
+
+	overlay.rollback(fourth);
+	overlay.read(0x10000, value);
+	BOOST_CHECK_EQUAL(value, expected(0x10000));
+	overlay.rollback(third);
+
+	const auto result = overlay.try_read_buffer(0x2ff0, std::vector<std::uint8_t>(0x20).data(), 0x20);
+	BOOST_CHECK(result.status == reven::vmghost::read_status::partially_backed);
+
+	overlay.reset();
+	BOOST_CHECK_EQUAL(overlay.dirty_page_count(), 0);
+	check(0x0, 0x3000, 0, 0, 0);
+}
+
+BOOST_FIXTURE_TEST_CASE(overlayMemoryUninitializedTail, TwoChunksFixture)
+{
+	reven::vmghost::overlay_memory overlay(
+	  std::shared_ptr<const reven::vmghost::physical_memory>(&memory_, [](const reven::vmghost::physical_memory*) {}));
+
+	// Leave a page filled with 0xcd in the arena's free list.
+	const auto checkpoint = overlay.checkpoint();
+	overlay.write_buffer(0x1000, std::vector<std::uint8_t>(0x1000, 0xcd).data(), 0x1000);
+	overlay.rollback(checkpoint);
+
+	// The page [0x3000, 0x4000) is the uninitialized tail of the first chunk: it reads as zeros.
+	overlay.write<std::uint8_t>(0x3000, 0x11);
+
+	std::uint64_t value = 1;
+	overlay.read_buffer(0x3008, &value, sizeof(value));
+	BOOST_CHECK_EQUAL(value, 0);
+
+	std::uint8_t byte = 0;
+	overlay.read(0x3000, byte);
+	BOOST_CHECK_EQUAL(byte, 0x11);
+}
+
+BOOST_FIXTURE_TEST_CASE(layeredMemory, TwoChunksFixture)
+{
+	using namespace reven::vmghost;
+
+	const std::string image_path = path_ + ".raw";
+	std::ofstream(image_path, std::ios::binary).write(std::string(0x2000, '\x11').data(), 0x2000);
+
+	std::shared_ptr<const physical_memory> core(&memory_, [](const physical_memory*) {});
+	auto image = std::make_shared<raw_image_memory>(image_path);
+	auto patches = std::make_shared<overlay_memory>(core);
+	patches->write<std::uint8_t>(0x2700, 0x22);
+
+	layered_memory layers;
+	layers.add_layer(core, memory_coverage(memory_));
+	layers.add_layer(image, { memory_range{ 0x1000, 0x1800 } });
+	const auto top = layers.add_layer(patches, memory_coverage(*patches));
+
+	// [0, 0x1000) core, [0x1000, 0x1800) image, [0x1800, 0x2000) core, [0x2000, 0x3000) patches (which cover
+	// whole pages), [0x3000, 0x4000) core, hole, [0x10000, 0x12000) core, hole.
+	BOOST_CHECK_EQUAL(layers.run_count(), 8);
+
+	std::vector<std::uint8_t> buffer(0x5000);
+	layers.read_buffer(0x0, buffer.data(), buffer.size());
+
+	BOOST_CHECK_EQUAL(buffer[0xfff], expected(0xfff));
+	BOOST_CHECK_EQUAL(buffer[0x1000], 0x11);
+	BOOST_CHECK_EQUAL(buffer[0x17ff], 0x11);
+	BOOST_CHECK_EQUAL(buffer[0x1800], expected(0x1800));
+	BOOST_CHECK_EQUAL(buffer[0x2700], 0x22);
+	BOOST_CHECK_EQUAL(buffer[0x2701], expected(0x2701));
+	BOOST_CHECK_EQUAL(buffer[0x4800], 0);
+
+	layered_memory::layer_id layer;
+	BOOST_CHECK(layers.layer_at(0x1234, layer));
+	BOOST_CHECK_EQUAL(layer, 1);
+	BOOST_CHECK(not layers.layer_at(0x4000, layer));
+
+	// The overlay now covers a new page.
+	patches->write<std::uint8_t>(0x10000, 0x33);
+	layers.set_coverage(top, memory_coverage(*patches));
+
+	std::uint8_t value;
+	layers.read(0x10000, value);
+	BOOST_CHECK_EQUAL(value, 0x33);
+
+	const auto result = layers.try_read_buffer(0x3ff0, buffer.data(), 0x20);
+	BOOST_CHECK(result.status == read_status::uninitialized);
+
+	::unlink(image_path.c_str());
+}
+
+BOOST_FIXTURE_TEST_CASE(layeredMemoryAdjacentChunks, TwoChunksFixture)
+{
+	using namespace reven::vmghost;
+
+	// [0x10000, 0x12000) then [0x12000, 0x13000) from file offset 0: one run of the layer, over two chunks.
+	auto chunks = std::make_shared<MemoryVirtualBox>(memory_);
+	chunks->insert(MemoryChunk(std::make_shared<core_file>(path_), 0x0, 0x1000, 0x12000, 0x1000));
+
+	layered_memory layers;
+	layers.add_layer(chunks, memory_coverage(*chunks));
+
+	std::uint8_t buffer[16];
+	layers.read_buffer(0x11ff8, buffer, sizeof(buffer));
+
+	for (std::size_t i = 0; i < sizeof(buffer); ++i) {
+		BOOST_CHECK_EQUAL(buffer[i], i < 8 ? expected(0x11ff8 + i) : file_byte(i - 8));
+	}
+}
+
+BOOST_FIXTURE_TEST_CASE(deltaCore, TwoChunksFixture)
+{
+	using namespace reven::vmghost;
+
+	std::shared_ptr<const physical_memory> base(&memory_, [](const physical_memory*) {});
+
+	// The next snapshot: one page changed, one page zeroed.
+	overlay_memory next(base);
+	next.write<std::uint32_t>(0x1010, 0xdeadbeef);
+	next.write_buffer(0x10000, std::vector<std::uint8_t>(0x1000, 0).data(), 0x1000);
+
+	vbox::DBGFCORECPU context;
+	std::memset(&context, 0, sizeof(context));
+	context.base.rip = 0x1234;
+	context.v6.msrTscAux = 0x3;
+	context.v6.ext.x87.MXCSR = 0x1f80;
+
+	vbox::DBGFCOREDESCRIPTOR descriptor{ vbox::DBGFCORE_MAGIC, vbox::DBGFCORE_FMT_VERSIONv6, 24, 0, 0, 1 };
+
+	const std::string delta_path = path_ + ".delta";
+
+	delta_core_writer writer(delta_path, memory_, path_);
+	writer.set_descriptor(descriptor);
+	writer.add_cpu(cpu_virtualbox(vbox::DBGFCORE_FMT_VERSIONv6, context));
+	writer.add_memory(next, memory_range{ 0x0, 0x4000 });
+	writer.add_memory(next, memory_range{ 0x10000, 0x12000 });
+	const auto stats = writer.finish();
+
+	BOOST_CHECK_EQUAL(stats.pages, 6);
+	BOOST_CHECK_EQUAL(stats.delta_pages, 1);
+	BOOST_CHECK_EQUAL(stats.zero_pages, 1);
+	BOOST_CHECK_EQUAL(stats.base_pages, 4);
+
+	delta_core delta(delta_path, base);
+
+	BOOST_CHECK_EQUAL(delta.base_path(), path_);
+	BOOST_CHECK_EQUAL(delta.descriptor().cCpus, 1);
+	BOOST_REQUIRE(delta.cpu_begin() != delta.cpu_end());
+	BOOST_CHECK_EQUAL(delta.cpu_begin()->rip(), 0x1234);
+	BOOST_CHECK_EQUAL(delta.cpu_begin()->msrTscAux(), 0x3);
+	BOOST_CHECK_EQUAL(delta.cpu_begin()->mxcsr(), 0x1f80);
+
+	// Base, delta, base, zero and base runs.
+	BOOST_CHECK_EQUAL(delta.physical_memory()->runs().size(), 5);
+
+	std::vector<std::uint8_t> expected_data(0x13000), data(0x13000, 0xff);
+	// read_buffer on the core memory zero-fills reads crossing chunks.
+	next.try_read_buffer(0x0, expected_data.data(), expected_data.size());
+	delta.physical_memory()->read_buffer(0x0, data.data(), data.size());
+	BOOST_CHECK(data == expected_data);
+
+	// Holes, zero runs and the uninitialized tail of the base chunk keep their status.
+	auto status = [&](std::uint64_t address, std::size_t size) {
+		return delta.physical_memory()->try_read_buffer(address, data.data(), size).status;
+	};
+
+	BOOST_CHECK(status(0x0, 0x3000) == read_status::backed);
+	BOOST_CHECK(status(0x10000, 0x1000) == read_status::backed);
+	BOOST_CHECK(status(0x3000, 0x1000) == read_status::uninitialized);
+	BOOST_CHECK(status(0x4000, 0x1000) == read_status::hole);
+	BOOST_CHECK(status(0x2ff0, 0x20) == read_status::partially_backed);
+	BOOST_CHECK(status(0xfff0, 0x20) == read_status::partially_backed);
+	BOOST_CHECK(status(0x0, 0x13000) == read_status::partially_backed);
+	BOOST_CHECK(data == expected_data);
+
+	BOOST_CHECK_THROW(delta_core(path_, base), std::runtime_error);
+
+	// Corrupted tables. The CPU count is at offset 48 of the header, the run table offset at 96.
+	auto corrupt = [&](std::uint64_t offset, const void* data, std::size_t size) {
+		std::fstream file(delta_path, std::ios::binary | std::ios::in | std::ios::out);
+		file.seekp(static_cast<std::streamoff>(offset));
+		file.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+	};
+
+	std::uint64_t run_offset = 0;
+	std::ifstream(delta_path, std::ios::binary).seekg(96).read(reinterpret_cast<char*>(&run_offset), 8);
+
+	auto runs = delta.physical_memory()->runs();
+	std::swap(runs[0], runs[1]);
+	corrupt(run_offset, runs.data(), 2 * sizeof(delta_page_run));
+	BOOST_CHECK_THROW(delta_core(delta_path, base), std::runtime_error);
+
+	const std::uint64_t cpu_count = 1ull << 40;
+	corrupt(48, &cpu_count, sizeof(cpu_count));
+	BOOST_CHECK_THROW(delta_core(delta_path, base), std::runtime_error);
+
+	// CPUs must have the version of the descriptor.
+	delta_core_writer mismatched(delta_path, memory_, path_);
+	mismatched.set_descriptor(descriptor);
+	BOOST_CHECK_THROW(mismatched.add_cpu(cpu_virtualbox(vbox::DBGFCORE_FMT_VERSIONv5, context)), std::runtime_error);
+
+	::unlink(delta_path.c_str());
+}
+
+BOOST_FIXTURE_TEST_CASE(pageStore, TwoChunksFixture)
+{
+	using namespace reven::vmghost;
+
+	char directory[] = "/tmp/rvncorevirtualbox_storeXXXXXX";
+	BOOST_REQUIRE(::mkdtemp(directory) != nullptr);
+
+	std::shared_ptr<const physical_memory> base(&memory_, [](const physical_memory*) {});
+
+	// The next snapshot: one page changed, one page zeroed.
+	overlay_memory next(base);
+	next.write<std::uint32_t>(0x1010, 0xdeadbeef);
+	next.write_buffer(0x10000, std::vector<std::uint8_t>(0x1000, 0).data(), 0x1000);
+
+	vbox::DBGFCORECPU context;
+	std::memset(&context, 0, sizeof(context));
+	context.base.rip = 0x1234;
+	context.v6.ext.x87.MXCSR = 0x1f80;
+
+	const cpu_virtualbox cpu(vbox::DBGFCORE_FMT_VERSIONv6, context);
+	const vbox::DBGFCOREDESCRIPTOR descriptor{ vbox::DBGFCORE_MAGIC, vbox::DBGFCORE_FMT_VERSIONv6, 24, 0, 0, 1 };
+	const std::vector<memory_range> ranges{ { 0x0, 0x4000 }, { 0x10000, 0x12000 } };
+
+	{
+		page_store store(directory);
+
+		// The uninitialized page at 0x3000 reads as zeros.
+		auto stats = store.ingest("base", descriptor, &cpu, 1, memory_, ranges, 2);
+		BOOST_CHECK_EQUAL(stats.pages, 6);
+		BOOST_CHECK_EQUAL(stats.zero_pages, 1);
+		BOOST_CHECK_EQUAL(stats.new_pages, 5);
+
+		stats = store.ingest("next", descriptor, &cpu, 1, next, ranges, 2);
+		BOOST_CHECK_EQUAL(stats.zero_pages, 2);
+		BOOST_CHECK_EQUAL(stats.new_pages, 1);
+		BOOST_CHECK_EQUAL(stats.shared_pages, 3);
+		BOOST_CHECK_EQUAL(store.page_count(), 6);
+	}
+
+	page_store store(directory);
+	BOOST_CHECK_EQUAL(store.page_count(), 6);
+
+	std::vector<std::uint8_t> page(0x1000);
+	memory_.read_buffer(0x10000, page.data(), page.size());
+
+	page_id id;
+	BOOST_CHECK(store.find_page(page.data(), id));
+	page[0] ^= 1;
+	BOOST_CHECK(not store.find_page(page.data(), id));
+
+	// Pages already stored are shared with the new cores.
+	const auto stats = store.ingest("again", descriptor, &cpu, 1, next, ranges, 1);
+	BOOST_CHECK_EQUAL(stats.new_pages, 0);
+
+	const std::pair<const char*, const physical_memory*> cores[] = { { "base", &memory_ }, { "next", &next } };
+
+	for (auto const& core : cores) {
+		const stored_core stored = store.open(core.first);
+
+		BOOST_CHECK_EQUAL(stored.descriptor().cCpus, 1);
+		BOOST_REQUIRE(stored.cpu_begin() != stored.cpu_end());
+		BOOST_CHECK_EQUAL(stored.cpu_begin()->rip(), 0x1234);
+		BOOST_CHECK_EQUAL(stored.cpu_begin()->mxcsr(), 0x1f80);
+
+		std::vector<std::uint8_t> expected_data(0x13000), data(0x13000, 0xff);
+		core.second->try_read_buffer(0x0, expected_data.data(), expected_data.size());
+		stored.physical_memory()->read_buffer(0x0, data.data(), data.size());
+		BOOST_CHECK(data == expected_data);
+
+		// Zero pages are backed, the addresses outside of the regions are holes.
+		auto status = [&](std::uint64_t address, std::size_t size) {
+			return stored.physical_memory()->try_read_buffer(address, data.data(), size).status;
+		};
+
+		BOOST_CHECK(status(0x0, 0x4000) == read_status::backed);
+		BOOST_CHECK(status(0x10000, 0x2000) == read_status::backed);
+		BOOST_CHECK(status(0x4000, 0x1000) == read_status::hole);
+		BOOST_CHECK(status(0x3ff0, 0x20) == read_status::partially_backed);
+		BOOST_CHECK(status(0x0, 0x13000) == read_status::partially_backed);
+		BOOST_CHECK(data == expected_data);
+	}
+
+	BOOST_CHECK_THROW(store.open("missing"), std::runtime_error);
+	BOOST_CHECK_THROW(store.open("../base"), std::runtime_error);
+
+	const std::string root = directory;
+
+	// A read-only store reads the cores, and writes nothing.
+	{
+		page_store reader(directory, true);
+		BOOST_CHECK(reader.read_only());
+		BOOST_CHECK_EQUAL(reader.page_count(), 6);
+		page[0] ^= 1;
+		BOOST_CHECK(reader.find_page(page.data(), id));
+
+		std::vector<std::uint8_t> expected_data(0x13000), data(0x13000, 0xff);
+		memory_.try_read_buffer(0x0, expected_data.data(), expected_data.size());
+		reader.open("base").physical_memory()->read_buffer(0x0, data.data(), data.size());
+		BOOST_CHECK(data == expected_data);
+
+		BOOST_CHECK_THROW(reader.ingest("other", descriptor, &cpu, 1, memory_, ranges, 1), std::runtime_error);
+		BOOST_CHECK_THROW(reader.flush(), std::runtime_error);
+	}
+
+	// Corrupted tables. The CPU count is at offset 40 of the header, the CPU record size at 48, the regions follow
+	//   the 72-byte header and the CPU records.
+	{
+		const std::string core_file_path = root + "/cores/base.core";
+
+		auto corrupt = [&](std::uint64_t offset, const void* data, std::size_t size) {
+			std::fstream file(core_file_path, std::ios::binary | std::ios::in | std::ios::out);
+			file.seekp(static_cast<std::streamoff>(offset));
+			file.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+		};
+
+		std::uint64_t cpu_record_size = 0;
+		std::ifstream(core_file_path, std::ios::binary).seekg(48).read(reinterpret_cast<char*>(&cpu_record_size), 8);
+
+		auto regions = store.open("base").physical_memory()->regions();
+		BOOST_REQUIRE_EQUAL(regions.size(), 2);
+		std::swap(regions[0], regions[1]);
+		corrupt(72 + cpu_record_size, regions.data(), 2 * sizeof(stored_memory::region));
+		BOOST_CHECK_THROW(store.open("base"), std::runtime_error);
+
+		std::swap(regions[0], regions[1]);
+		regions[1].first_index = ~0ull;
+		corrupt(72 + cpu_record_size, regions.data(), 2 * sizeof(stored_memory::region));
+		BOOST_CHECK_THROW(store.open("base"), std::runtime_error);
+
+		const std::uint64_t cpu_count = 1ull << 40;
+		corrupt(40, &cpu_count, sizeof(cpu_count));
+		BOOST_CHECK_THROW(store.open("base"), std::runtime_error);
+	}
+
+	struct stat st;
+	BOOST_CHECK_THROW(page_store(root + "/missing", true), std::runtime_error);
+	BOOST_CHECK(::stat((root + "/missing").c_str(), &st) != 0);
+	BOOST_CHECK(::stat((root + "/cores/other.core").c_str(), &st) != 0);
+
+	for (auto name : { "/cores/base.core", "/cores/next.core", "/cores/again.core", "/pages.pack", "/pages.index" }) {
+		::unlink((root + name).c_str());
+	}
+
+	::rmdir((root + "/cores").c_str());
+	::rmdir(directory);
+}
+
+BOOST_FIXTURE_TEST_CASE(coreWriter, TwoChunksFixture)
+{
+	using namespace reven::vmghost;
+
+	std::shared_ptr<const physical_memory> base(&memory_, [](const physical_memory*) {});
+
+	overlay_memory patched(base);
+	patched.write<std::uint32_t>(0x20010, 0xdeadbeef);
+
+	vbox::DBGFCORECPU context;
+	std::memset(&context, 0, sizeof(context));
+	context.base.rip = 0x1234;
+	context.v6.msrTscAux = 0x3;
+	context.v6.ext.x87.MXCSR = 0x1f80;
+
+	cpu_virtualbox cpu(vbox::DBGFCORE_FMT_VERSIONv6, context);
+	cpu.set_tetrane_context(tetrane_cpu_info{ 0x8 });
+
+	const std::string core_path = path_ + ".core";
+	const std::string copy_path = path_ + ".copy.core";
+
+	core_writer writer(core_path);
+	writer.add_cpu(cpu);
+	writer.add_cpu(cpu);
+	// The bytes at 0x20000 are read from the overlay; the chunks are copied, uninitialized tail included.
+	writer.add_memory(patched, memory_range{ 0x20000, 0x20020 });
+	writer.add_memory(memory_, memory_range{ 0x0, UINT64_MAX });
+	writer.finish();
+
+	core_virtualbox core;
+	core.parse(core_path);
+
+	BOOST_CHECK_EQUAL(core.magic(), vbox::DBGFCORE_MAGIC);
+	BOOST_CHECK_EQUAL(core.format_version(), vbox::DBGFCORE_FMT_VERSIONv6);
+	BOOST_CHECK_EQUAL(core.cpu_count(), 2);
+	BOOST_CHECK_EQUAL(core.physical_memory()->chunks_count(), 3);
+
+	for (auto it = core.cpu_begin(); it != core.cpu_end(); ++it) {
+		BOOST_CHECK_EQUAL(it->rip(), 0x1234);
+		BOOST_CHECK_EQUAL(it->msrTscAux(), 0x3);
+		BOOST_CHECK_EQUAL(it->mxcsr(), 0x1f80);
+		BOOST_CHECK_EQUAL(it->tetrane_context().cr8, 0x8);
+	}
+
+	std::vector<std::uint8_t> expected_data(0x22000), data(0x22000, 0xff);
+	patched.try_read_buffer(0x0, expected_data.data(), expected_data.size());
+	core.physical_memory()->try_read_buffer(0x0, data.data(), data.size());
+	BOOST_CHECK(data == expected_data);
+
+	BOOST_CHECK(core.physical_memory()->try_read_buffer(0x3000, data.data(), 0x1000).status ==
+	            read_status::uninitialized);
+
+	// The segments are in the order they were added, the chunks from the lowest address, at page-aligned offsets.
+	{
+		core_file file(core_path);
+
+		Elf64_Ehdr header;
+		file.read(0, &header, sizeof(header));
+
+		std::vector<Elf64_Phdr> segments(header.e_phnum);
+		file.read(header.e_phoff, segments.data(), segments.size() * sizeof(Elf64_Phdr));
+
+		std::vector<std::uint64_t> addresses;
+
+		for (auto const& segment : segments) {
+			if (segment.p_type == PT_LOAD) {
+				BOOST_CHECK_EQUAL(segment.p_offset % 0x1000, 0);
+				addresses.push_back(segment.p_paddr);
+			}
+		}
+
+		const std::vector<std::uint64_t> reference = { 0x20000, 0x0, 0x10000 };
+		BOOST_CHECK_EQUAL_COLLECTIONS(addresses.begin(), addresses.end(), reference.begin(), reference.end());
+	}
+
+	// A copy of a parsed core is the same core.
+	write_core(core, copy_path);
+
+	core_virtualbox copy;
+	copy.parse(copy_path);
+
+	BOOST_CHECK_EQUAL(copy.cpu_count(), 2);
+	BOOST_CHECK_EQUAL(copy.cpu_begin()->tetrane_context().cr8, 0x8);
+	BOOST_CHECK_EQUAL(copy.physical_memory()->chunks_count(), 3);
+
+	copy.physical_memory()->try_read_buffer(0x0, data.data(), data.size());
+	BOOST_CHECK(data == expected_data);
+
+	::unlink(core_path.c_str());
+	::unlink(copy_path.c_str());
+}
+
+BOOST_FIXTURE_TEST_CASE(memoryStats, TwoChunksFixture)
+{
+	using namespace reven::vmghost;
+
+	BOOST_CHECK_EQUAL(memory_stats::size_class(1), 0);
+	BOOST_CHECK_EQUAL(memory_stats::size_class(8), 1);
+	BOOST_CHECK_EQUAL(memory_stats::size_class(4096), 3);
+	BOOST_CHECK_EQUAL(memory_stats::size_class(1 << 20), 5);
+	BOOST_CHECK_EQUAL(memory_stats::latency_bucket(0), 0);
+	BOOST_CHECK_EQUAL(memory_stats::latency_bucket(1000), 9);
+	BOOST_CHECK_EQUAL(memory_stats::latency_bucket(UINT64_MAX), memory_stats::latency_buckets - 1);
+
+	std::vector<std::uint8_t> buffer(0x2000);
+
+	memory_.read_buffer(0x100, buffer.data(), 8);
+	memory_.read_buffer(0x200, buffer.data(), 8);
+	memory_.read_buffer(0x8000, buffer.data(), 16);
+	// The uninitialized tail of the first chunk, then a hole.
+	memory_.try_read_buffer(0x3000, buffer.data(), 0x2000);
+
+	auto stats = memory_.stats();
+
+	if (not memory_stats_enabled()) {
+		BOOST_CHECK_EQUAL(stats.total_reads(), 0);
+		BOOST_CHECK_EQUAL(stats.chunk_lookups, 0);
+		return;
+	}
+
+	BOOST_CHECK_EQUAL(stats.total_reads(), 4);
+	BOOST_CHECK_EQUAL(stats.reads[1], 2);
+	BOOST_CHECK_EQUAL(stats.reads[2], 1);
+	BOOST_CHECK_EQUAL(stats.reads[4], 1);
+	BOOST_CHECK_EQUAL(stats.total_read_bytes(), 32 + 0x2000);
+
+	BOOST_CHECK_EQUAL(stats.chunk_lookups, 5);
+
+	BOOST_CHECK_EQUAL(stats.hole_reads, 2);
+	BOOST_CHECK_EQUAL(stats.zero_filled_bytes, 16 + 0x2000);
+	BOOST_CHECK_EQUAL(stats.cross_chunk_reads, 1);
+
+	std::uint64_t latencies = 0;
+	for (auto count : stats.latency_ns) {
+		latencies += count;
+	}
+	BOOST_CHECK_EQUAL(latencies, 4);
+
+	// Each thread counts on its own, and the totals add them up.
+	memory_.reset_stats();
+
+	std::vector<std::thread> threads;
+
+	for (int i = 0; i < 4; ++i) {
+		threads.emplace_back([this]() {
+			std::uint64_t value;
+
+			for (int j = 0; j < 1000; ++j) {
+				memory_.read_buffer(0x10000 + j * 8, &value, sizeof(value));
+			}
+		});
+	}
+
+	for (auto& thread : threads) {
+		thread.join();
+	}
+
+	stats = memory_.stats();
+	BOOST_CHECK_EQUAL(stats.reads[1], 4000);
+	BOOST_CHECK_EQUAL(stats.chunk_lookups, 4000);
+
+	// A copy counts its reads apart from the memory it was copied from.
+	MemoryVirtualBox copy(memory_);
+	BOOST_CHECK_EQUAL(copy.stats().total_reads(), 0);
+
+	copy.read_buffer(0x100, buffer.data(), 8);
+	BOOST_CHECK_EQUAL(copy.stats().total_reads(), 1);
+	BOOST_CHECK_EQUAL(memory_.stats().total_reads(), 4000);
+}
+
+BOOST_FIXTURE_TEST_CASE(accessTrace, TwoChunksFixture)
+{
+	using namespace reven::vmghost;
+
+	const std::string trace_path = path_ + ".trace";
+	std::shared_ptr<const physical_memory> core(&memory_, [](const physical_memory*) {});
+
+	{
+		access_trace_options options;
+		options.buffer_records = 3;
+		traced_memory traced(core, trace_path, options);
+
+		std::uint64_t value = 0;
+		traced.read_buffer(0x10, &value, sizeof(value));
+		BOOST_CHECK_EQUAL(value & 0xff, expected(0x10));
+		traced.read<std::uint16_t>(0x10000, value);
+		traced.try_read_buffer(0x8000, &value, sizeof(value));
+		traced.read_async(0x11000, &value, sizeof(value)).get();
+
+		std::thread([&traced]() {
+			std::uint8_t buffer[0x100];
+			traced.read_buffer(0x2000, buffer, sizeof(buffer));
+		}).join();
+
+		traced.flush();
+		BOOST_CHECK_EQUAL(traced.recorded(), 6);
+		BOOST_CHECK_EQUAL(traced.dropped(), 0);
+	}
+
+	auto records = read_access_trace(trace_path);
+	BOOST_REQUIRE_EQUAL(records.size(), 6);
+
+	const access_kind kinds[] = { access_kind::read_buffer, access_kind::read, access_kind::read,
+		                          access_kind::try_read_buffer, access_kind::read_async, access_kind::read_buffer };
+	const std::uint64_t addresses[] = { 0x10, 0x10000, 0x10001, 0x8000, 0x11000, 0x2000 };
+
+	for (std::size_t i = 0; i < records.size(); ++i) {
+		BOOST_CHECK(records[i].kind == kinds[i]);
+		BOOST_CHECK_EQUAL(records[i].physical_address, addresses[i]);
+		BOOST_CHECK_EQUAL(records[i].thread, i < 5 ? 0 : 1);
+		BOOST_CHECK(i == 0 or records[i].thread != records[i - 1].thread or
+		            records[i].timestamp_ns >= records[i - 1].timestamp_ns);
+	}
+
+	replay_options options;
+	options.rounds = 3;
+	auto result = replay_access_trace(memory_, records, options);
+	BOOST_CHECK_EQUAL(result.reads, 6);
+	BOOST_CHECK_EQUAL(result.bytes, 8 + 1 + 1 + 8 + 8 + 0x100);
+	BOOST_CHECK_EQUAL(result.errors, 0);
+	BOOST_CHECK_LE(result.latency_p50_ns, result.latency_max_ns);
+
+	std::uint64_t latencies = 0;
+	for (auto count : result.latency_ns) {
+		latencies += count;
+	}
+	BOOST_CHECK_EQUAL(latencies, 18);
+
+	// One read out of two, at most 2 records.
+	{
+		access_trace_options sampled;
+		sampled.sample_period = 2;
+		sampled.max_records = 2;
+		traced_memory traced(core, trace_path, sampled);
+
+		for (std::uint64_t address = 0; address < 10; ++address) {
+			std::uint8_t byte;
+			traced.read(address, byte);
+		}
+
+		traced.flush();
+		BOOST_CHECK_EQUAL(traced.recorded(), 2);
+		BOOST_CHECK_EQUAL(traced.dropped(), 3);
+	}
+
+	records = read_access_trace(trace_path);
+	BOOST_REQUIRE_EQUAL(records.size(), 2);
+	BOOST_CHECK_EQUAL(records[0].physical_address, 0);
+	BOOST_CHECK_EQUAL(records[1].physical_address, 2);
+
+	std::ofstream(trace_path, std::ios::binary) << "not a trace at all";
+	BOOST_CHECK_THROW(read_access_trace(trace_path), std::runtime_error);
+
+	::unlink(trace_path.c_str());
+}
+
+BOOST_FIXTURE_TEST_CASE(rawImageExport, TwoChunksFixture)
+{
+	using namespace reven::vmghost;
+
+	const std::string image_path = path_ + ".raw";
+
+	auto stats = write_raw_image(memory_, image_path);
+	BOOST_CHECK_EQUAL(stats.image_size, 0x12000);
+	BOOST_CHECK_EQUAL(stats.copied_bytes, 0x5000);
+	BOOST_CHECK_EQUAL(stats.zero_pages, 0);
+
+	{
+		raw_image_memory image(image_path);
+		BOOST_REQUIRE_EQUAL(image.size(), 0x12000);
+
+		std::vector<std::uint8_t> buffer(0x12000);
+		image.read_buffer(0, buffer.data(), buffer.size());
+
+		for (std::uint64_t address = 0; address < buffer.size(); ++address) {
+			const bool backed = address < 0x3000 or address >= 0x10000;
+			BOOST_REQUIRE_EQUAL(buffer[address], backed ? expected(address) : 0);
+		}
+	}
+
+	// A chunk with an all-zero page, at an address that is not page aligned in the core file.
+	const std::string core_path = path_ + ".zeros";
+	std::vector<std::uint8_t> content(0x3100, 0);
+	std::fill(content.begin(), content.begin() + 0x1100, 0xaa);
+	std::fill(content.begin() + 0x2100, content.end(), 0xbb);
+	std::ofstream(core_path, std::ios::binary).write(reinterpret_cast<const char*>(content.data()), content.size());
+
+	MemoryVirtualBox zeros;
+	zeros.insert(MemoryChunk(std::make_shared<core_file>(core_path), 0x100, 0x3000, 0x5000, 0x4000));
+
+	stats = write_raw_image(zeros, image_path);
+	BOOST_CHECK_EQUAL(stats.image_size, 0x9000);
+	BOOST_CHECK_EQUAL(stats.copied_bytes, 0x2000);
+	BOOST_CHECK_EQUAL(stats.zero_pages, 1);
+
+	raw_image_memory image(image_path);
+	std::vector<std::uint8_t> buffer(0x9000);
+	image.read_buffer(0, buffer.data(), buffer.size());
+
+	for (std::uint64_t address = 0; address < buffer.size(); ++address) {
+		std::uint8_t value = 0;
+
+		if (address >= 0x5000 and address < 0x6000) {
+			value = 0xaa;
+		} else if (address >= 0x7000 and address < 0x8000) {
+			value = 0xbb;
+		}
+
+		BOOST_REQUIRE_EQUAL(buffer[address], value);
+	}
+
+	::unlink(core_path.c_str());
+	::unlink(image_path.c_str());
+}
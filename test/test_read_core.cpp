@@ -1,4 +1,5 @@
 #include <core_virtualbox.h>
+#include <register_export.h>
 
 #include <iostream>
 
@@ -68,6 +69,26 @@ BOOST_AUTO_TEST_CASE(ReadBaseV5)
 	}
 }
 
+BOOST_AUTO_TEST_CASE(ExportRegisters)
+{
+	using reven::vmghost::register_id;
+
+	int80_core first;
+	int80_core second;
+
+	auto columns = reven::vmghost::export_registers({ &first, &second }, { register_id::rip, register_id::cr3 }, 2);
+
+	BOOST_CHECK_EQUAL(columns.rows(), 2);
+	BOOST_CHECK_EQUAL(columns.core_rows[1], 1);
+
+	for (std::size_t row = 0; row < columns.rows(); ++row) {
+		BOOST_CHECK_EQUAL(columns.column(0)[row], 0xb7fdbe20);
+		BOOST_CHECK_EQUAL(columns.at(row, 1), first.cpu_begin()->cr3());
+	}
+
+	BOOST_CHECK_THROW(reven::vmghost::export_registers(first, { register_id::msr_tsc_aux }), std::runtime_error);
+}
+
 BOOST_AUTO_TEST_CASE(ReadNonExistingCore)
 {
 	reven::vmghost::core_virtualbox core;
@@ -0,0 +1,425 @@
+#include <core_file.h>
+#include <core_virtualbox.h>
+#include <descriptor_table.h>
+#include <guest_strings.h>
+#include <pointer_chase.h>
+#include <synthetic_core.h>
+#include <virtual_memory.h>
+
+#include <unistd.h>
+
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#define BOOST_TEST_MODULE virtual_memory
+#include <boost/test/unit_test.hpp>
+
+using namespace reven::vmghost;
+
+namespace {
+
+//! Physical memory backed by a buffer.
+class ram_memory : public physical_memory {
+public:
+	explicit ram_memory(std::size_t size) : data_(size, 0) {}
+
+	void write(std::uint64_t address, const void* data, std::size_t size)
+	{
+		std::memcpy(data_.data() + address, data, size);
+	}
+
+	void write_qword(std::uint64_t address, std::uint64_t value) { write(address, &value, sizeof(value)); }
+
+	std::vector<std::uint8_t> const& data() const { return data_; }
+
+private:
+	bool do_read(std::uint64_t physical_address, std::uint8_t& data) const final
+	{
+		if (physical_address >= data_.size()) {
+			return false;
+		}
+
+		data = data_[physical_address];
+		return true;
+	}
+
+	void do_read_buffer(std::uint64_t physical_address, void* buffer, std::size_t size) const final
+	{
+		if (physical_address + size > data_.size()) {
+			std::memset(buffer, 0, size);
+			return;
+		}
+
+		std::memcpy(buffer, data_.data() + physical_address, size);
+	}
+
+	std::vector<std::uint8_t> data_;
+};
+
+//!
+//! IA-32e page tables at 0x1000 (PML4), 0x2000 (PDPT), 0x3000 (PD) and 0x4000 (PT), mapping:
+//!  - 0x400000 to 0x8000, 0x401000 to 0x9000 and 0x402000 to 0x6000,
+//!  - the 2 MiB page 0x600000 to 0x200000.
+//!
+struct PageTablesFixture {
+	PageTablesFixture() : memory(0x400000)
+	{
+		memory.write_qword(0x1000, 0x2003);
+		memory.write_qword(0x2000, 0x3003);
+		memory.write_qword(0x3000 + 2 * 8, 0x4003);
+		memory.write_qword(0x3000 + 3 * 8, 0x200083);
+		memory.write_qword(0x4000, 0x8003);
+		memory.write_qword(0x4000 + 8, 0x9003);
+		memory.write_qword(0x4000 + 2 * 8, 0x6003);
+
+		for (std::uint64_t address = 0x6000; address < 0xa000; address += 8) {
+			memory.write_qword(address, address);
+		}
+	}
+
+	ram_memory memory;
+};
+
+//!
+//! The first 0x10000 bytes of a @c ram_memory, in a core file whose chunks meet at 0x9000: virtual 0x400000-0x402000
+//!   maps across them.
+//!
+struct chunked_copy {
+	explicit chunked_copy(ram_memory const& memory)
+	{
+		char name[] = "/tmp/rvncorevirtualbox_testXXXXXX";
+		const int fd = ::mkstemp(name);
+		BOOST_REQUIRE(fd >= 0);
+		::close(fd);
+		path = name;
+
+		std::ofstream(path, std::ios::binary).write(reinterpret_cast<const char*>(memory.data().data()), 0x10000);
+
+		auto file = std::make_shared<core_file>(path);
+		chunks.insert(MemoryChunk(file, 0x0, 0x9000, 0x0, 0x9000));
+		chunks.insert(MemoryChunk(file, 0x9000, 0x7000, 0x9000, 0x7000));
+	}
+
+	~chunked_copy() { ::unlink(path.c_str()); }
+
+	std::string path;
+	MemoryVirtualBox chunks;
+};
+
+} // anonymous namespace
+
+BOOST_FIXTURE_TEST_CASE(translate, PageTablesFixture)
+{
+	virtual_memory vm(memory, 0x1000, paging_mode::ia32e);
+
+	std::uint64_t physical_address, page_size;
+
+	BOOST_CHECK(vm.translate(0x401234, physical_address, page_size));
+	BOOST_CHECK_EQUAL(physical_address, 0x9234);
+	BOOST_CHECK_EQUAL(page_size, 0x1000);
+
+	BOOST_CHECK(vm.translate(0x6abcde, physical_address, page_size));
+	BOOST_CHECK_EQUAL(physical_address, 0x2abcde);
+	BOOST_CHECK_EQUAL(page_size, 0x200000);
+
+	BOOST_CHECK(not vm.translate(0x403000, physical_address));
+	BOOST_CHECK(not vm.translate(0x0000800000000000, physical_address));
+}
+
+BOOST_FIXTURE_TEST_CASE(readVirtualBuffer, PageTablesFixture)
+{
+	virtual_memory vm(memory, 0x1000, paging_mode::ia32e);
+
+	// Crosses the physically contiguous 0x8000-0xa000 run, then jumps to 0x6000.
+	std::vector<std::uint64_t> buffer(0x3000 / 8);
+	vm.read_buffer(0x400000, buffer.data(), 0x3000);
+
+	BOOST_CHECK_EQUAL(buffer[0], 0x8000);
+	BOOST_CHECK_EQUAL(buffer[0x1ff], 0x8ff8);
+	BOOST_CHECK_EQUAL(buffer[0x200], 0x9000);
+	BOOST_CHECK_EQUAL(buffer[0x400], 0x6000);
+
+	BOOST_CHECK_THROW(vm.read_buffer(0x402ff8, buffer.data(), 16), std::runtime_error);
+
+	buffer[1] = 1;
+	BOOST_CHECK_EQUAL(vm.try_read_buffer(0x402ff8, buffer.data(), 16), 8);
+	BOOST_CHECK_EQUAL(buffer[0], 0x6ff8);
+	BOOST_CHECK_EQUAL(buffer[1], 0);
+
+	BOOST_CHECK_EQUAL(vm.read<std::uint64_t>(0x401008), 0x9008);
+}
+
+BOOST_FIXTURE_TEST_CASE(readAdjacentChunks, PageTablesFixture)
+{
+	chunked_copy copy(memory);
+	virtual_memory vm(copy.chunks, 0x1000, paging_mode::ia32e);
+
+	std::uint64_t buffer[2] = {};
+	vm.read_buffer(0x400ff8, buffer, sizeof(buffer));
+	BOOST_CHECK_EQUAL(buffer[0], 0x8ff8);
+	BOOST_CHECK_EQUAL(buffer[1], 0x9000);
+
+	struct { std::uint32_t low; std::uint64_t middle; std::uint32_t high; } __attribute__((packed)) value;
+	value = vm.read<decltype(value)>(0x400ffc);
+	BOOST_CHECK_EQUAL(value.middle, 0x9000);
+}
+
+BOOST_FIXTURE_TEST_CASE(descriptorTables, PageTablesFixture)
+{
+	// GDT at 0x400000: null, 64-bit ring 0 code, flat data, 16-byte TSS at 0xfffff80000001000 with limit 0x67.
+	memory.write_qword(0x8000, 0);
+	memory.write_qword(0x8008, 0x00209b0000000000);
+	memory.write_qword(0x8010, 0x00cf93000000ffff);
+	memory.write_qword(0x8018, 0x00008b0010000067);
+	memory.write_qword(0x8020, 0x00000000fffff800);
+
+	// IDT at 0x401000: vector 1 is an IST 2 interrupt gate to 0x10:0xfffff80012345678.
+	memory.write_qword(0x9000, 0);
+	memory.write_qword(0x9008, 0);
+	memory.write_qword(0x9010, 0x12348e0200105678);
+	memory.write_qword(0x9018, 0x00000000fffff800);
+
+	vbox::DBGFCORECPU context;
+	std::memset(&context, 0, sizeof(context));
+	context.base.cr0 = 0x80000001;
+	context.base.cr3 = 0x1000;
+	context.base.cr4 = 0x20;
+	context.base.msrEFER = 0x500;
+	context.base.gdtr.uAddr = 0x400000;
+	context.base.gdtr.cb = 0x27;
+	context.base.idtr.uAddr = 0x401000;
+	context.base.idtr.cb = 0x1f;
+
+	cpu_virtualbox cpu(vbox::DBGFCORE_FMT_VERSIONv5, context);
+	virtual_memory vm(memory, cpu);
+	BOOST_CHECK(vm.mode() == paging_mode::ia32e);
+
+	const auto gdt = read_gdt(vm, cpu);
+	BOOST_REQUIRE_EQUAL(gdt.size(), 5);
+	BOOST_CHECK(gdt[0].kind == descriptor_kind::null);
+	BOOST_CHECK(gdt[1].kind == descriptor_kind::code);
+	BOOST_CHECK(gdt[1].flags & segment_descriptor::long_mode);
+	BOOST_CHECK(gdt[2].kind == descriptor_kind::data);
+	BOOST_CHECK_EQUAL(gdt[2].limit, 0xffffffffu);
+	BOOST_CHECK(gdt[3].kind == descriptor_kind::tss);
+	BOOST_CHECK_EQUAL(gdt[3].base, 0xfffff80000001000);
+	BOOST_CHECK_EQUAL(gdt[3].limit, 0x67);
+	BOOST_CHECK(gdt[4].kind == descriptor_kind::upper_half);
+
+	const auto idt = read_idt(vm, cpu);
+	BOOST_REQUIRE_EQUAL(idt.size(), 2);
+	BOOST_CHECK(idt[0].kind == descriptor_kind::null);
+	BOOST_CHECK(idt[1].kind == descriptor_kind::interrupt_gate);
+	BOOST_CHECK(idt[1].is_present());
+	BOOST_CHECK_EQUAL(idt[1].base, 0xfffff80012345678);
+	BOOST_CHECK_EQUAL(idt[1].selector, 0x10);
+	BOOST_CHECK_EQUAL(idt[1].ist, 2);
+
+	BOOST_CHECK(read_ldt(vm, cpu).empty());
+}
+
+BOOST_FIXTURE_TEST_CASE(chasePointers, PageTablesFixture)
+{
+	// A circular list of 0x20-byte records { id, link, payload, payload }, whose links point to the next link.
+	// The second record straddles the 0x401000 and 0x402000 pages, which are not physically contiguous.
+	memory.write_qword(0x8100, 1);
+	memory.write_qword(0x8108, 0x401ff8);
+	memory.write_qword(0x9ff0, 2);
+	memory.write_qword(0x9ff8, 0x600048);
+	memory.write_qword(0x6000, 0xbbbb);
+	memory.write_qword(0x200040, 3);
+	memory.write_qword(0x200048, 0x400108);
+
+	virtual_memory vm(memory, 0x1000, paging_mode::ia32e);
+
+	pointer_chase_options options;
+	options.record_size = 0x20;
+	options.next_offset = 8;
+	options.intrusive_links = true;
+
+	auto result = chase_pointers(vm, 0x400108, options);
+
+	BOOST_REQUIRE_EQUAL(result.size(), 3);
+	BOOST_CHECK(result.stop == pointer_chase_stop::loop);
+	BOOST_CHECK_EQUAL(result.addresses[1], 0x401ff0);
+	BOOST_CHECK_EQUAL(result.addresses[2], 0x600040);
+
+	for (std::size_t i = 0; i < result.size(); ++i) {
+		std::uint64_t id;
+		std::memcpy(&id, result.record(i), sizeof(id));
+		BOOST_CHECK_EQUAL(id, i + 1);
+	}
+
+	std::uint64_t payload;
+	std::memcpy(&payload, result.record(1) + 0x10, sizeof(payload));
+	BOOST_CHECK_EQUAL(payload, 0xbbbb);
+
+	// Walks sharing one queue.
+	read_queue queue(memory, options.queue);
+
+	for (std::uint64_t start : {0x400108, 0x401ff8, 0x600048}) {
+		result = chase_pointers(vm, queue, start, options);
+		BOOST_CHECK_EQUAL(result.size(), 3);
+		BOOST_CHECK(result.stop == pointer_chase_stop::loop);
+	}
+
+	std::memcpy(&payload, chase_pointers(vm, queue, 0x401ff8, options).record(0) + 0x10, sizeof(payload));
+	BOOST_CHECK_EQUAL(payload, 0xbbbb);
+
+	options.limit = 2;
+	BOOST_CHECK(chase_pointers(vm, 0x400108, options).stop == pointer_chase_stop::limit);
+
+	memory.write_qword(0x200048, 0x403008);
+	options.limit = 10;
+	result = chase_pointers(vm, 0x400108, options);
+	BOOST_CHECK_EQUAL(result.size(), 3);
+	BOOST_CHECK(result.stop == pointer_chase_stop::unmapped);
+
+	// The stop address is a link, like the LIST_ENTRY of a list head.
+	options.stop_address = 0x401ff8;
+	result = chase_pointers(vm, 0x400108, options);
+	BOOST_CHECK_EQUAL(result.size(), 1);
+	BOOST_CHECK(result.stop == pointer_chase_stop::loop);
+}
+
+BOOST_FIXTURE_TEST_CASE(chasePointersAcrossChunks, PageTablesFixture)
+{
+	// A record { id, payload, payload, next } at 0x400ff0, whose next pointer is in the second chunk, then a last
+	//   record at 0x400100.
+	memory.write_qword(0x8ff0, 7);
+	memory.write_qword(0x9008, 0x400100);
+	memory.write_qword(0x8100, 1);
+	memory.write_qword(0x8118, 0);
+
+	chunked_copy copy(memory);
+	virtual_memory vm(copy.chunks, 0x1000, paging_mode::ia32e);
+
+	pointer_chase_options options;
+	options.record_size = 0x20;
+	options.next_offset = 0x18;
+
+	const auto result = chase_pointers(vm, 0x400ff0, options);
+
+	BOOST_REQUIRE_EQUAL(result.size(), 2);
+	BOOST_CHECK(result.stop == pointer_chase_stop::null_pointer);
+	BOOST_CHECK_EQUAL(result.addresses[1], 0x400100);
+
+	std::uint64_t fields[4];
+	std::memcpy(fields, result.record(0), sizeof(fields));
+	BOOST_CHECK_EQUAL(fields[0], 7);
+	BOOST_CHECK_EQUAL(fields[2], 0x9000);
+	BOOST_CHECK_EQUAL(fields[3], 0x400100);
+}
+
+BOOST_FIXTURE_TEST_CASE(readStrings, PageTablesFixture)
+{
+	virtual_memory vm(memory, 0x1000, paging_mode::ia32e);
+
+	// The strings cross from 0x401000 (at 0x9000) to 0x402000 (at 0x6000).
+	memory.write(0x9ffc, "abcd", 4);
+	memory.write(0x6000, "ef", 3);
+
+	BOOST_CHECK_EQUAL(read_string(vm, 0x401ffc), "abcdef");
+	BOOST_CHECK_EQUAL(read_string(vm, 0x401ffc, 3), "abc");
+
+	memory.write(0x9ffc, u"xy", 4);
+	memory.write(0x6000, u"z", 4);
+
+	BOOST_CHECK(read_utf16_string(vm, 0x401ffc) == u"xyz");
+
+	// Stops at the unmapped page 0x403000.
+	memory.write(0x6ff8, "qqqqqqqq", 8);
+	BOOST_CHECK_EQUAL(read_string(vm, 0x402ff8), "qqqqqqqq");
+}
+
+BOOST_AUTO_TEST_CASE(syntheticCore)
+{
+	synthetic_core_options options;
+	options.memory_size = 8 << 20;
+	options.segment_count = 3;
+	options.cpu_count = 2;
+	options.version = vbox::DBGFCORE_FMT_VERSIONv5;
+	// More virtual pages than data pages: the mapping wraps around.
+	options.mapped_size = 32 << 20;
+	options.seed = 7;
+
+	const synthetic_memory memory(options);
+
+	BOOST_REQUIRE_EQUAL(memory.segments().size(), 3);
+	BOOST_CHECK_EQUAL(memory.segments()[0].begin, 0);
+	BOOST_CHECK_EQUAL(memory.segments()[1].begin, memory.segments()[0].end + (1 << 20));
+
+	std::uint8_t byte;
+	BOOST_CHECK(memory.try_read_buffer(memory.segments()[0].end, &byte, 1).status == read_status::hole);
+
+	const cpu_virtualbox cpu = synthetic_cpu(memory, 1);
+	BOOST_CHECK(get_paging_mode(cpu) == paging_mode::ia32e);
+
+	const virtual_memory vm(memory, cpu);
+
+	for (std::uint64_t offset : { 0x0ull, 0x1234ull, 0x7ff008ull, 0x1fffff8ull }) {
+		std::uint64_t physical_address;
+		BOOST_REQUIRE(vm.translate(options.virtual_base + offset, physical_address));
+		BOOST_CHECK_EQUAL(physical_address, memory.translate(options.virtual_base + offset));
+	}
+
+	std::uint64_t physical_address;
+	BOOST_CHECK(not vm.translate(options.virtual_base + options.mapped_size, physical_address));
+	BOOST_CHECK(vm.translate(cpu.rip(), physical_address));
+
+	char path[] = "/tmp/rvncorevirtualbox_syntheticXXXXXX";
+	int fd = ::mkstemp(path);
+	BOOST_REQUIRE(fd >= 0);
+	::close(fd);
+
+	write_synthetic_core(path, options);
+
+	core_virtualbox core;
+	core.parse(path);
+
+	BOOST_CHECK_EQUAL(core.format_version(), vbox::DBGFCORE_FMT_VERSIONv5);
+	BOOST_CHECK_EQUAL(core.cpu_count(), 2);
+	BOOST_CHECK_EQUAL(core.physical_memory()->chunks_count(), 3);
+	BOOST_REQUIRE(core.cpu_begin() != core.cpu_end());
+	BOOST_CHECK_EQUAL((core.cpu_begin() + 1)->rip(), cpu.rip());
+	BOOST_CHECK_EQUAL((core.cpu_begin() + 1)->cr3(), cpu.cr3());
+
+	// The same options give the same memory.
+	const synthetic_memory same(options);
+
+	for (auto const& segment : memory.segments()) {
+		std::vector<std::uint8_t> expected_data(segment.end - segment.begin), data(expected_data.size());
+		same.read_buffer(segment.begin, expected_data.data(), expected_data.size());
+		core.physical_memory()->read_buffer(segment.begin, data.data(), data.size());
+		BOOST_CHECK(data == expected_data);
+	}
+
+	::unlink(path);
+
+	options.memory_size = 0x4000;
+	BOOST_CHECK_THROW(synthetic_memory{ options }, std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(syntheticCoreTinySegments)
+{
+	// One page per segment: the page tables span several segments, the PML4 is not in the first one.
+	synthetic_core_options options;
+	options.memory_size = 64 * synthetic_memory::page_size;
+	options.segment_count = 64;
+	options.mapped_size = 8 * synthetic_memory::page_size;
+
+	const synthetic_memory memory(options);
+
+	BOOST_CHECK_EQUAL(memory.page_table_root(), memory.backed_page_address(1));
+	BOOST_CHECK_NE(memory.page_table_root(), synthetic_memory::page_size);
+
+	const cpu_virtualbox cpu = synthetic_cpu(memory, 0);
+	const virtual_memory vm(memory, cpu);
+
+	for (std::uint64_t offset = 0; offset < options.mapped_size; offset += synthetic_memory::page_size) {
+		std::uint64_t physical_address;
+		BOOST_REQUIRE(vm.translate(options.virtual_base + offset + 8, physical_address));
+		BOOST_CHECK_EQUAL(physical_address, memory.translate(options.virtual_base + offset + 8));
+	}
+}